@@ -6,6 +6,7 @@ from cv_bridge import CvBridge, CvBridgeError
 import cv2
 import tensorflow as tf
 import time
+import bird_metrics
 
 class BirdDetection:
     def __init__(self):
@@ -20,6 +21,14 @@ class BirdDetection:
         self.image_pub = rospy.Publisher('/detection_1/image', Image, queue_size=10)
         self.trigger_pub = rospy.Publisher('/detection_1/is_triggered', Int32, queue_size=10)
         
+        # 런타임 메트릭 (birdtop): 처리/버린 프레임, 카메라 캡처 → 트리거 발행 지연
+        self.metrics = bird_metrics.serve('detection_1')
+        self.frames = self.metrics.counter('frames_total', '처리한 카메라 프레임')
+        self.dropped = self.metrics.counter('frames_dropped_total', '주기(4fps)에 맞추느라 버린 프레임')
+        self.detections = self.metrics.counter('detections_total', '새가 감지된 프레임')
+        self.errors = self.metrics.counter('callback_errors_total', '콜백 예외')
+        self.latency = self.metrics.histogram('latency_seconds', '카메라 캡처 → 트리거 발행 [s]')
+
         # 딥러닝 모델 로드
         self.detection_model = self.load_model()
         
@@ -48,8 +57,11 @@ class BirdDetection:
             
             # 현재 시간과 마지막 프레임 시간 비교
             current_time = time.time()
-            if (current_time - self.last_frame_time) >= self.frame_interval:
+            if (current_time - self.last_frame_time) < self.frame_interval:
+                self.dropped.inc()
+            else:
                 self.last_frame_time = current_time
+                self.frames.inc()
 
                 # 이미지 리사이즈
                 image_resized = cv2.resize(cv_image, (320, 320), interpolation=cv2.INTER_AREA)
@@ -87,15 +99,22 @@ class BirdDetection:
 
                 # 트리거 신호 발행
                 self.trigger_pub.publish(1 if bird_detected else 0)
+                if bird_detected:
+                    self.detections.inc()
+                # 스탬프가 없는 카메라면 기록하지 않는다
+                if not data.header.stamp.is_zero():
+                    self.latency.observe((rospy.Time.now() - data.header.stamp).to_sec())
 
                 # 이미지 ROS 메시지로 변환 후 발행
                 ros_image = self.bridge.cv2_to_imgmsg(cv_image, "bgr8")
                 self.image_pub.publish(ros_image)
 
         except CvBridgeError as e:
-            rospy.logerr(f"CvBridge Error: {e}")
+            self.errors.inc()
+            rospy.logerr_throttle(5, f"CvBridge Error: {e}")
         except Exception as e:
-            rospy.logerr(f"Callback 예외: {e}")
+            self.errors.inc()
+            rospy.logerr_throttle(5, f"Callback 예외: {e}")
 
     def run(self):
         """
@@ -4,6 +4,7 @@
 import os
 import rospy
 import roslaunch
+import bird_metrics
 from std_msgs.msg import Int32
 from geometry_msgs.msg import Twist
 
@@ -22,6 +23,16 @@ class AutonomousVehicleNode:
         self.detect_sub = rospy.Subscriber('/detection_1/is_triggered', Int32, self.detect_callback)
         self.shooting_mode_pub = rospy.Publisher('/shooting_mode_trigger', Int32, queue_size=10)
 
+        # 런타임 메트릭 (birdtop): /cmd_vel 발행 주기와 현재 모드
+        self.metrics = bird_metrics.serve('core')
+        self.frames = self.metrics.counter('frames_total', '발행한 /cmd_vel')
+        self.shots_done = self.metrics.counter('shooting_done_total', '받은 /shooting_done')
+        for mode in ('driving', 'obstacle', 'shooting'):
+            self.metrics.gauge('mode', '현재 모드면 1', {'mode': mode},
+                               fn=lambda mode=mode: int(self.current_mode == mode))
+        # 모드가 바뀔 때만 로그
+        self.logged_mode = None
+
         # Main loop rate
         self.rate = rospy.Rate(10)
 
@@ -65,6 +76,7 @@ class AutonomousVehicleNode:
             self.detection_2_launch = None
 
     def shooting_done_callback(self, msg):
+        self.shots_done.inc()
         self.shooting_done = True
         self.current_mode = 'driving'
         #self.stop_detection_2()  # 속도 개선 후 종료할 필요 없어짐.
@@ -92,15 +104,20 @@ class AutonomousVehicleNode:
             if self.current_mode == 'driving':
                 self.twist.linear.x = 0.3  # 직진 #0.3
                 self.twist.angular.z = 0.0
-                rospy.loginfo("Current mode: driving")
+                if self.logged_mode != 'driving':
+                    rospy.loginfo("Current mode: driving")
+                    self.logged_mode = 'driving'
             elif self.current_mode == 'obstacle':
                 self.twist.linear.x = 0.0
                 self.twist.angular.z = -1.0  # 회전하여 장애물 회피
                 self.cmd_pub.publish(self.twist)
+                self.frames.inc()
                 rospy.loginfo("Current mode: obstacle, turning")
+                self.logged_mode = 'obstacle'
                 # 장애물이 없어질 때까지 회전
                 while self.current_mode == 'obstacle':
                     self.cmd_pub.publish(self.twist)
+                    self.frames.inc()
                     self.rate.sleep()
                 rospy.loginfo("Obstacle cleared, switching to driving mode")
                 continue  # 장애물이 없어지면 다음 루프로 넘어감
@@ -108,12 +125,15 @@ class AutonomousVehicleNode:
                 self.twist.linear.x = 0.15
                 self.twist.angular.z = 0.0
                 rospy.loginfo("Current mode: shooting, waiting for shooting to complete")
+                self.logged_mode = 'shooting'
                 while not self.shooting_done:
                     self.cmd_pub.publish(self.twist)  # 정지 명령을 계속 유지
+                    self.frames.inc()
                     self.rate.sleep()
                 self.shooting_done = False
 
             self.cmd_pub.publish(self.twist)
+            self.frames.inc()
             self.rate.sleep()
 
     def run(self):
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+import collections
+import math
+import rospy
+import bird_metrics
+from bird_alert_msgs.msg import BirdDetection, LatencyReport, TrackAck
+
+# 카메라 프레임 하나가 서보까지 가는 단계, 각 단계는 앞 단계부터의 시간
+HOPS = ('camera', 'preprocess', 'infer', 'publish', 'bridge_tx', 'mcu_rx', 'ccr_applied')
+# detection_2가 채우는 단계, 나머지는 TrackAck(rasptostm)로 온다
+HOST_HOPS = HOPS[:4]
+TOTAL = 'total'
+
+
+class LatencyTracer:
+    def __init__(self):
+        rospy.init_node('latency_tracer')
+
+        # 최근 window개 프레임의 단계별 지연 [s]
+        self.window = rospy.get_param('~window', 500)
+        self.period = rospy.get_param('~period', 5.0)
+        self.samples = {name: collections.deque(maxlen=self.window) for name in HOPS[1:] + (TOTAL,)}
+        # 누적 히스토그램: 2^i us 칸, 펌웨어 프로브(CMDPROF)와 같은 눈금
+        self.hist = {name: [0] * 32 for name in self.samples}
+
+        self.detection_sub = rospy.Subscriber('/bird_detection_2/detection', BirdDetection, self.detection_callback)
+        self.ack_sub = rospy.Subscriber('/bird_turret/track_ack', TrackAck, self.ack_callback)
+        self.report_pub = rospy.Publisher('/bird_alert/latency', LatencyReport, queue_size=10)
+
+        # 런타임 메트릭 (birdtop): ack 수와 전체 지연, 단계별 지연은 hop 레이블로
+        self.metrics = bird_metrics.serve('latency_tracer')
+        self.frames = self.metrics.counter('frames_total', '받은 TrackAck')
+        self.latency = self.metrics.histogram('latency_seconds', '카메라 캡처 → CCR 반영 [s]')
+        self.hop_latency = {name: self.metrics.histogram('hop_latency_seconds', '앞 단계부터의 시간 [s]', {'hop': name})
+                            for name in HOPS[1:]}
+        self.timer = rospy.Timer(rospy.Duration(self.period), self.report)
+
+    def detection_callback(self, data):
+        self.add(data.hops, HOST_HOPS)
+
+    def ack_callback(self, data):
+        self.frames.inc()
+        # 카메라 → publish는 감지 메시지에서 이미 셌다
+        self.add(data.hops, HOPS[3:])
+        start, end = data.hops.camera, data.hops.ccr_applied
+        if not start.is_zero() and not end.is_zero():
+            self.sample(TOTAL, (end - start).to_sec())
+            self.latency.observe((end - start).to_sec())
+
+    def add(self, hops, names):
+        for prev, name in zip(names, names[1:]):
+            start, end = getattr(hops, prev), getattr(hops, name)
+            if not start.is_zero() and not end.is_zero():
+                self.sample(name, (end - start).to_sec())
+                self.hop_latency[name].observe((end - start).to_sec())
+
+    def sample(self, name, seconds):
+        self.samples[name].append(seconds)
+        # 음수(MCU 시계 동기 오차)는 첫 칸
+        us = max(int(seconds * 1e6), 1)
+        self.hist[name][min(us.bit_length() - 1, 31)] += 1
+
+    @staticmethod
+    def percentile(values, p):
+        # 최근접 순위
+        return values[max(int(math.ceil(p / 100.0 * len(values))) - 1, 0)]
+
+    def report(self, _):
+        msg = LatencyReport()
+        msg.header.stamp = rospy.Time.now()
+        for name, window in self.samples.items():
+            if not window:
+                continue
+            values = sorted(window)
+            p50, p95, p99 = (self.percentile(values, p) for p in (50, 95, 99))
+            msg.hops.append(name)
+            msg.count.append(len(values))
+            msg.p50.append(p50)
+            msg.p95.append(p95)
+            msg.p99.append(p99)
+            msg.max.append(values[-1])
+            # 비어 있지 않은 칸만: [2^i, 2^(i+1)) us
+            buckets = ' '.join(f'2^{i}:{n}' for i, n in enumerate(self.hist[name]) if n)
+            rospy.loginfo(f'latency {name:11s} n={len(values)} p50/p95/p99/max='
+                          f'{p50 * 1e3:.1f}/{p95 * 1e3:.1f}/{p99 * 1e3:.1f}/{values[-1] * 1e3:.1f}ms '
+                          f'{buckets}')
+        if msg.hops:
+            self.report_pub.publish(msg)
+
+    def run(self):
+        rospy.spin()
+
+
+if __name__ == '__main__':
+    tracer = LatencyTracer()
+    tracer.run()
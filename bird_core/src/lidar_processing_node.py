@@ -3,6 +3,7 @@
 
 import rospy
 import math
+import bird_metrics
 from std_msgs.msg import Int32
 from sensor_msgs.msg import LaserScan
 
@@ -20,6 +21,14 @@ class LidarProcessingNode:
         self.distance_threshold = rospy.get_param('~distance_threshold', 0.5)  # 거리 임계값 (디폴트: 0.5미터)
         self.min_valid_distance = rospy.get_param('~min_valid_distance', 0.15)  # 최소 유효 거리 (디폴트: 0.3미터)
 
+        # 런타임 메트릭 (birdtop): 스캔 주기와 스캔 시각 → 판단 발행 지연
+        self.metrics = bird_metrics.serve('lidar_processing_node')
+        self.frames = self.metrics.counter('frames_total', '처리한 /scan')
+        self.latency = self.metrics.histogram('latency_seconds', '스캔 시각 → /lidar_trigger 발행 [s]')
+        self.obstacle = self.metrics.gauge('obstacle', '장애물이 있으면 1, 유효 거리 없음 -1')
+        # 상태가 바뀔 때만 로그
+        self.last_state = None
+
         # Fixed angles for detection (in radians)
         self.front_angle_min = 0.0  # 0도 (라디안)
         self.front_angle_max = math.radians(45)  # 15도 (라디안)
@@ -27,6 +36,7 @@ class LidarProcessingNode:
         self.rear_angle_max = math.radians(360)  # 360도 (라디안)
 
     def scan_callback(self, data):
+        self.frames.inc()
         valid_ranges = []
 
         for i, distance in enumerate(data.ranges):
@@ -48,14 +58,22 @@ class LidarProcessingNode:
             
             if min_distance < self.distance_threshold:
                 self.obstacle_pub.publish(Int32(data=1))
-                rospy.loginfo("Obstacle detected within %f meters at angle: %f radians", 
-                              self.distance_threshold, min_angle)
+                if self.last_state != 1:
+                    rospy.loginfo("Obstacle detected within %f meters at angle: %f radians", 
+                                  self.distance_threshold, min_angle)
+                self.last_state = 1
             else:
                 self.obstacle_pub.publish(Int32(data=0))
               #  rospy.loginfo("No obstacle within %f meters", self.distance_threshold)
+                self.last_state = 0
         else:
             self.obstacle_pub.publish(Int32(data=0))
-            rospy.loginfo("No valid distance measurements within specified angles")
+            if self.last_state != -1:
+                rospy.loginfo("No valid distance measurements within specified angles")
+            self.last_state = -1
+        self.obstacle.set(self.last_state)
+        if not data.header.stamp.is_zero():
+            self.latency.observe((rospy.Time.now() - data.header.stamp).to_sec())
 
     def run(self):
         rospy.spin()
@@ -0,0 +1,10 @@
+# catkin_python_setup()용, 직접 실행하지 않는다
+from setuptools import setup
+from catkin_pkg.python_setup import generate_distutils_setup
+
+setup_args = generate_distutils_setup(
+    packages=['bird_metrics'],
+    package_dir={'': 'src'},
+)
+
+setup(**setup_args)
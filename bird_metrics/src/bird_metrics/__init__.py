@@ -0,0 +1,218 @@
+# -*- coding: utf-8 -*-
+"""노드 런타임 메트릭: counter, gauge, histogram을 Prometheus 텍스트 형식으로 localhost에 노출한다.
+
+    metrics = bird_metrics.serve('detection_2')   # ~metrics_port, 기본은 DEFAULT_PORTS
+    frames = metrics.counter('frames_total', '받은 카메라 프레임')
+    frames.inc()
+
+모든 이름 앞에 bird_가 붙는다. birdtop이 아래 이름을 노드마다 한 줄로 보여준다:
+  bird_frames_total            노드가 처리하는 단위(카메라 프레임, 감지, 스캔)의 수신 수 → fps
+  bird_frames_dropped_total    버린 프레임
+  bird_latency_seconds         프레임 하나에 노드가 더하는 지연 히스토그램 → p50/p95/p99
+  bird_queue_*                 큐 깊이 gauge
+  process_cpu_seconds_total    CPU 사용률
+"""
+
+import bisect
+import os
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+PREFIX = 'bird_'
+# 노드별 기본 포트, birdtop은 PORTS를 훑는다. 이미 쓰이는 포트면 PORTS의 다음 빈 포트
+DEFAULT_PORTS = {
+    'core': 9101,
+    'detection_1': 9102,
+    'detection_2': 9103,
+    'rasptostm': 9104,
+    'latency_tracer': 9105,
+    'lidar_processing_node': 9106,
+}
+PORTS = range(9100, 9120)
+# 지연 칸 [s]: 1ms부터 √2배씩 4s까지, 칸 안은 birdtop이 선형 보간한다
+LATENCY_BUCKETS = tuple(round(0.001 * 2 ** (i / 2), 6) for i in range(25))
+CONTENT_TYPE = 'text/plain; version=0.0.4; charset=utf-8'
+
+
+def _labelstr(labels):
+    if not labels:
+        return ''
+    return '{' + ','.join(f'{k}="{v}"' for k, v in sorted(labels.items())) + '}'
+
+
+def _num(v):
+    if v == float('inf'):
+        return '+Inf'
+    return repr(float(v)) if isinstance(v, float) else str(v)
+
+
+class Counter:
+    kind = 'counter'
+
+    def __init__(self, name, help, labels=None, fn=None):
+        self.name, self.help, self.labels = name, help, labels or {}
+        self.fn = fn
+        self.value = 0
+        self.lock = threading.Lock()
+
+    def inc(self, n=1):
+        with self.lock:
+            self.value += n
+
+    def get(self):
+        return self.fn() if self.fn else self.value
+
+    def samples(self):
+        yield self.name, self.labels, self.get()
+
+
+class Gauge(Counter):
+    kind = 'gauge'
+
+    def set(self, v):
+        self.value = v
+
+    def dec(self, n=1):
+        self.inc(-n)
+
+
+class Histogram:
+    kind = 'histogram'
+
+    def __init__(self, name, help, labels=None, buckets=LATENCY_BUCKETS):
+        self.name, self.help, self.labels = name, help, labels or {}
+        self.buckets = tuple(buckets)
+        # 칸마다의 수, 마지막은 +Inf. 내보낼 때 누적한다
+        self.counts = [0] * (len(self.buckets) + 1)
+        self.sum = 0.0
+        self.lock = threading.Lock()
+
+    def observe(self, v):
+        i = bisect.bisect_left(self.buckets, v)
+        with self.lock:
+            self.counts[i] += 1
+            self.sum += v
+
+    def time(self):
+        """with metrics.latency.time(): ... 블록의 실행 시간을 넣는다."""
+        return _Timer(self)
+
+    def samples(self):
+        with self.lock:
+            counts, total = list(self.counts), self.sum
+        n = 0
+        for le, c in zip(self.buckets + (float('inf'),), counts):
+            n += c
+            yield self.name + '_bucket', dict(self.labels, le=_num(le)), n
+        yield self.name + '_sum', self.labels, total
+        yield self.name + '_count', self.labels, n
+
+
+class _Timer:
+    def __init__(self, hist):
+        self.hist = hist
+
+    def __enter__(self):
+        self.start = time.monotonic()
+        return self
+
+    def __exit__(self, *_):
+        self.hist.observe(time.monotonic() - self.start)
+
+
+def _rss():
+    try:
+        with open('/proc/self/statm') as f:
+            return int(f.read().split()[1]) * os.sysconf('SC_PAGE_SIZE')
+    except (OSError, ValueError, IndexError):
+        return 0
+
+
+class Registry:
+    def __init__(self, node):
+        self.node = node
+        self.metrics = []
+        self.lock = threading.Lock()
+        self.port = None
+        self.add(Gauge('bird_node_info', '노드 이름', {'node': node}, fn=lambda: 1))
+        self.add(Counter('process_cpu_seconds_total', '프로세스 user+system CPU 시간 [s]',
+                         fn=time.process_time))
+        self.add(Gauge('process_resident_memory_bytes', 'RSS [byte]', fn=_rss))
+
+    def add(self, metric):
+        with self.lock:
+            self.metrics.append(metric)
+        return metric
+
+    def counter(self, name, help, labels=None, fn=None):
+        return self.add(Counter(PREFIX + name, help, labels, fn))
+
+    def gauge(self, name, help, labels=None, fn=None):
+        """fn이 있으면 읽을 때마다 호출한다 (큐 길이처럼 이미 있는 값)."""
+        return self.add(Gauge(PREFIX + name, help, labels, fn))
+
+    def histogram(self, name, help, labels=None, buckets=LATENCY_BUCKETS):
+        return self.add(Histogram(PREFIX + name, help, labels, buckets))
+
+    def expose(self):
+        with self.lock:
+            metrics = sorted(self.metrics, key=lambda m: m.name)
+        lines, seen = [], set()
+        for m in metrics:
+            if m.name not in seen:
+                seen.add(m.name)
+                lines.append(f'# HELP {m.name} {m.help}')
+                lines.append(f'# TYPE {m.name} {m.kind}')
+            try:
+                for name, labels, value in m.samples():
+                    lines.append(f'{name}{_labelstr(labels)} {_num(value)}')
+            except Exception:
+                # fn이 실패한 값(닫힌 시리얼 포트 등)은 건너뛴다
+                continue
+        return '\n'.join(lines) + '\n'
+
+    def start(self, port):
+        """127.0.0.1:port/metrics를 데몬 스레드로 제공한다. 실제로 연 포트, 열지 못하면 None."""
+        registry = self
+
+        class Handler(BaseHTTPRequestHandler):
+            def do_GET(self):
+                if self.path.split('?')[0] not in ('/', '/metrics'):
+                    self.send_error(404)
+                    return
+                body = registry.expose().encode()
+                self.send_response(200)
+                self.send_header('Content-Type', CONTENT_TYPE)
+                self.send_header('Content-Length', str(len(body)))
+                self.end_headers()
+                self.wfile.write(body)
+
+            def log_message(self, *args):
+                pass
+
+        for p in [port] + [p for p in PORTS if p != port]:
+            try:
+                server = ThreadingHTTPServer(('127.0.0.1', p), Handler)
+            except OSError:
+                continue
+            server.daemon_threads = True
+            thread = threading.Thread(target=server.serve_forever, daemon=True)
+            thread.start()
+            self.port = p
+            return p
+        return None
+
+
+def serve(node):
+    """노드의 Registry를 만들고 ~metrics_port(0: 끔)로 노출한다. rospy.init_node() 다음에 부른다."""
+    import rospy
+    registry = Registry(node)
+    port = rospy.get_param('~metrics_port', DEFAULT_PORTS.get(node, PORTS[0]))
+    if port:
+        opened = registry.start(port)
+        if opened is None:
+            rospy.logwarn(f'metrics: {PORTS.start}-{PORTS.stop - 1} 포트가 모두 사용 중')
+        elif opened != port:
+            rospy.logwarn(f'metrics: {port} 포트 사용 중, 127.0.0.1:{opened}/metrics')
+    return registry
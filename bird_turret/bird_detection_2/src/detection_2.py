@@ -2,7 +2,8 @@ import os
 import time  # Added import for time
 import rospy
 from sensor_msgs.msg import Image
-from geometry_msgs.msg import Vector3
+from bird_alert_msgs.msg import BirdDetection
+import bird_metrics
 from cv_bridge import CvBridge, CvBridgeError
 import cv2
 import numpy as np
@@ -20,8 +21,18 @@ class BirdDetector:
         self.image_sub = rospy.Subscriber('/usb_cam2/image_raw', Image, self.callback)
         self.image_pub = rospy.Publisher('/bird_detection_2/image_with_boxes', Image, queue_size=10)
 
-        # PID 제어 결과 퍼블리셔
-        self.angle_pub = rospy.Publisher('/bird_detection_2/angles', Vector3, queue_size=10)
+        # 중심 오차와 발사 여부, 카메라 프레임 시각과 단계별 통과 시각(지연 추적용)
+        self.detection_pub = rospy.Publisher('/bird_detection_2/detection', BirdDetection, queue_size=10)
+
+        # 런타임 메트릭 (birdtop): 처리/버린 프레임, 카메라 캡처 → 발행 지연, 추론 시간
+        self.metrics = bird_metrics.serve('detection_2')
+        self.frames = self.metrics.counter('frames_total', '처리한 카메라 프레임')
+        self.dropped = self.metrics.counter('frames_dropped_total', '주기(15fps)에 맞추느라 버린 프레임')
+        self.detections = self.metrics.counter('detections_total', '새가 감지된 프레임')
+        self.shoots = self.metrics.counter('shoot_total', '중심 근처라 발사(z=1)로 보낸 프레임')
+        self.errors = self.metrics.counter('callback_errors_total', '콜백 예외')
+        self.latency = self.metrics.histogram('latency_seconds', '카메라 캡처 → BirdDetection 발행 [s]')
+        self.infer_time = self.metrics.histogram('infer_seconds', '모델 추론 [s]')
 
         # TensorFlow 모델 로드
         self.detection_model = self.load_model()
@@ -60,16 +71,27 @@ class BirdDetector:
 
             # 현재 시간과 마지막 프레임 시간 비교
             current_time = time.time()
-            if (current_time - self.last_frame_time) >= self.frame_interval:
+            if (current_time - self.last_frame_time) < self.frame_interval:
+                self.dropped.inc()
+            else:
                 self.last_frame_time = current_time
+                self.frames.inc()
+                detection_msg = BirdDetection()
+                # 카메라 드라이버가 찍은 캡처 시각, 없으면 수신 시각
+                detection_msg.header.stamp = data.header.stamp if not data.header.stamp.is_zero() else rospy.Time.now()
+                detection_msg.header.frame_id = data.header.frame_id
+                detection_msg.hops.camera = detection_msg.header.stamp
 
                 # 이미지 크기 조정 (모델 입력 크기)
                 image_resized = cv2.resize(cv_image, (320, 320))
                 input_tensor = tf.convert_to_tensor(image_resized)
                 input_tensor = input_tensor[tf.newaxis, ...]
+                detection_msg.hops.preprocess = rospy.Time.now()
 
                 # 객체 감지 수행
                 output_dict = self.detection_model(input_tensor)
+                detection_msg.hops.infer = rospy.Time.now()
+                self.infer_time.observe((detection_msg.hops.infer - detection_msg.hops.preprocess).to_sec())
 
                 # 결과 해석
                 num_detections = int(output_dict['num_detections'][0].numpy())
@@ -84,10 +106,8 @@ class BirdDetector:
                 image_center_x = cv_image.shape[1] // 2
                 image_center_y = cv_image.shape[0] // 2
 
-                detected = False
                 cross_color = (255, 255, 255)  # 기본 색상은 흰색
                 show_shoot_text = False  # shoot 텍스트 표시 여부
-                angle_msg = Vector3()  # 초기화
 
                 # 이미지에서 감지된 새를 그리기 및 정보 추가
                 for i in range(num_detections):
@@ -106,38 +126,32 @@ class BirdDetector:
                         text = f'ID: {class_ids[i]}, Score: {scores[i]:.2f}'
                         cv_image = cv2.putText(cv_image, text, (int(left), int(top) - 10), cv2.FONT_HERSHEY_SIMPLEX, 0.5, (255, 255, 255), 2)
                         
-                        # 중심점 에러 계산 및 콘솔 출력
+                        # 중심점 에러 계산
                         error_x = center_x - image_center_x
                         error_y = center_y - image_center_y
-                        rospy.loginfo(f"Error X: {error_x}, Error Y: {error_y}")
 
                         # 에러 값을 이미지에 표시
                         error_text = f'Error X: {error_x}, Error Y: {error_y}'
                         cv_image = cv2.putText(cv_image, error_text, (10, cv_image.shape[0] - 10), cv2.FONT_HERSHEY_SIMPLEX, 0.5, (255, 255, 255), 2)
 
-                        # 에러 값을 퍼블리시하기 전에 정수형으로 변환
-                        angle_msg.x = int(error_x)
-                        angle_msg.y = int(error_y)
+                        detection_msg.detected = True
+                        self.detections.inc()
+                        detection_msg.error_x = int(error_x)
+                        detection_msg.error_y = int(error_y)
+                        detection_msg.score = float(scores[i])
 
                         # 물체가 중심에 가까운지 확인
                         if abs(error_x) < self.proximity_threshold and abs(error_y) < self.proximity_threshold:
                             cross_color = (0, 0, 255)  # 빨간색으로 변경
                             show_shoot_text = True  # shoot 텍스트 표시
-                            angle_msg.z = 1  # z값을 1로 설정 (정수형)
-                            rospy.loginfo("shoot!!!")
-                        else:
-                            angle_msg.z = 0  # z값을 0으로 설정 (정수형)
-
-                        detected = True
+                            detection_msg.shoot = True
+                            self.shoots.inc()
                         break
 
-                if not detected:
-                    # 객체가 감지되지 않은 경우 제어 신호를 0으로 설정
-                    angle_msg.x = 0
-                    angle_msg.y = 0
-                    angle_msg.z = 0
-
-                self.angle_pub.publish(angle_msg)
+                # 감지되지 않은 경우 detected = False, 오차 0
+                detection_msg.hops.publish = rospy.Time.now()
+                self.detection_pub.publish(detection_msg)
+                self.latency.observe((detection_msg.hops.publish - detection_msg.hops.camera).to_sec())
 
                 # 중심에 흰색 또는 빨간색 십자 그리기
                 cv_image = cv2.line(cv_image, (image_center_x - 50, image_center_y), (image_center_x + 50, image_center_y), cross_color, 2)
@@ -152,9 +166,11 @@ class BirdDetector:
                 self.image_pub.publish(image_message)
 
         except CvBridgeError as e:
-            rospy.logerr(f"CvBridge Error: {e}")
+            self.errors.inc()
+            rospy.logerr_throttle(5, f"CvBridge Error: {e}")
         except Exception as e:
-            rospy.logerr(f"Exception in callback: {e}")
+            self.errors.inc()
+            rospy.logerr_throttle(5, f"Exception in callback: {e}")
 
     def run(self):
         rospy.spin()
@@ -1,60 +1,322 @@
 #!/usr/bin/env python3
+import collections
+import struct
+import threading
 import rospy
-from geometry_msgs.msg import Point
+from dynamic_reconfigure.server import Server
 import serial
-from std_msgs.msg import Int32  # 1바이트 데이터를 위한 메시지 타입
+import bird_metrics
+from std_msgs.msg import Empty, Int32  # 1바이트 데이터를 위한 메시지 타입
+from bird_turret.cfg import TurretConfig
+from bird_turret.msg import TurretAimDone, TurretLimit, TurretTelemetry
+from bird_alert_msgs.msg import Aim, BirdDetection, TrackAck
+
+# stm32v2 텔레메트리 프레임: AA 55 | type | len | payload | crc8(type..payload)
+TELEM_SYNC = b'\xaa\x55'
+TELEM_STATUS = 0x01
+TELEM_PAYLOAD = struct.Struct('<IHiiiiBBBBHHHHHBH')
+TELEM_FLAG_MOTOR = 0x01
+TELEM_FLAG_MOVE = 0x02
+TELEM_FLAG_AIM = 0x04
+TELEM_FLAG_HOLD = 0x08
+TELEM_FLAG_SPUN = 0x10
+TELEM_FLAG_PHISAT = 0x20
+TELEM_FLAG_THTSAT = 0x40
+TELEM_FLAG_LIMIT = 0x80
+TELEM_AIMDONE = 0x02
+AIMDONE_PAYLOAD = struct.Struct('<BBii')
+AIM_ARRIVED = 1
+AIM_LIMITED = 2
+# 한 축이 maxboundcnt 프레임 동안 서보 한계에 막혀 물러남: 포기한 방향 비트, 유지 위치 [udeg]
+TELEM_LIMIT = 0x08
+LIMIT_PAYLOAD = struct.Struct('<Bii')
+LIMIT_PHILO, LIMIT_PHIHI, LIMIT_THTLO, LIMIT_THTHI = 0x01, 0x02, 0x04, 0x08
+# CMDPROF 응답, 프로브마다 한 프레임: probe, nprobes, sched, name[8], count/min/max/mean, 2^i 사이클 히스토그램 32칸
+TELEM_PROF = 0x03
+PROF_PAYLOAD = struct.Struct('<BBB8s4I32I')
+# sched: 펌웨어 실행 모델 (turret_sched.h의 TURRET_RTOS)
+SCHED_NAMES = ('superloop', 'rtos')
+MCU_HZ = 168e6
+# CMDRTOSSTATS 응답(stm32 FreeRTOS 빌드): 태스크마다 TELEM_TASK, 마지막에 TELEM_RTOS
+TELEM_TASK = 0x04
+TASK_PAYLOAD = struct.Struct('<BB16sBBHI')  # index, ntasks, name, priority, state, stack 최소 여유 [word], runtime
+TELEM_RTOS = 0x05
+RTOS_PAYLOAD = struct.Struct('<7I')  # total runtime, heap free/min free, queue recv/send, stream, notify 블록 횟수
+TASK_STATES = ('running', 'ready', 'blocked', 'suspended', 'deleted')
+# CMDPARAMGET/SET 응답, 파라미터마다 한 프레임: id, count, type, status, name[12], value/min/max/dflt (원시 4바이트)
+TELEM_PARAM = 0x06
+PARAM_PAYLOAD = struct.Struct('<BBBB12s4I')
+PARAM_INT, PARAM_FLOAT = 0, 1
+PARAM_VALUE = ('<i', '<f')
+PARAM_STATUS = ('ok', 'unknown', 'range', 'busy')
+PARAM_ALL = 0xff
+# CMDPARAMCOMMIT 응답: ok, erased, seq, 섹터 사용량/크기 [byte]
+TELEM_PARAM_COMMIT = 0x07
+PARAM_COMMIT_PAYLOAD = struct.Struct('<BBIII')
+# MCU 하나가 여러 터렛(unit)을 구동할 때: 이후 프레임과 1바이트 응답이 이 unit의 것
+TELEM_UNIT = 0x09
+# CMDTRACK 하나가 서보에 반영됨: stamp, MCU 수신 틱 [ms], 수신 → setpoint, 수신 → 첫 CCR 쓰기 [cycle]
+TELEM_TRACK_ACK = 0x0A
+TRACK_ACK_PAYLOAD = struct.Struct('<IIII')
+MOVEOP = 0
+TRIGOP = 1
+
+# 호스트 -> MCU 프레임 명령도 같은 형식을 쓴다
+CMD_AIM = 0x10
+CMD_AIM_PAYLOAD = struct.Struct('<Bii')  # id, pan/tilt [micro-degree] 중앙 기준
+CMD_TRIG_TABLE = 0x11  # {u16 CCR1, u16 ms} x 1..8
+TRIG_STEP = struct.Struct('<HH')
+CMD_BURST = 0x12  # shots, hold, interval/cooldown/track loss [ms]
+CMD_BURST_PAYLOAD = struct.Struct('<BBHHH')
+CMD_CENTER = 0x13
+CMD_SPIN = 0x14  # 1: 발사 모터 선회전, 0: 정지
+CMD_MOTOR_CFG = 0x15  # duty [permille], soft-start ramp, idle hold [ms]
+CMD_MOTOR_CFG_PAYLOAD = struct.Struct('<HHH')
+CMD_PROF = 0x16  # 1: 프로브 덤프, 2: 초기화, 3: 덤프 후 초기화
+CMD_RTOS_STATS = 0x17
+CMD_PARAM_GET = 0x18  # id 또는 PARAM_ALL
+CMD_PARAM_SET = 0x19  # id, i32/f32 값, 리셋 전까지 유지
+CMD_PARAM_COMMIT = 0x1A  # 현재 값을 플래시에 저장
+CMD_SERVO_LUT = 0x1B  # axis, 시작/간격 [udeg], CCR 최대 17개 (없으면 선형 매핑으로 복귀)
+CMD_SERVO_LUT_HEAD = struct.Struct('<Bii')
+SERVO_AXES = {'phi': 0, 'tht': 1}
+# MOVEOP과 같은 x, y 오차에 카메라 프레임 시각(MCU 틱 [ms])을 붙인다: MCU가 alpha-beta 필터로 프레임 사이를 외삽
+CMD_TRACK = 0x1C
+CMD_TRACK_PAYLOAD = struct.Struct('<Ibb')
+# 이후 명령을 받을 unit 선택, 리셋 후에는 0
+CMD_UNIT = 0x1D
+# TELEM_UNIT에 따라 그 unit의 Turret으로 보내는 항목, 나머지는 MCU 전체의 것
+UNIT_KINDS = ('telem', 'aimdone', 'param', 'limit', 'trackack', 'result')
+
+
+def crc8(data):
+    crc = 0
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xff if crc & 0x80 else (crc << 1) & 0xff
+    return crc
+
+
+def make_frame(kind, payload):
+    body = bytes([kind, len(payload)]) + payload
+    return TELEM_SYNC + body + bytes([crc8(body)])
+
+
+class TelemetryParser:
+    """MCU 수신 바이트열에서 텔레메트리 프레임과 1바이트 응답(RES_ERR/RES_DON)을 분리한다.
+    TELEM_UNIT 뒤의 프레임과 응답은 그 unit의 것이다 (리셋 후 0)."""
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.crc_errors = 0
+        self.rxunit = 0
+
+    def feed(self, data):
+        """(unit, 'telem' | 'aimdone' | 'prof' | 'task' | 'rtos' | 'param' | 'commit' | 'limit' | 'trackack', payload) 또는 (unit, 'result', byte) 목록을 반환한다."""
+        self.buf += data
+        out = []
+        while self.buf:
+            if self.buf[0] != TELEM_SYNC[0]:
+                # 프레임 밖의 바이트는 기존 1바이트 응답
+                self.emit(out, 'result', self.buf.pop(0))
+                continue
+            if len(self.buf) < 4:
+                break
+            if self.buf[1] != TELEM_SYNC[1]:
+                self.buf.pop(0)
+                continue
+            length = self.buf[3]
+            if len(self.buf) < 5 + length:
+                break
+            frame = bytes(self.buf[2:4 + length])
+            crc = self.buf[4 + length]
+            if crc8(frame) != crc:
+                # 동기 바이트를 버리고 다시 동기화
+                self.crc_errors += 1
+                self.buf.pop(0)
+                continue
+            del self.buf[:5 + length]
+            if frame[0] == TELEM_UNIT and length == 1:
+                self.rxunit = frame[2]
+            elif frame[0] == TELEM_STATUS and length == TELEM_PAYLOAD.size:
+                self.emit(out, 'telem', frame[2:])
+            elif frame[0] == TELEM_AIMDONE and length == AIMDONE_PAYLOAD.size:
+                self.emit(out, 'aimdone', frame[2:])
+            elif frame[0] == TELEM_PROF and length == PROF_PAYLOAD.size:
+                self.emit(out, 'prof', frame[2:])
+            elif frame[0] == TELEM_TASK and length == TASK_PAYLOAD.size:
+                self.emit(out, 'task', frame[2:])
+            elif frame[0] == TELEM_RTOS and length == RTOS_PAYLOAD.size:
+                self.emit(out, 'rtos', frame[2:])
+            elif frame[0] == TELEM_PARAM and length == PARAM_PAYLOAD.size:
+                self.emit(out, 'param', frame[2:])
+            elif frame[0] == TELEM_PARAM_COMMIT and length == PARAM_COMMIT_PAYLOAD.size:
+                self.emit(out, 'commit', frame[2:])
+            elif frame[0] == TELEM_LIMIT and length == LIMIT_PAYLOAD.size:
+                self.emit(out, 'limit', frame[2:])
+            elif frame[0] == TELEM_TRACK_ACK and length == TRACK_ACK_PAYLOAD.size:
+                self.emit(out, 'trackack', frame[2:])
+        return out
+
+    def emit(self, out, kind, value):
+        out.append((self.rxunit, kind, value))
+
 
 class UART_START:
+    """MCU 하나와의 시리얼 링크. MCU가 구동하는 터렛(unit)마다 Turret 하나를 두고,
+    포트를 읽고 쓰는 것은 이 노드뿐이다."""
+
     def __init__(self):
         rospy.init_node('rasptostm', anonymous=True)
-        
-        # 구독자 및 발행자 설정
-        self.coordinate_sub = rospy.Subscriber('/bird_detection_2/angles', Point, self.callback)
-        self.shooting_done_pub = rospy.Publisher('/shooting_done', Int32, queue_size=10)
-        
-        # 시리얼 포트 설정
-        self.ser = serial.Serial("/dev/ttyUSB1", baudrate=115200, timeout=1)
+
+        # 펌웨어 DWT 프로브: rostopic pub -1 /bird_turret/prof std_msgs/Int32 1 → 로그로 출력
+        self.prof_sub = rospy.Subscriber('/bird_turret/prof', Int32, self.prof_callback)
+        # 프로브 초기화 시각과 덤프가 덮는 구간 [s]: awake 프로브로 MCU가 깨어 있던 비율 계산
+        self.prof_reset = None
+        self.prof_window = None
+        # FreeRTOS 빌드의 태스크별 CPU %, 스택 여유, 힙 최소 여유, 블록 횟수 → 로그로 출력
+        self.rtos_sub = rospy.Subscriber('/bird_turret/rtos_stats', Empty, self.rtos_callback)
+        self.rtos_tasks = []
+        self.rtos_last = None
+
+        # 시리얼 포트 설정 (가상 MCU를 쓸 때는 ~port를 vmcu의 pty로 지정)
+        port = rospy.get_param('~port', '/dev/ttyUSB1')
+        baud = rospy.get_param('~baud', 115200)
+        self.ser = serial.Serial(port, baudrate=baud, timeout=0.05)
         rospy.on_shutdown(self.cleanup)
-        
-        # 주기적으로 UART를 읽어오는 타이머 설정
-        self.rx_thread = rospy.Timer(rospy.Duration(0.1), self.read_uart)
+        self.tx_lock = threading.Lock()
+        self.parser = TelemetryParser()
+        # CMDTRACK: turretsim의 모든 시나리오에서 MOVEOP보다 빨리 잡음, false면 MOVEOP
+        self.track = rospy.get_param('~track', True)
+        # detection_1이 새를 보는 즉시 발사 모터를 미리 돌려 첫 발까지의 스핀업을 줄인다
+        self.prespin = rospy.get_param('~prespin', True)
+        self.prespin_period = rospy.get_param('~prespin_period', 0.5)
+        # MCU 틱 동기: 텔레메트리 수신 시각 - 틱의 최솟값 (가장 덜 지연된 프레임 기준, 최근 1초)
+        self.clock_offsets = collections.deque(maxlen=200)
 
-    def callback(self, data):
+        # 런타임 메트릭 (birdtop): 링크 전체의 것, 터렛별 항목은 Turret에
+        self.metrics = bird_metrics.serve('rasptostm')
+        self.tx_errors = self.metrics.counter('serial_errors_total', '시리얼 읽기/쓰기 오류')
+        self.metrics.counter('link_crc_errors_total', 'crc가 틀린 MCU 프레임', fn=lambda: self.parser.crc_errors)
+        self.telem_frames = self.metrics.counter('telemetry_total', '받은 텔레메트리 프레임')
+        self.metrics.gauge('queue_serial_tx', '시리얼 송신 버퍼 [byte]', fn=lambda: self.ser.out_waiting)
+        self.metrics.gauge('queue_serial_rx', '시리얼 수신 버퍼 [byte]', fn=lambda: self.ser.in_waiting)
+
+        # MCU 하나에 터렛이 여러 대(TURRETS)면 ~units로 그 수를 준다. MCU의 명령 대상 선택(CMD_UNIT)은
+        # 하나뿐이라 터렛이 둘 이상이면 명령마다 CMD_UNIT을 앞에 붙인다
+        self.nunits = rospy.get_param('~units', 1)
+        self.units = [Turret(self, unit) for unit in range(self.nunits)]
+        for turret in self.units:
+            turret.configure()
+
+        # 텔레메트리가 200Hz로 들어오므로 타이머 대신 수신 스레드에서 계속 읽는다
+        self.rx_thread = threading.Thread(target=self.read_uart)
+        self.rx_thread.daemon = True
+        self.rx_thread.start()
+        for turret in self.units:
+            turret.load_params()
+
+    def send(self, unit, data):
+        """unit 터렛에 가는 명령 전송, tx_lock을 잡은 채로 부른다."""
+        if self.nunits > 1:
+            data = make_frame(CMD_UNIT, bytes([unit])) + data
+        self.ser.write(data)
+
+    def mcu_millis(self, t):
+        """호스트 시각 t [s]를 MCU 틱 [ms]으로, 텔레메트리가 없으면 None."""
+        if not self.clock_offsets:
+            return None
+        return int(round((t - min(self.clock_offsets)) * 1000)) & 0xffffffff
+
+    def prof_callback(self, data):
+        now = rospy.get_time()
+        if data.data & 0x01 and self.prof_reset is not None:
+            self.prof_window = now - self.prof_reset
+        if data.data & 0x02:
+            self.prof_reset = now
         try:
-            data.x=data.x/320*127 
-            data.y=data.y/240*127 
-            # X, Y, Z 값을 1바이트로 변환 320x240 픽셀에서 uart로 1바이트 전송하기 때문.
-            x = int(data.x).to_bytes(1, 'big', signed=True)
-            y = int(data.y).to_bytes(1, 'big', signed=True)
-            z = int(data.z).to_bytes(1, 'big', signed=True)
-            
-            # x, y, z가 모두 0이 아닐 경우에만 전송
-            if x != b'\x00' or y != b'\x00' or z != b'\x00':
-                # z, x, y, 1 순서로 전송
-                self.ser.write(z)
-                self.ser.write(x)
-                self.ser.write(y)
-                self.ser.write(b'\x02')  # 1을 추가로 전송
-                
-                rospy.loginfo(f'좌표를 int8로 전송함: Z={z[0]}, X={x[0]}, Y={y[0]}, 상수=1')
-            else:
-                rospy.loginfo("좌표가 (0, 0, 0)입니다. 데이터가 전송되지 않았습니다.")
+            with self.tx_lock:
+                self.ser.write(make_frame(CMD_PROF, bytes([data.data & 0x03])))
         except Exception as e:
             rospy.logerr(f'시리얼 포트로 전송 중 오류 발생: {e}')
 
-    def read_uart(self, event):
+    def rtos_callback(self, _):
         try:
-            if self.ser.in_waiting > 0:
-                # 1바이트의 데이터 읽기
-                byte_data = self.ser.read(1)
-                byte_value = ord(byte_data)  # 바이트를 정수로 변환
-                
-                # 수신된 데이터를 /shooting_done 토픽으로 발행
-                self.shooting_done_pub.publish(byte_value)
-                
-                rospy.loginfo(f'수신된 바이트를 /shooting_done으로 발행함: {byte_value}')
+            with self.tx_lock:
+                self.ser.write(make_frame(CMD_RTOS_STATS, b''))
         except Exception as e:
-            rospy.logerr(f'시리얼 포트에서 읽는 중 오류 발생: {e}')
+            rospy.logerr(f'시리얼 포트로 전송 중 오류 발생: {e}')
+
+    def log_commit(self, payload):
+        ok, erased, seq, used, size = PARAM_COMMIT_PAYLOAD.unpack(payload)
+        if ok:
+            rospy.loginfo(f'param 플래시 저장 #{seq}{" (섹터 지움)" if erased else ""}, '
+                          f'{used}/{size} B 사용')
+        else:
+            rospy.logerr('param 플래시 저장 실패' if size else 'param: MCU에 플래시 섹터 없음')
+
+    def log_rtos(self, kind, payload):
+        if kind == 'task':
+            self.rtos_tasks.append(TASK_PAYLOAD.unpack(payload))
+            return
+        total, heapfree, heapmin, *blocks = RTOS_PAYLOAD.unpack(payload)
+        tasks, self.rtos_tasks = self.rtos_tasks, []
+        # CPU %는 리셋 이후 누적과 지난 요청 이후 구간 두 가지
+        last = self.rtos_last or (0, {}, [0] * 4)
+        runtimes = {}
+        dtotal = (total - last[0]) & 0xffffffff or 1
+        for _, ntasks, name, prio, state, stackfree, runtime in tasks:
+            name = name.rstrip(b'\0').decode(errors='replace')
+            runtimes[name] = runtime
+            drun = (runtime - last[1].get(name, 0)) & 0xffffffff
+            rospy.loginfo(f'rtos {name:16s} prio={prio} {TASK_STATES[min(state, 4)]:9s} '
+                          f'cpu={100.0 * runtime / max(total, 1):5.1f}% '
+                          f'(recent {100.0 * drun / dtotal:5.1f}%) '
+                          f'stack free min={stackfree} words ({stackfree * 4} B)')
+        dblocks = [(b - l) & 0xffffffff for b, l in zip(blocks, last[2])]
+        rospy.loginfo(f'rtos heap free={heapfree} B min ever={heapmin} B, blocks '
+                      f'queue recv/send={blocks[0]}/{blocks[1]} stream={blocks[2]} '
+                      f'notify={blocks[3]} (recent {"/".join(map(str, dblocks))}), '
+                      f'{total / 1e5:.1f}s run time')
+        self.rtos_last = (total, runtimes, blocks)
+
+    def log_prof(self, payload):
+        (probe, nprobes, sched, name, count, cmin, cmax, mean,
+         *hist) = PROF_PAYLOAD.unpack(payload)
+        sched = SCHED_NAMES[sched] if sched < len(SCHED_NAMES) else str(sched)
+        name = name.rstrip(b'\0').decode(errors='replace')
+        us = lambda c: c / MCU_HZ * 1e6
+        # 비어 있지 않은 칸만: [2^i, 2^(i+1)) 사이클
+        buckets = ' '.join(f'2^{i}:{n}' for i, n in enumerate(hist) if n)
+        rospy.loginfo(f'prof[{sched}] {probe + 1}/{nprobes} {name:8s} n={count} cycles min/mean/max='
+                      f'{cmin}/{mean}/{cmax} ({us(cmin):.2f}/{us(mean):.2f}/{us(cmax):.2f}us) '
+                      f'{buckets}')
+        if name == 'awake' and self.prof_window:
+            # 나머지는 WFI로 잠든 시간: 유휴 전류가 줄어든 정도
+            rospy.loginfo(f'prof[{sched}] awake {count * mean / MCU_HZ / self.prof_window * 100:.1f}% '
+                          f'of {self.prof_window:.1f}s, {count / self.prof_window:.0f} wake-ups/s')
+
+    def read_uart(self):
+        while not rospy.is_shutdown():
+            try:
+                data = self.ser.read(max(1, self.ser.in_waiting))
+            except Exception as e:
+                self.tx_errors.inc()
+                rospy.logerr(f'시리얼 포트에서 읽는 중 오류 발생: {e}')
+                rospy.sleep(0.1)
+                continue
+            for unit, kind, value in self.parser.feed(data):
+                if kind == 'prof':
+                    self.log_prof(value)
+                elif kind in ('task', 'rtos'):
+                    self.log_rtos(kind, value)
+                elif kind == 'commit':
+                    self.log_commit(value)
+                elif unit < self.nunits:
+                    self.units[unit].on_frame(kind, value)
+                else:
+                    rospy.logwarn_throttle(5, f'~units={self.nunits}인데 unit {unit}의 {kind} 수신')
 
     def cleanup(self):
         self.ser.close()
@@ -63,6 +325,347 @@ class UART_START:
     def run(self):
         rospy.spin()
 
+
+class Turret:
+    """MCU의 터렛 하나(unit): 토픽, 설정, 보낸 명령의 지연 추적.
+    unit 0은 기존 토픽 이름을 쓰고, unit n은 /bird_turret/unit<n>/ 아래에 같은 이름으로 둔다
+    (감지 입력은 .../detection, 선회전은 .../is_triggered, 다른 이름은 launch의 remap으로).
+    설정 파라미터는 ~unit<n>/ 아래에서 먼저 찾고 없으면 ~ 아래의 공통 값을 쓴다."""
+
+    def __init__(self, link, unit):
+        self.link = link
+        self.unit = unit
+        ns = '/bird_turret' if unit == 0 else f'/bird_turret/unit{unit}'
+        self.param_ns = '~' if unit == 0 else f'~unit{unit}/'
+
+        # 구독자 및 발행자 설정
+        self.coordinate_sub = rospy.Subscriber(
+            '/bird_detection_2/detection' if unit == 0 else f'{ns}/detection', BirdDetection, self.callback)
+        # 절대 조준: pan, tilt [deg], 텔레메트리와 같은 중앙 기준
+        self.aim_sub = rospy.Subscriber(f'{ns}/aim', Aim, self.aim_callback)
+        self.aim_done_pub = rospy.Publisher(f'{ns}/aim_done', TurretAimDone, queue_size=10)
+        # 목표가 서보 범위 밖에 계속 있어 축이 한계에서 물러났을 때: 로봇 위치를 바꾸라는 신호
+        self.limit_pub = rospy.Publisher(f'{ns}/limit', TurretLimit, queue_size=10)
+        # 연사 유지(burst_hold) 중 명시적으로 중앙 복귀
+        self.center_sub = rospy.Subscriber(f'{ns}/center', Empty, self.center_callback)
+        self.last_spin = 0.0
+        self.detect_sub = rospy.Subscriber(
+            '/detection_1/is_triggered' if unit == 0 else f'{ns}/is_triggered', Int32, self.detect_callback)
+        self.shooting_done_pub = rospy.Publisher(
+            '/shooting_done' if unit == 0 else f'{ns}/shooting_done', Int32, queue_size=10)
+        self.telemetry_pub = rospy.Publisher(f'{ns}/telemetry', TurretTelemetry, queue_size=50)
+        # CMDTRACK으로 보낸 감지가 서보에 반영될 때마다 카메라부터 CCR까지의 단계별 시각
+        self.track_ack_pub = rospy.Publisher(f'{ns}/track_ack', TrackAck, queue_size=50)
+        # 보낸 CMDTRACK stamp -> (감지 메시지, 시리얼 전송 시각), ack을 기다리는 것
+        self.track_sent = collections.OrderedDict()
+
+        # 명령 지연 계산용: 전송한 MOVEOP 개수와 전송 시각
+        self.tx_moves = 0
+        self.tx_times = collections.deque(maxlen=256)
+        self.last_rx_moves = None
+        self.command_lag = 0.0
+        self.aim_id = 0
+        self.aim_times = {}
+
+        # 런타임 메트릭 (birdtop): 받은 감지, MCU가 버린 프레임, 감지 발행 → 시리얼 전송 지연, 큐 깊이
+        metrics = link.metrics
+        labels = {'unit': str(unit)} if link.nunits > 1 else None
+        self.frames = metrics.counter('frames_total', '받은 감지 (/bird_detection_2/detection)', labels)
+        self.dropped = metrics.counter('frames_dropped_total', 'MCU가 이전 명령이 바빠 버린 프레임 (rx_dropped)',
+                                       labels)
+        self.latency = metrics.histogram('latency_seconds', '감지 발행 → 시리얼 전송 [s]', labels)
+        metrics.gauge('queue_track_acks', 'TrackAck을 기다리는 CMDTRACK', labels, fn=lambda: len(self.track_sent))
+        self.mcu_pending = metrics.gauge('queue_mcu_moves', 'MCU가 아직 보지 못한 이동 명령', labels)
+        self.last_rx_dropped = None
+
+        # MCU 파라미터 테이블: name -> (id, type, 원시 값). 응답이 없으면(구 펌웨어) cfg 기본값만 보여준다
+        self.params = {}
+        self.params_ready = threading.Event()
+        self.param_server = None
+
+    def param(self, name, default):
+        return rospy.get_param(self.param_ns + name, rospy.get_param('~' + name, default))
+
+    def has_param(self, name):
+        return rospy.has_param(self.param_ns + name) or rospy.has_param('~' + name)
+
+    def configure(self):
+        """시작할 때 한 번 보내는 설정, 수신 스레드를 띄우기 전에 부른다."""
+        # 트리거 파형 [[CCR1, ms], ...], 지정하지 않으면 펌웨어 기본값(TRIGTABLE)
+        trig_table = self.param('trig_table', None)
+        if trig_table:
+            payload = b''.join(TRIG_STEP.pack(int(ccr), int(ms)) for ccr, ms in trig_table)
+            self.link.send(self.unit, make_frame(CMD_TRIG_TABLE, payload))
+
+        # 서보 보정 테이블: ~phi_lut/~tht_lut = {start_deg, step_deg, ccr: [...]}, 각도별로 측정한 TIM3 CCR
+        for axis, index in SERVO_AXES.items():
+            lut = self.param(f'{axis}_lut', None)
+            if lut:
+                payload = CMD_SERVO_LUT_HEAD.pack(index, int(round(lut['start_deg'] * 1e6)),
+                                                  int(round(lut['step_deg'] * 1e6)))
+                payload += b''.join(struct.pack('<H', int(ccr)) for ccr in lut['ccr'])
+                self.link.send(self.unit, make_frame(CMD_SERVO_LUT, payload))
+
+        # 연사: 발사 횟수, 간격, 쿨다운, 연사 후 조준 유지와 추적 상실 판단 시간
+        if self.has_param('burst_shots') or self.has_param('burst_hold'):
+            payload = CMD_BURST_PAYLOAD.pack(
+                self.param('burst_shots', 1),
+                int(self.param('burst_hold', False)),
+                self.param('burst_interval_ms', 200),
+                self.param('cooldown_ms', 1000),
+                self.param('track_loss_ms', 1000))
+            self.link.send(self.unit, make_frame(CMD_BURST, payload))
+
+        # 발사 모터: 정속 duty, soft-start 시간, 마지막 사용 후 유지 시간
+        if self.has_param('motor_duty') or self.has_param('motor_idle_ms'):
+            payload = CMD_MOTOR_CFG_PAYLOAD.pack(
+                int(self.param('motor_duty', 1000)),
+                self.param('motor_ramp_ms', 300),
+                self.param('motor_idle_ms', 3000))
+            self.link.send(self.unit, make_frame(CMD_MOTOR_CFG, payload))
+
+    def load_params(self):
+        """MCU 파라미터 테이블을 읽고 dynamic_reconfigure 서버를 띄운다 (unit n은 ~unit<n>)."""
+        with self.link.tx_lock:
+            self.link.send(self.unit, make_frame(CMD_PARAM_GET, bytes([PARAM_ALL])))
+        if not self.params_ready.wait(1.0):
+            rospy.logwarn(f'MCU 파라미터 테이블 응답 없음 (unit {self.unit})')
+        namespace = '' if self.unit == 0 else rospy.resolve_name(f'~unit{self.unit}')
+        self.param_server = Server(TurretConfig, self.param_callback, namespace)
+
+    def on_frame(self, kind, value):
+        if kind == 'telem':
+            self.publish_telemetry(value)
+        elif kind == 'aimdone':
+            self.publish_aim_done(value)
+        elif kind == 'param':
+            self.on_param(value)
+        elif kind == 'limit':
+            self.publish_limit(value)
+        elif kind == 'trackack':
+            self.publish_track_ack(value)
+        else:
+            # 수신된 데이터를 /shooting_done 토픽으로 발행
+            self.shooting_done_pub.publish(value)
+            rospy.loginfo(f'수신된 바이트를 {self.shooting_done_pub.resolved_name}으로 발행함: {value}')
+
+    def callback(self, data):
+        self.frames.inc()
+        link = self.link
+        try:
+            # X, Y, Z 값을 1바이트로 변환 320x240 픽셀에서 uart로 1바이트 전송하기 때문.
+            x = int(data.error_x / 320 * 127).to_bytes(1, 'big', signed=True)
+            y = int(data.error_y / 240 * 127).to_bytes(1, 'big', signed=True)
+            move = x != b'\x00' or y != b'\x00'
+
+            # 오차가 0이 아니면 보정 전송 (모두 0: 새가 없는 프레임). 발사 프레임도 오차를
+            # 먼저 보내고 TRIGOP을 붙인다: 발사 구간에서 보정을 멈추면 그 거리에서 멈춰 빗나감
+            if move or data.shoot:
+                # 카메라 프레임 시각, 스탬프가 없는 발행자면 받은 시각
+                camera = data.header.stamp.to_sec() or rospy.get_time()
+                stamp = link.mcu_millis(camera)
+                # z, x, y, 1 순서로 전송
+                with link.tx_lock:
+                    if move and link.track and stamp is not None:
+                        link.send(self.unit, make_frame(CMD_TRACK, CMD_TRACK_PAYLOAD.pack(
+                            stamp, int.from_bytes(x, 'big', signed=True),
+                            int.from_bytes(y, 'big', signed=True))))
+                        self.track_sent[stamp] = (data, rospy.Time.now())
+                        while len(self.track_sent) > 64:
+                            self.track_sent.popitem(last=False)
+                    elif move:
+                        link.send(self.unit, bytes([MOVEOP]) + x + y + b'\x02')  # 끝에 ENDOFDATA(2) 전송
+                    if move:
+                        self.tx_moves = (self.tx_moves + 1) & 0xffff
+                        self.tx_times.append((self.tx_moves, rospy.get_time()))
+                    if data.shoot:
+                        link.send(self.unit, bytes([TRIGOP]) + x + y + b'\x02')
+                if not data.hops.publish.is_zero():
+                    self.latency.observe((rospy.Time.now() - data.hops.publish).to_sec())
+        except Exception as e:
+            link.tx_errors.inc()
+            rospy.logerr_throttle(5, f'시리얼 포트로 전송 중 오류 발생: {e}')
+
+    def aim_callback(self, data):
+        try:
+            with self.link.tx_lock:
+                self.aim_id = (self.aim_id + 1) & 0xff
+                payload = CMD_AIM_PAYLOAD.pack(self.aim_id, int(round(data.pan * 1e6)),
+                                               int(round(data.tilt * 1e6)))
+                self.link.send(self.unit, make_frame(CMD_AIM, payload))
+                self.aim_times[self.aim_id] = rospy.get_time()
+            rospy.loginfo(f'절대 조준 전송: unit={self.unit}, id={self.aim_id}, '
+                          f'pan={data.pan:.3f}, tilt={data.tilt:.3f}')
+        except Exception as e:
+            rospy.logerr(f'시리얼 포트로 전송 중 오류 발생: {e}')
+
+    def center_callback(self, _):
+        try:
+            with self.link.tx_lock:
+                self.link.send(self.unit, make_frame(CMD_CENTER, b''))
+        except Exception as e:
+            rospy.logerr(f'시리얼 포트로 전송 중 오류 발생: {e}')
+
+    def detect_callback(self, data):
+        # 감지 중에는 프레임마다 들어오므로 유지 시간만 갱신하도록 prespin_period마다 보낸다
+        if not self.link.prespin or data.data != 1:
+            return
+        now = rospy.get_time()
+        if now - self.last_spin < self.link.prespin_period:
+            return
+        self.last_spin = now
+        try:
+            with self.link.tx_lock:
+                self.link.send(self.unit, make_frame(CMD_SPIN, b'\x01'))
+        except Exception as e:
+            rospy.logerr(f'시리얼 포트로 전송 중 오류 발생: {e}')
+
+    def param_callback(self, config, level):
+        if self.param_server is None:
+            # 첫 호출: 서버가 cfg 기본값 대신 MCU의 현재 값을 보여주도록
+            for name, (_, ptype, raw) in self.params.items():
+                if name in config:
+                    config[name] = struct.unpack(PARAM_VALUE[ptype], raw)[0]
+            config.commit = False
+            return config
+        try:
+            with self.link.tx_lock:
+                for name, (pid, ptype, raw) in self.params.items():
+                    if name not in config:
+                        continue
+                    value = struct.pack(PARAM_VALUE[ptype],
+                                        config[name] if ptype == PARAM_FLOAT else int(config[name]))
+                    if value != raw:
+                        self.link.send(self.unit, make_frame(CMD_PARAM_SET, bytes([pid]) + value))
+                if config.commit:
+                    # 모든 unit의 값을 함께 저장
+                    self.link.ser.write(make_frame(CMD_PARAM_COMMIT, b''))
+        except Exception as e:
+            rospy.logerr(f'시리얼 포트로 전송 중 오류 발생: {e}')
+        config.commit = False
+        return config
+
+    def on_param(self, payload):
+        pid, count, ptype, status, name, *raws = PARAM_PAYLOAD.unpack(payload)
+        name = name.rstrip(b'\0').decode(errors='replace')
+        raw = struct.pack('<I', raws[0])
+        fmt = PARAM_VALUE[min(ptype, 1)]
+        value = struct.unpack(fmt, raw)[0]
+        if status != 0:
+            # 거부된 설정: MCU 값으로 reconfigure 쪽을 되돌린다
+            rospy.logwarn(f'param {name or pid} 설정 거부 (unit {self.unit}): '
+                          f'{PARAM_STATUS[status] if status < len(PARAM_STATUS) else status}, '
+                          f'MCU 값 {value}')
+        elif self.params.get(name, (None, None, raw))[2] != raw:
+            rospy.loginfo(f'param {name} = {value} (unit {self.unit})')
+        if not name:
+            return
+        self.params[name] = (pid, ptype, raw)
+        if len(self.params) >= count:
+            self.params_ready.set()
+        if status != 0 and self.param_server is not None:
+            self.param_server.update_configuration({name: value})
+
+    def publish_telemetry(self, payload):
+        (tick, seq, phipos, thtpos, phitarget, thttarget, trigprogress,
+         shotflag, boundcnt, flags, rxmoves, rxtrigs, rxdropped,
+         rxerrors, shots, sweep, searches) = TELEM_PAYLOAD.unpack(payload)
+        now = rospy.get_time()
+        self.link.clock_offsets.append(now - tick / 1000.0)
+        self.link.telem_frames.inc()
+        if self.last_rx_dropped is not None:
+            self.dropped.inc((rxdropped - self.last_rx_dropped) & 0xffff)
+        self.last_rx_dropped = rxdropped
+        with self.link.tx_lock:
+            # MCU가 처음으로 rxmoves번째 명령을 보고한 시점 - 그 명령의 전송 시점
+            if rxmoves != self.last_rx_moves:
+                while self.tx_times and ((rxmoves - self.tx_times[0][0]) & 0xffff) < 0x8000:
+                    count, sent = self.tx_times.popleft()
+                    if count == rxmoves:
+                        self.command_lag = now - sent
+                self.last_rx_moves = rxmoves
+            pending = (self.tx_moves - rxmoves) & 0xffff
+        msg = TurretTelemetry()
+        msg.header.stamp = rospy.Time.from_sec(now)
+        msg.mcu_tick = tick
+        msg.seq = seq
+        msg.phi_udeg = phipos
+        msg.tht_udeg = thtpos
+        msg.phi_target_udeg = phitarget
+        msg.tht_target_udeg = thttarget
+        msg.trig_progress = trigprogress
+        msg.shot_active = bool(shotflag)
+        msg.bound_count = boundcnt
+        msg.motor_on = bool(flags & TELEM_FLAG_MOTOR)
+        msg.move_pending = bool(flags & TELEM_FLAG_MOVE)
+        msg.aim_active = bool(flags & TELEM_FLAG_AIM)
+        msg.holding = bool(flags & TELEM_FLAG_HOLD)
+        msg.motor_spun = bool(flags & TELEM_FLAG_SPUN)
+        msg.phi_saturated = bool(flags & TELEM_FLAG_PHISAT)
+        msg.tht_saturated = bool(flags & TELEM_FLAG_THTSAT)
+        msg.limit_hold = bool(flags & TELEM_FLAG_LIMIT)
+        msg.rx_moves = rxmoves
+        msg.rx_triggers = rxtrigs
+        msg.rx_dropped = rxdropped
+        msg.rx_errors = rxerrors
+        msg.shots = shots
+        msg.search_sweep = sweep
+        msg.searches = searches
+        msg.pending_moves = pending if pending < 0x8000 else 0
+        self.mcu_pending.set(msg.pending_moves)
+        msg.command_lag = self.command_lag
+        self.telemetry_pub.publish(msg)
+
+    def publish_aim_done(self, payload):
+        aim_id, status, phipos, thtpos = AIMDONE_PAYLOAD.unpack(payload)
+        now = rospy.get_time()
+        with self.link.tx_lock:
+            sent = self.aim_times.pop(aim_id, None)
+        msg = TurretAimDone()
+        msg.header.stamp = rospy.Time.from_sec(now)
+        msg.id = aim_id
+        msg.arrived = status in (AIM_ARRIVED, AIM_LIMITED)
+        msg.limited = status == AIM_LIMITED
+        msg.phi_udeg = phipos
+        msg.tht_udeg = thtpos
+        msg.round_trip = now - sent if sent is not None else 0.0
+        self.aim_done_pub.publish(msg)
+
+    def publish_limit(self, payload):
+        sides, phipos, thtpos = LIMIT_PAYLOAD.unpack(payload)
+        msg = TurretLimit()
+        msg.header.stamp = rospy.Time.from_sec(rospy.get_time())
+        msg.phi_low = bool(sides & LIMIT_PHILO)
+        msg.phi_high = bool(sides & LIMIT_PHIHI)
+        msg.tht_low = bool(sides & LIMIT_THTLO)
+        msg.tht_high = bool(sides & LIMIT_THTHI)
+        msg.phi_udeg = phipos
+        msg.tht_udeg = thtpos
+        self.limit_pub.publish(msg)
+        rospy.logwarn(f'서보 한계에서 물러남: unit={self.unit}, sides=0x{sides:02x}, '
+                      f'pan={phipos / 1e6:.2f}, tilt={thtpos / 1e6:.2f} deg')
+
+    def publish_track_ack(self, payload):
+        stamp, rxtick, setcycles, ccrcycles = TRACK_ACK_PAYLOAD.unpack(payload)
+        with self.link.tx_lock:
+            sent = self.track_sent.pop(stamp, None)
+        if sent is None or not self.link.clock_offsets:
+            return
+        detection, bridge_tx = sent
+        msg = TrackAck()
+        msg.header = detection.header
+        msg.mcu_stamp = stamp
+        msg.set_latency = setcycles / MCU_HZ
+        msg.ccr_latency = ccrcycles / MCU_HZ
+        msg.hops = detection.hops
+        msg.hops.bridge_tx = bridge_tx
+        # MCU 틱 → 호스트 시각 (mcu_millis의 역), CCR은 수신 시각에 사이클 차이를 더한다
+        mcu_rx = rxtick / 1000.0 + min(self.link.clock_offsets)
+        msg.hops.mcu_rx = rospy.Time.from_sec(mcu_rx)
+        msg.hops.ccr_applied = rospy.Time.from_sec(mcu_rx + msg.ccr_latency)
+        self.track_ack_pub.publish(msg)
+
+
 if __name__ == '__main__':
     my_uart = UART_START()
     my_uart.run()
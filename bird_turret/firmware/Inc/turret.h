@@ -0,0 +1,145 @@
+/**
+ ******************************************************************************
+ * @file    turret.h
+ * @brief   Turret application: ties protocol, control and trigger together.
+ *
+ * The target wires its interrupts to these entry points, turret_sched.h
+ * runs the rest in the execution model of the build:
+ *   UART rx complete   -> sched_rxbyte() -> turret_rxbyte()
+ *   UART error         -> turret_rxerror()
+ *   trigger timer      -> turret_trigtick(out)
+ *   cooldown timer     -> turret_cooldown(out)
+ *   TICKHZ timer       -> sched_tick() -> turret_tick()
+ *   main loop or task  -> turret_poll()
+ *
+ * The TICKHZ timer only runs while something moves: turret_tick() stops it
+ * once every unit has settled, turret_poll() starts it again when a
+ * command, a recenter or a search gives the tick work.
+ *
+ * One host link serves the TURRETS units of turret_unit.h; everything that
+ * moves or fires lives in a TurretUnit, the link and its tx queue in Turret.
+ ******************************************************************************
+ */
+#ifndef __TURRET_H
+#define __TURRET_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "turret_ctrl.h"
+#include "turret_dbuf.h"
+#include "turret_limit.h"
+#include "turret_motor.h"
+#include "turret_param.h"
+#include "turret_prof.h"
+#include "turret_proto.h"
+#include "turret_search.h"
+#include "turret_servo.h"
+#include "turret_traj.h"
+#include "turret_track.h"
+#include "turret_trig.h"
+#include "turret_unit.h"
+
+typedef struct {
+  int id; // index in turret_units
+  const UnitDesc *desc;
+  Ctrl ctrl;
+  SetpointBuf setpoint; // ctrl targets as turret_poll() left them
+  Trig trig;
+  Motor motor; // launcher dc motor
+  Traj phitraj, thttraj; // from the ctrl targets, in counts from center
+  int32_t tickphi, ticktht; // ctrl targets the last tick stepped towards
+  Servo phiservo, thtservo;
+  volatile int remap; // new servo ranges or table, the tick writes again
+  volatile int moveflag;
+  int8_t movex, movey;    // of the MOVEOP frame moveflag stands for
+  volatile int trackflag; // CMDTRACK received, turret_poll() filters it
+  uint32_t trackstamp;    // and its frame
+  int8_t trackx, tracky;
+  uint32_t trackrx;       // rxstamp of the CMDTRACK
+  uint32_t trackrxtick;   // thal_millis() then
+  volatile int trackacking; // its setpoint is set, CCR write not timed yet
+  uint32_t ackstamp, ackrxtick, ackset, ackccr; // of the TrackAck to send
+  volatile int ackpending;
+  TrackAck tracktx;
+  Track track;
+  volatile int paramflag; // CMDPARAMSET received, turret_poll() applies it
+  int paramid;            // and its parameter
+  ParamValue paramval;
+  volatile int lutflag;   // CMDSERVOLUT received, turret_poll() loads it
+  uint8_t lutaxis;        // and its table
+  int32_t lutstart, lutstep;
+  uint16_t lutccr[SERVOLUTMAX];
+  int lutn;
+  volatile int applying; // settings half written, the tick holds the unit
+  volatile int aimflag;  // CMDAIM received, turret_poll() applies it
+  int32_t aimphi, aimtht; // and its target
+  uint8_t aimnext;        // id
+  volatile int aiming;   // slewing to an absolute aim, AimDone not sent yet
+  uint8_t aimid;         // id of the aim in progress
+  volatile int aimpending;
+  AimDone aimdone;
+  volatile int boundcnt; // saturated frames left before giving up
+  Limit limit;
+  volatile int aimlimited; // the aim in progress was clamped
+  volatile int limitpending;
+  LimitFrame limittx;
+  int hold;                    // stay on target after a burst (CMDBURST)
+  uint32_t losstimeout;        // ms without move/aim that ends a hold
+  volatile int holding;        // engaged, recenter on CMDCENTER or track loss
+  volatile int centerflag;     // CMDCENTER or burst end: recenter in poll
+  volatile uint32_t lasttrack; // thal_millis() of the last move/aim/trigger
+  volatile int engaged; // following a target: search once it goes quiet
+  Search search;
+  volatile uint16_t searches; // spirals started
+  volatile uint16_t shots;     // trigger cycles fired
+  volatile int respending;
+  uint8_t resbuf;
+} TurretUnit;
+
+typedef struct {
+  Proto proto;
+  TurretUnit unit[TURRETS];
+  volatile int rxunit; // CMDUNIT: the unit commands go to
+  uint16_t polldropped; // rejected by turret_poll(), reported in rxdropped
+  int txunit;          // of the last frame sent, TELEMUNIT before another
+  UnitFrame unittx;
+  uint32_t telemtick;
+  int telemunit; // reports next
+  int telemetry; // 0 disables the periodic status frame
+  Telemetry telem;
+  volatile int profnext;  // next probe to send (CMDPROF), PROF_NPROBES: none
+  volatile int profreset; // clear the probes once they are sent
+  ProfFrame proftx;
+  volatile int osnext; // next thal_osframe() to send (CMDRTOSSTATS), -1: none
+  uint32_t rxstamp;    // thal_cycles() in the rx isr of the byte being parsed
+  volatile uint32_t cmdstamp; // rxstamp of the last move/aim
+  volatile int cmdpending;    // its setpoint is set, CCR write not timed yet
+  volatile int ticking;       // TICKHZ timer running (thal_ticktimer())
+  Params params;               // live values, CMDPARAMSET in turret_poll()
+  volatile int paramunit;           // of the ParamFrames
+  volatile int paramnext, paramend; // ParamFrames still to send
+  volatile int paramstatus;         // of the last CMDPARAMSET
+  ParamFrame paramtx;
+  volatile int commitflag;    // CMDPARAMCOMMIT, turret_poll() writes flash
+  volatile int commitpending; // committx waiting for tx
+  ParamCommitFrame committx;
+} Turret;
+
+extern Turret turret;
+
+void turret_init(void);
+void turret_rxbyte(uint8_t byte);
+void turret_rxerror(void);
+// out: the thal trigger output whose timer expired
+void turret_trigtick(int out);
+void turret_cooldown(int out);
+void turret_tick(void);
+void turret_poll(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TURRET_H */
@@ -0,0 +1,229 @@
+/**
+ ******************************************************************************
+ * @file    turret_config.h
+ * @brief   Compile-time turret constants (TIM3 counts, 3MHz, 20ms period).
+ *
+ * Defaults are the stm32v2 values. A build can override any of them with
+ * -D before this header is included.
+ ******************************************************************************
+ */
+#ifndef __TURRET_CONFIG_H
+#define __TURRET_CONFIG_H
+
+// TIM3: 84MHz / 28 / 60000 = 50Hz. 28 is the smallest prescaler that fits
+// the 20ms frame in the 16 bit counter, one count = 1/3us
+#ifndef TIM3HZ
+#define TIM3HZ 3000000
+#endif
+// servo travel: 500..2500us over 180deg
+#ifndef SERVOUDEGPERUS
+#define SERVOUDEGPERUS 90000
+#endif
+
+#ifndef PHIMAX
+#define PHIMAX 7500
+#endif
+#ifndef PHIMIN
+#define PHIMIN 1500
+#endif
+#ifndef THTMAX
+#define THTMAX 7500
+#endif
+#ifndef THTMIN
+#define THTMIN 4500
+#endif
+#ifndef PHICENTER
+#define PHICENTER (4500 - 10)
+#endif
+#ifndef THTCENTER
+#define THTCENTER (7400 - 10)
+#endif
+#ifndef DFLTPULSE
+#define DFLTPULSE 2100
+#endif
+#ifndef TRIGPULSE
+#define TRIGPULSE 6800
+#endif
+// host frames in a row with a target out of reach before the axis gives
+// up, and how far it backs off the bound then (turret_limit.h)
+#ifndef MAXBOUNDCNT
+#define MAXBOUNDCNT 30
+#endif
+#ifndef LIMITBACKOFF
+#define LIMITBACKOFF 33 // TIM3 counts, 1deg
+#endif
+// pid gains in TIM3 counts per error unit and host frame. The integral
+// does the aiming: about half the error of a frame (7.9 and 5.9 counts per
+// unit, see TRACKKX), which locks at 3-15 host fps with up to ~150ms of
+// camera latency (host/sim/turretsim.c -T). P and D only add overshoot
+// once the frame lags the move, so they are off
+#ifndef KPX
+#define KPX 0.f
+#endif
+#ifndef KIX
+#define KIX 4.f
+#endif
+#ifndef KDX
+#define KDX 0.f
+#endif
+#ifndef KPY
+#define KPY 0.f
+#endif
+#ifndef KIY
+#define KIY 3.f
+#endif
+#ifndef KDY
+#define KDY 0.f
+#endif
+#ifndef PIDRATE
+#define PIDRATE 200 // max pulse change per host frame, counts
+#endif
+
+// CMDTRACK alpha-beta filter (turret_track.h): gains, how long to keep
+// extrapolating after the last camera frame, and the error scale. One host
+// error unit is 320/127 px across and 240/127 px down the 640x480 frame of
+// usb_cam2, about 0.24 and 0.18deg with its 60deg lens
+#ifndef TRACKALPHA
+#define TRACKALPHA .5f
+#endif
+#ifndef TRACKBETA
+#define TRACKBETA .15f
+#endif
+#ifndef TRACKCOASTMS
+#define TRACKCOASTMS 250
+#endif
+#ifndef TRACKKX
+#define TRACKKX 7.9f // counts per error unit
+#endif
+#ifndef TRACKKY
+#define TRACKKY 5.9f
+#endif
+// from a servo pulse to the payload pointing there: half a servo frame
+// until it is latched plus the servo time constant (host/sim/servo_model.h)
+#ifndef TRACKLAGMS
+#define TRACKLAGMS 40
+#endif
+
+// search spiral (turret_search.h): ms of silence on an engaged target
+// before it starts (0: never), radius growth per sweep and speed along the
+// path in TIM3 counts, and the sweeps before giving up. 500 counts is 15deg,
+// a quarter of the usb_cam2 field, so the rings overlap in the image
+#ifndef SEARCHDELAYMS
+#define SEARCHDELAYMS 1500
+#endif
+#ifndef SEARCHPITCH
+#define SEARCHPITCH 500
+#endif
+#ifndef SEARCHRATE
+#define SEARCHRATE 2000 // counts/s, 60deg/s
+#endif
+#ifndef SEARCHSWEEPS
+#define SEARCHSWEEPS 3
+#endif
+
+// servo calibration tables (turret_servo.h): pulse in TIM3 counts at
+// PHILUTSTART + i * PHILUTSTEP udeg, 2..SERVOLUTMAX points, measured on the
+// unit. Undefined: the linear SERVOUDEGPERUS map around PHICENTER. The host
+// can load or clear one at run time (CMDSERVOLUT), e.g.
+//   #define PHILUT {1500, 2250, 3000, ..., 7500}
+//   #define PHILUTSTART -90000000
+//   #define PHILUTSTEP 11250000
+// and the same with THTLUT, THTLUTSTART, THTLUTSTEP
+
+// trigger waveform, {CCR1, ms} steps: pull, release, pull, release. CCR1
+// goes back to DFLTPULSE after the last step, the host can load another
+// table at run time (CMDTRIGTABLE)
+#ifndef TRIGTABLE
+#define TRIGTABLE                                                              \
+  { {TRIGPULSE, 500}, {DFLTPULSE, 500}, {TRIGPULSE, 500}, {DFLTPULSE, 500} }
+#endif
+
+// burst fire, CMDBURST changes these at run time. The default is the old
+// single shot, recenter and 1s cooldown. With BURSTHOLD the turret keeps
+// tracking after the burst and only recenters on CMDCENTER or after
+// TRACKLOSSMS without a move or aim
+#ifndef BURSTSHOTS
+#define BURSTSHOTS 1
+#endif
+#ifndef BURSTINTERVAL
+#define BURSTINTERVAL 200 // ms at rest between cycles
+#endif
+#ifndef COOLDOWNMS
+#define COOLDOWNMS 1000
+#endif
+#ifndef BURSTHOLD
+#define BURSTHOLD 0
+#endif
+#ifndef TRACKLOSSMS
+#define TRACKLOSSMS 1000
+#endif
+
+// launcher motor, CMDMOTORCFG changes these at run time: duty at speed
+// (permille), soft-start ramp from off to that duty, and how long the motor
+// keeps running after the last move, aim, shot or pre-spin (CMDSPIN)
+#ifndef MOTORDUTY
+#define MOTORDUTY 1000
+#endif
+#ifndef MOTORRAMPMS
+#define MOTORRAMPMS 300
+#endif
+#ifndef MOTORIDLEMS
+#define MOTORIDLEMS 3000
+#endif
+
+// control tick (TIM7) and the S-curve limits of each axis in TIM3 counts,
+// 1 count = 0.03deg. vmax is about the servo slew rate (350deg/s); the
+// acceleration and jerk are high enough to keep up with the servo, the
+// shaper below keeps the launcher mount from ringing instead (see
+// host/bench/bench_traj.c)
+#ifndef TICKHZ
+#define TICKHZ 1000
+#endif
+#ifndef PHIVMAX
+#define PHIVMAX 11000.f // counts/s
+#endif
+#ifndef PHIAMAX
+#define PHIAMAX 300000.f // counts/s^2
+#endif
+#ifndef PHIJMAX
+#define PHIJMAX 50000000.f // counts/s^3
+#endif
+#ifndef THTVMAX
+#define THTVMAX 11000.f
+#endif
+#ifndef THTAMAX
+#define THTAMAX 300000.f
+#endif
+#ifndef THTJMAX
+#define THTJMAX 50000000.f
+#endif
+// ringing of the launcher on its mount, measured on the payload after a
+// step (host/sim/servo_model.h): the trajectory is zero-vibration shaped
+// for it (turret_traj.h). 0 turns the shaper off
+#ifndef SHAPEHZ
+#define SHAPEHZ 6.0f
+#endif
+#ifndef SHAPEZETA
+#define SHAPEZETA 0.25f
+#endif
+
+// with several units they take turns, each reports every TURRETS periods
+#ifndef TELEMPERIOD
+#define TELEMPERIOD 5 // ms, 200Hz
+#endif
+
+// units (turret_unit.h): the values above are the one turret on THAL_PHI,
+// THAL_THT, THAL_TRIG and THAL_MOTOR. A board with more turrets builds with
+// -DTURRETS=n and lists them, servo outputs and geometry per axis, trigger
+// and motor outputs and waveform per trigger; its thal maps the outputs to
+// timer channels, e.g. two turrets without calibration tables (on one line
+// or continued with backslashes):
+//   #define TURRETUNITS
+//     {{{0, PHICENTER, PHIMIN, PHIMAX, 0, 0, 0, 0},
+//       {1, THTCENTER, THTMIN, THTMAX, 0, 0, 0, 0},
+//       {0, 0, (const TrigStep[])TRIGTABLE, 4}},
+//      {{2, PHICENTER, PHIMIN, PHIMAX, 0, 0, 0, 0},
+//       {3, THTCENTER, THTMIN, THTMAX, 0, 0, 0, 0},
+//       {1, 1, (const TrigStep[])TRIGTABLE, 4}}}
+
+#endif /* __TURRET_CONFIG_H */
@@ -0,0 +1,49 @@
+/**
+ ******************************************************************************
+ * @file    turret_ctrl.h
+ * @brief   Pan/tilt control law: pixel error -> servo pulse.
+ ******************************************************************************
+ */
+#ifndef __TURRET_CTRL_H
+#define __TURRET_CTRL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "turret_pid.h"
+
+typedef struct {
+  Pid pid;
+  volatile int32_t target; // Q16 TIM3 counts from center, the pid output
+} CtrlAxis;
+
+typedef struct {
+  CtrlAxis phi, tht;
+} Ctrl;
+
+void ctrl_init(Ctrl *c);
+
+// retune one axis in flight (turret_param.h): gains per error unit, the
+// servo bounds as Q16 positions (Servo.lo, hi) and the rate limit in TIM3
+// counts
+void ctrl_tune(CtrlAxis *a, float kp, float ki, float kd, int32_t lo,
+               int32_t hi, int rate);
+
+// back to center, integrators cleared
+void ctrl_reset(Ctrl *c);
+
+// one error frame from the host, updates both targets
+void ctrl_move(Ctrl *c, int phierr, int thterr);
+
+// absolute targets in Q16 counts from center, clamped to the axis limits.
+// Later error frames continue from there
+void ctrl_aim(Ctrl *c, int32_t phi, int32_t tht);
+// the same for one axis, the other keeps tracking
+void ctrl_aimaxis(CtrlAxis *a, int32_t pos);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TURRET_CTRL_H */
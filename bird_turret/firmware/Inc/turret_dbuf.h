@@ -0,0 +1,42 @@
+/**
+ ******************************************************************************
+ * @file    turret_dbuf.h
+ * @brief   Lock-free double buffer for the setpoint handed to the control
+ *          loop.
+ *
+ * One writer (turret_poll()) and one reader (the control tick), no mutex:
+ * the writer fills the slot the reader is not looking at and then
+ * publishes it by bumping seq. A reader that got preempted by two writes
+ * (its slot reused) sees seq move and reads again, so it never returns a
+ * half-written setpoint and never blocks the writer. The tick preempts
+ * the writer in both execution models, never the other way round.
+ ******************************************************************************
+ */
+#ifndef __TURRET_DBUF_H
+#define __TURRET_DBUF_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+typedef struct {
+  int32_t phi, tht; // ctrl targets, Q16 counts from center
+} Setpoint;
+
+typedef struct {
+  Setpoint slot[2];
+  volatile uint32_t seq; // slot[seq & 1] is the published one
+} SetpointBuf;
+
+void dbuf_init(SetpointBuf *b);
+void dbuf_write(SetpointBuf *b, const Setpoint *sp);
+// returns the seq of the setpoint read, unchanged seq = nothing new
+uint32_t dbuf_read(SetpointBuf *b, Setpoint *sp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TURRET_DBUF_H */
@@ -0,0 +1,82 @@
+/**
+ ******************************************************************************
+ * @file    turret_hal.h
+ * @brief   Hardware shim used by the turret logic.
+ *
+ * The turret modules never touch TIM/UART/GPIO registers directly. Each
+ * target implements these functions: stm32 and stm32v2 in Core/Src/main.c
+ * on top of the STM32 HAL, the host tools (vmcu, benchmarks) in plain C.
+ *
+ * Outputs are numbered per kind. The first turret of a board (turret_unit.h)
+ * is on the outputs below, a board wired for more turrets numbers on from
+ * there and maps each number to its timer and channel in a table.
+ ******************************************************************************
+ */
+#ifndef __TURRET_HAL_H
+#define __TURRET_HAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define THAL_PHI 0   // pan servo, TIM3 CH4
+#define THAL_THT 1   // tilt servo, TIM3 CH3
+#define THAL_TRIG 0  // trigger servo TIM3 CH1, step TIM4, cooldown TIM2
+#define THAL_MOTOR 0 // launcher dc motor, GPIOB pin 0
+
+// servo and trigger pulse widths in TIM3 counts
+void thal_servo(int out, int ccr);
+void thal_trigger(int out, int ccr);
+// hold back the CCR update until released, so the axes of one tick reach
+// the output on the same PWM frame
+void thal_ccrhold(int hold);
+
+// launcher dc motor duty in permille, 0 is off; targets without pwm on the
+// pin switch it on for any duty above 0
+void thal_motor(int out, int permille);
+// shot indicator of a trigger (LD2 for THAL_TRIG)
+void thal_shotled(int out, int on);
+
+// step and cooldown timers of a trigger: expire once after ms, 0 stops
+// them. The target calls turret_trigtick(out), turret_cooldown(out)
+void thal_trigtimer(int out, int ms);
+void thal_cooldowntimer(int out, int ms);
+
+// TICKHZ timer: 0 stops it, 1 starts it with the first interrupt right
+// away. The turret stops it while nothing moves (turret_sched.h)
+void thal_ticktimer(int on);
+
+uint32_t thal_millis(void);
+// free running cycle counter for turret_prof.h, wraps
+uint32_t thal_cycles(void);
+
+// superloop idle (turret_sched.h): masks the interrupts, sleeps until one
+// is pending (WFI, a masked interrupt still wakes the core) unless *wake is
+// set, and unmasks; the interrupt runs before it returns. Returns
+// thal_cycles() at the wake-up
+uint32_t thal_sleep(volatile const int *wake);
+
+// uart tx towards the host, data must stay valid until thal_txready()
+int thal_txready(void);
+void thal_transmit(const uint8_t *data, int len);
+
+// target specific frames sent after CMDRTOSSTATS (stm32: rtos_stats.h):
+// points *frame at frame i and returns its length, 0 past the last one.
+// The frame stays valid until the next call
+int thal_osframe(int i, const uint8_t **frame);
+
+// parameter sector (turret_param.h), erased bytes read 0xff. Size 0: no
+// flash, the parameters only live until reset. Erase and write block and
+// return 1 on success; written words must be erased before
+uint32_t thal_flashsize(void);
+const uint8_t *thal_flashdata(void);
+int thal_flasherase(void);
+int thal_flashwrite(uint32_t offset, const uint32_t *words, int nwords);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TURRET_HAL_H */
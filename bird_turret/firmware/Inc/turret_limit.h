@@ -0,0 +1,80 @@
+/**
+ ******************************************************************************
+ * @file    turret_limit.h
+ * @brief   Workspace limits: saturation of the setpoints and giving up.
+ *
+ * The pid outputs are already clamped to the servo bounds, so a target out
+ * of reach leaves the axis pressed against a bound for as long as the host
+ * keeps sending errors that way. limit_update() flags an axis as saturated
+ * when its target sits on a bound and the error still points out; the
+ * flags go out with the telemetry. After MAXBOUNDCNT saturated frames in a
+ * row turret.c gives up: the axis backs off the bound by LIMITBACKOFF and
+ * holds there (the nearest pose the servo can keep without pushing), the
+ * host gets a LimitFrame, and errors towards that bound are dropped until
+ * one points back in, or the turret is recentered or aimed.
+ ******************************************************************************
+ */
+#ifndef __TURRET_LIMIT_H
+#define __TURRET_LIMIT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "turret_ctrl.h"
+#include <stdint.h>
+
+// LimitFrame sides, and the saturated/latched sides of Limit
+#define LIMIT_PHILO 0x01
+#define LIMIT_PHIHI 0x02
+#define LIMIT_THTLO 0x04
+#define LIMIT_THTHI 0x08
+
+typedef struct {
+  int32_t lo, hi;         // Q16 positions, the servo bounds
+  volatile int8_t sat;    // -1/+1: target on lo/hi and pushing, 0: free
+  volatile int8_t latched; // -1/+1: gave up on that side
+} LimitAxis;
+
+typedef struct {
+  LimitAxis phi, tht;
+  int32_t backoff; // Q16 counts
+} Limit;
+
+// sent when an axis gives up (little endian)
+typedef struct __attribute__((packed)) {
+  uint8_t sync[2];
+  uint8_t type; // TELEMLIMIT
+  uint8_t len;
+  uint8_t sides;          // LIMIT_*, the bounds given up on
+  int32_t phipos, thtpos; // udeg from center, where the axes hold
+  uint8_t crc;
+} LimitFrame;
+
+void limit_init(Limit *l, int backoff);
+
+// bounds of one axis (Servo.lo, hi)
+void limit_setrange(LimitAxis *a, int32_t lo, int32_t hi);
+
+// host error with the part towards a latched bound dropped; an error back
+// in releases the latch
+int limit_error(LimitAxis *a, int err);
+
+// after ctrl_move(): saturation of the axis, -1, 0, +1
+int limit_update(LimitAxis *a, const CtrlAxis *c, int err);
+
+// give up on the saturated side: latches it, returns the pose to hold
+int32_t limit_retreat(Limit *l, LimitAxis *a);
+
+// LIMIT_* of the saturated and latched sides
+int limit_sat(const Limit *l);
+int limit_latched(const Limit *l);
+
+// recenter or aim: forget the latches and saturation
+void limit_release(Limit *l);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TURRET_LIMIT_H */
@@ -0,0 +1,57 @@
+/**
+ ******************************************************************************
+ * @file    turret_motor.h
+ * @brief   Launcher dc motor: soft start and idle hold.
+ *
+ * Any use of the launcher (a move, an aim, a trigger or a host pre-spin)
+ * calls motor_spin(). The control tick ramps the duty from where it is to
+ * the run duty over the ramp time instead of switching the pin, which keeps
+ * the inrush down, and keeps the motor running for the idle hold after the
+ * last use so the next shot does not pay the spin-up again. Only
+ * motor_tick() writes the pin, the other calls just change the request.
+ ******************************************************************************
+ */
+#ifndef __TURRET_MOTOR_H
+#define __TURRET_MOTOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+typedef struct {
+  int out;                   // thal_motor() output
+  int runduty;               // permille at speed
+  int32_t ramp;              // Q16 permille per tick
+  uint32_t idlehold;         // ms after the last use before stopping
+  volatile int enabled;      // motor_spin() since the last motor_stop()
+  volatile uint32_t lastuse; // thal_millis() of the last motor_spin()
+  int32_t duty;              // Q16 permille on the pin
+} Motor;
+
+void motor_init(Motor *m, int out, int runduty, int rampms, int idlehold);
+
+// 0 (and nothing changed) for a duty outside 1..1000 or no idle hold
+int motor_config(Motor *m, int runduty, int rampms, int idlehold);
+
+// start or keep spinning, restarts the idle hold
+void motor_spin(Motor *m);
+
+// off on the next tick, without waiting for the idle hold
+void motor_stop(Motor *m);
+
+// TICKHZ: idle hold and ramp. busy holds the motor like motor_spin() does
+void motor_tick(Motor *m, int busy);
+
+// duty on the pin > 0, and at the run duty
+int motor_on(const Motor *m);
+// motor_tick() still has something to ramp or time out
+int motor_busy(const Motor *m);
+int motor_ready(const Motor *m);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TURRET_MOTOR_H */
@@ -0,0 +1,142 @@
+/**
+ ******************************************************************************
+ * @file    turret_param.h
+ * @brief   Run-time parameter table, persisted in a reserved flash sector.
+ *
+ * The turret_config.h constants that need tuning on the bench (centers,
+ * limits, rest and trigger pulses, pid gains) are typed parameters with a
+ * range and the build's value as default. The host reads and sets them
+ * over the link (CMDPARAMGET, CMDPARAMSET) and makes them survive a reset
+ * with CMDPARAMCOMMIT.
+ *
+ * Every turret of the board (turret_unit.h) has its own set; the centers
+ * and limits default to the unit descriptor, the rest to the build's
+ * value. Commands and frames are about the unit CMDUNIT selected.
+ *
+ * The sector is a log: every commit appends a record {magic, seq, count,
+ * values, crc32} behind the last one, and only a full sector is erased.
+ * A record holds the sets of all units, 116 bytes for one, so a 128K sector
+ * takes about 1100 commits per erase. At boot the last record with a good
+ * crc wins; a torn record from a reset during a commit is skipped. A record
+ * from a build with fewer parameters or units leaves the new ones at their
+ * default, values out of range fall back to the default as well.
+ ******************************************************************************
+ */
+#ifndef __TURRET_PARAM_H
+#define __TURRET_PARAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "turret_unit.h"
+#include <stdint.h>
+
+// parameter ids: the host and the flash records use them, only append
+enum {
+  PARAM_PHICENTER, // TIM3 counts
+  PARAM_THTCENTER,
+  PARAM_PHIMIN,
+  PARAM_PHIMAX,
+  PARAM_THTMIN,
+  PARAM_THTMAX,
+  PARAM_DFLTPULSE, // trigger servo at rest
+  PARAM_TRIGPULSE, // trigger servo pulled, in the default table
+  PARAM_MAXBOUNDCNT,
+  PARAM_KPX, // pid gains, counts per error unit and host frame
+  PARAM_KIX,
+  PARAM_KDX,
+  PARAM_KPY,
+  PARAM_KIY,
+  PARAM_KDY,
+  PARAM_PIDRATE, // counts per host frame, 0: no limit
+  PARAM_TRACKALPHA, // alpha-beta filter of CMDTRACK (turret_track.h)
+  PARAM_TRACKBETA,
+  PARAM_TRACKCOAST, // ms
+  PARAM_TRACKKX,    // counts per error unit
+  PARAM_TRACKKY,
+  PARAM_SEARCHDELAY, // ms, 0: no search spiral (turret_search.h)
+  PARAM_SEARCHPITCH, // counts per sweep
+  PARAM_SEARCHRATE,  // counts/s
+  PARAM_SEARCHSWEEPS,
+  PARAM_COUNT
+};
+
+#define PARAM_INT 0
+#define PARAM_FLOAT 1
+#define PARAM_NAMELEN 12
+#define PARAM_ALL 0xff // CMDPARAMGET: every parameter
+
+// ParamFrame status
+#define PARAM_OK 0
+#define PARAM_UNKNOWN 1 // no such id
+#define PARAM_RANGE 2   // outside the range, or the servo limits would cross
+#define PARAM_BUSY 3    // pulse change while a shot is running
+
+typedef union {
+  int32_t i;
+  float f;
+} ParamValue;
+
+typedef struct {
+  char name[PARAM_NAMELEN];
+  uint8_t type; // PARAM_INT, PARAM_FLOAT
+  ParamValue min, max, dflt;
+} ParamDesc;
+
+typedef struct {
+  ParamValue v[TURRETS][PARAM_COUNT];
+  uint32_t seq;  // commits so far, 0: defaults
+  uint32_t used; // bytes of the sector taken by records
+} Params;
+
+// reply to CMDPARAMGET and CMDPARAMSET, one per parameter (little endian)
+typedef struct __attribute__((packed)) {
+  uint8_t sync[2];
+  uint8_t type; // TELEMPARAM
+  uint8_t len;
+  uint8_t id, count;
+  uint8_t ptype;  // PARAM_INT, PARAM_FLOAT
+  uint8_t status; // PARAM_OK, ...
+  char name[PARAM_NAMELEN];
+  ParamValue value, min, max, dflt;
+  uint8_t crc;
+} ParamFrame;
+
+// reply to CMDPARAMCOMMIT
+typedef struct __attribute__((packed)) {
+  uint8_t sync[2];
+  uint8_t type; // TELEMPARAMCOMMIT
+  uint8_t len;
+  uint8_t ok;     // 0: no flash or the write failed, nothing changed
+  uint8_t erased; // the sector was full and got erased first
+  uint32_t seq;   // of the record just written
+  uint32_t used, size; // bytes of the sector
+  uint8_t crc;
+} ParamCommitFrame;
+
+extern const ParamDesc param_desc[PARAM_COUNT];
+
+// the table defaults for every unit
+void param_defaults(Params *p);
+
+// PARAM_OK or why not, the table is left alone unless PARAM_OK
+int param_check(int id, ParamValue v);
+
+// last good record of the sector over the values in p (param_defaults()
+// and the unit defaults), 1 if there was one
+int param_load(Params *p);
+
+// append a record, erasing the sector first when it is full. 1 on success.
+// Blocks for the write, and for about a second when it has to erase
+int param_commit(Params *p, int *erased);
+
+// fill and seal the TELEMPARAM frame of one parameter of a unit
+void param_frame(ParamFrame *f, const Params *p, int unit, int id,
+                 int status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TURRET_PARAM_H */
@@ -0,0 +1,64 @@
+/**
+ ******************************************************************************
+ * @file    turret_pid.h
+ * @brief   Fixed-point discrete PID for one servo axis.
+ *
+ * Gains are Q15 (output counts per unit of error), the integrator and the
+ * output are Q16 TIM3 counts in an int32_t, so an error too small to move
+ * the pulse by a whole count still accumulates. Per update:
+ *
+ *   d    += dalpha * (kd * (e - e[-1]) - d)     first-order filtered D
+ *   u     = kp * e + (i + ki * e) + d
+ *   out   = ratelimit(clamp(u, outmin, outmax))
+ *   i    += ki * e + kb * (out - u)             back-calculation
+ *
+ * and i itself is clamped to [outmin, outmax]. No HAL, no float: usable
+ * from ISRs and tasks in both stm32 builds and on the host.
+ ******************************************************************************
+ */
+#ifndef __TURRET_PID_H
+#define __TURRET_PID_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define PID_Q15(x) ((int32_t)((x) * 32768.0f + ((x) < 0 ? -.5f : .5f)))
+#define PID_Q16(x) ((int32_t)((x) * 65536.0f + ((x) < 0 ? -.5f : .5f)))
+
+typedef struct {
+  int32_t kp, ki, kd;     // Q15
+  int32_t kb;             // Q15, anti-windup back-calculation gain
+  int32_t dalpha;         // Q15, derivative filter, 1.0 = unfiltered
+  int32_t outmin, outmax; // Q16
+  int32_t ratemax;        // Q16 per update, 0 disables the rate limit
+  int32_t integ, dterm;   // Q16
+  int32_t out;            // Q16, last output
+  int32_t preverr;
+  uint8_t primed;    // preverr holds a real sample, 0 after a reset
+  uint8_t saturated; // last output was clamped or rate limited
+} Pid;
+
+// gains Q15, limits and rate Q16; state starts at out = 0
+void pid_init(Pid *p, int32_t kp, int32_t ki, int32_t kd, int32_t outmin,
+              int32_t outmax, int32_t ratemax);
+
+// restart from output `out` (Q16) without derivative kick: the next
+// update seeds the previous error from its own sample
+void pid_reset(Pid *p, int32_t out);
+
+// new gains and limits on a running loop, the state is kept and clamped
+// into the new limits
+void pid_tune(Pid *p, int32_t kp, int32_t ki, int32_t kd, int32_t outmin,
+              int32_t outmax, int32_t ratemax);
+
+// one error sample, returns the new output (Q16)
+int32_t pid_update(Pid *p, int32_t err);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TURRET_PID_H */
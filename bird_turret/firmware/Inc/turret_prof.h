@@ -0,0 +1,87 @@
+/**
+ ******************************************************************************
+ * @file    turret_prof.h
+ * @brief   Cycle counter probes: min/max/mean and a log2 histogram per probe.
+ *
+ * PROF_BEGIN(probe) ... PROF_END(probe) in the same scope times the code in
+ * between with thal_cycles() (DWT->CYCCNT on the targets, 1 cycle = 1/168us
+ * at 168MHz). Bucket i of the histogram counts the samples in
+ * [2^i, 2^(i+1)) cycles, bucket 0 also takes 0. A record is a few
+ * instructions and is not atomic: a probe hit from two interrupt priorities
+ * can lose a sample now and then. Build with -DTURRET_PROF=0 and the
+ * probes compile to nothing.
+ *
+ * CMDPROF makes the target send one TELEMPROF frame per probe.
+ ******************************************************************************
+ */
+#ifndef __TURRET_PROF_H
+#define __TURRET_PROF_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "turret_hal.h"
+#include <stdint.h>
+
+#ifndef TURRET_PROF
+#define TURRET_PROF 1
+#endif
+
+// probe points, names in turret_prof.c
+enum {
+  PROF_UARTIRQ, // UART5_IRQHandler: HAL_UART_IRQHandler()
+  PROF_UARTRX,  // HAL_UART_RxCpltCallback()
+  PROF_TIMCB,   // HAL_TIM_PeriodElapsedCallback(), all timers
+  PROF_TICK,    // control tick (TIM7)
+  PROF_MOVE,    // move command: setpoint to TIM3 CCR
+  PROF_CMDLAT,  // move/aim: rx isr of the last byte -> new setpoint
+  PROF_CMDPWM,  // move/aim: rx isr of the last byte -> first CCR write
+  PROF_AWAKE,   // wake-up -> next sleep (turret_sched.h), isrs included
+  PROF_NPROBES
+};
+
+#define PROF_BUCKETS 32
+#define PROF_NAMELEN 8
+
+typedef struct {
+  uint32_t count;
+  uint32_t min, max;
+  uint64_t sum;
+  uint32_t hist[PROF_BUCKETS];
+} ProfProbe;
+
+// one probe, reply to CMDPROF (little endian)
+typedef struct __attribute__((packed)) {
+  uint8_t sync[2];
+  uint8_t type; // TELEMPROF
+  uint8_t len;
+  uint8_t probe, nprobes;
+  uint8_t sched; // TURRET_RTOS of the build (turret_sched.h)
+  char name[PROF_NAMELEN]; // not 0 terminated when 8 long
+  uint32_t count, min, max, mean; // cycles
+  uint32_t hist[PROF_BUCKETS];
+  uint8_t crc;
+} ProfFrame;
+
+#if TURRET_PROF
+#define PROF_BEGIN(p) uint32_t prof_t_##p = thal_cycles()
+#define PROF_END(p) prof_record(p, thal_cycles() - prof_t_##p)
+// from a thal_cycles() stamp taken elsewhere, e.g. in another isr
+#define PROF_SINCE(p, stamp) prof_record(p, thal_cycles() - (stamp))
+#else
+#define PROF_BEGIN(p) ((void)0)
+#define PROF_END(p) ((void)0)
+#define PROF_SINCE(p, stamp) ((void)(stamp))
+#endif
+
+void prof_record(int probe, uint32_t cycles);
+void prof_reset(void);
+// fill and seal the TELEMPROF frame of one probe
+void prof_frame(ProfFrame *f, int probe);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TURRET_PROF_H */
@@ -0,0 +1,190 @@
+/**
+ ******************************************************************************
+ * @file    turret_proto.h
+ * @brief   Host link: command frame parser and telemetry frame encoder.
+ *
+ * Commands are 4 bytes, [op, x, y, ENDOFDATA], matched on a sliding window
+ * so the parser resynchronises on its own after a lost byte. Telemetry
+ * frames are AA 55 | type | len | payload | crc8(type..payload).
+ *
+ * Commands that do not fit in two int8 use the telemetry framing towards
+ * the MCU as well. A legacy frame can not contain AA 55 followed by a known
+ * command type (AA 55 could only be x, y and is always followed by
+ * ENDOFDATA), so both kinds share the byte stream without an escape.
+ ******************************************************************************
+ */
+#ifndef __TURRET_PROTO_H
+#define __TURRET_PROTO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "turret_servo.h"
+#include "turret_trig.h"
+#include <stdint.h>
+
+#define MOVEOP 0
+#define TRIGOP 1
+#define ENDOFDATA 2
+
+#define RES_ERR 0
+#define RES_DON 1
+
+#define TELEMSYNC0 0xAA
+#define TELEMSYNC1 0x55
+#define TELEMSTATUS 0x01
+#define TELEMFLAG_MOTOR 0x01
+#define TELEMFLAG_MOVE 0x02
+#define TELEMFLAG_AIM 0x04 // absolute aim slewing, report not sent yet
+#define TELEMFLAG_HOLD 0x08 // staying on target between/after bursts
+#define TELEMFLAG_SPUN 0x10 // launcher motor at its run duty
+#define TELEMFLAG_PHISAT 0x20 // pan target on a bound, host pushing out
+#define TELEMFLAG_THTSAT 0x40
+#define TELEMFLAG_LIMIT 0x80 // an axis gave up on a bound (turret_limit.h)
+#define TELEMAIMDONE 0x02
+#define TELEMPROF 0x03 // ProfFrame (turret_prof.h), one per probe
+#define TELEMTASK 0x04 // RTOS build: one per task (stm32/Core/Inc/rtos_stats.h)
+#define TELEMRTOS 0x05 // RTOS build: heap and wait counts, after the tasks
+#define TELEMPARAM 0x06 // ParamFrame (turret_param.h)
+#define TELEMPARAMCOMMIT 0x07 // ParamCommitFrame
+#define TELEMLIMIT 0x08 // LimitFrame (turret_limit.h)
+#define TELEMUNIT 0x09  // UnitFrame (turret_unit.h): the frames that follow
+#define TELEMTRACKACK 0x0A // TrackAck, once per CMDTRACK
+
+// framed commands from the host
+#define CMDAIM 0x10
+#define CMDAIMLEN 9 // u8 id, i32 phi, i32 tht (udeg from center)
+#define CMDTRIGTABLE 0x11 // 1..TRIGMAXSTEPS x {u16 ccr, u16 ms}
+#define CMDBURST 0x12 // u8 shots, u8 hold, u16 interval, cooldown, loss (ms)
+#define CMDBURSTLEN 8
+#define CMDCENTER 0x13 // no payload: end a hold or burst, back to center
+#define CMDSPIN 0x14 // u8 1: pre-spin the launcher motor, 0: stop it
+#define CMDSPINLEN 1
+#define CMDMOTORCFG 0x15 // u16 duty (permille), ramp, idle hold (ms)
+#define CMDMOTORCFGLEN 6
+#define CMDPROF 0x16 // u8 PROF_DUMP | PROF_RESET
+#define CMDPROFLEN 1
+#define PROF_DUMP 0x01  // send the probes
+#define PROF_RESET 0x02 // then clear them
+#define CMDRTOSSTATS 0x17 // no payload: RTOS build sends TELEMTASK, TELEMRTOS
+#define CMDPARAMGET 0x18 // u8 id or PARAM_ALL
+#define CMDPARAMGETLEN 1
+#define CMDPARAMSET 0x19 // u8 id, i32 or f32 value; live until reset
+#define CMDPARAMSETLEN 5
+#define CMDPARAMCOMMIT 0x1A // no payload: current values to flash
+// u8 axis (0 pan, 1 tilt), i32 start, i32 step (udeg), 0..SERVOLUTMAX
+// x u16 ccr: calibration table (servo_setlut()), no points: linear again
+#define CMDSERVOLUT 0x1B
+#define CMDSERVOLUTLEN(n) (9 + 2 * (n))
+// u32 thal_millis() of the camera frame (host synced), i8 x, i8 y as in a
+// MOVEOP frame: the error goes to the alpha-beta filter (turret_track.h)
+#define CMDTRACK 0x1C
+#define CMDTRACKLEN 6
+#define CMDUNIT 0x1D // u8 unit (turret_unit.h) the commands after it go to
+#define CMDUNITLEN 1
+#define PROTO_MAXPAYLOAD CMDSERVOLUTLEN(SERVOLUTMAX)
+
+// AimDone status
+#define AIM_PREEMPTED 0 // a move or trigger took the axes over first
+#define AIM_ARRIVED 1
+#define AIM_LIMITED 2 // arrived at the aim clamped to the bounds
+
+// proto_feed() results
+#define PROTO_NONE 0
+#define PROTO_MOVE 1
+#define PROTO_TRIG 2
+#define PROTO_AIM 3
+#define PROTO_TRIGTABLE 4
+#define PROTO_BURST 5
+#define PROTO_CENTER 6
+#define PROTO_SPIN 7
+#define PROTO_MOTORCFG 8
+#define PROTO_PROF 9
+#define PROTO_RTOSSTATS 10
+#define PROTO_PARAMGET 11
+#define PROTO_PARAMSET 12
+#define PROTO_PARAMCOMMIT 13
+#define PROTO_SERVOLUT 14
+#define PROTO_TRACK 15
+#define PROTO_UNIT 16
+
+typedef struct {
+  int8_t oper[4]; // oper[1], oper[2]: x, y of the last frame
+  uint8_t frame[4 + PROTO_MAXPAYLOAD + 1]; // framed command being received
+  int framepos;
+  uint8_t aimid; // last CMDAIM
+  int32_t aimphi, aimtht;
+  TrigStep trigtable[TRIGMAXSTEPS]; // last CMDTRIGTABLE
+  int trignsteps;
+  uint8_t burstshots, bursthold; // last CMDBURST
+  uint16_t burstinterval, burstcooldown, burstloss;
+  uint8_t spin;                             // last CMDSPIN
+  uint16_t motorduty, motorramp, motoridle; // last CMDMOTORCFG
+  uint8_t prof;                             // last CMDPROF
+  uint8_t paramid;   // last CMDPARAMGET, CMDPARAMSET
+  uint32_t paramraw; // last CMDPARAMSET value, as sent
+  uint8_t lutaxis;   // last CMDSERVOLUT
+  int32_t lutstart, lutstep;
+  uint16_t lutccr[SERVOLUTMAX];
+  int lutn;
+  uint32_t trackstamp; // last CMDTRACK
+  int8_t trackx, tracky;
+  uint8_t unit; // last CMDUNIT
+  uint16_t rxmoves, rxtrigs, rxdropped, rxerrors;
+} Proto;
+
+// telemetry frame sent to the host every TELEMPERIOD ms, by each unit in
+// turn (little endian)
+typedef struct __attribute__((packed)) {
+  uint8_t sync[2]; // TELEMSYNC0, TELEMSYNC1
+  uint8_t type;    // TELEMSTATUS
+  uint8_t len;     // payload length, crc excluded
+  uint32_t tick;   // thal_millis() at sampling
+  uint16_t seq;
+  int32_t phipos, thtpos;       // servo outputs, udeg from center
+  int32_t phitarget, thttarget; // setpoints the trajectory is heading to
+  uint8_t trigprogress, shotflag, boundcnt;
+  uint8_t flags; // TELEMFLAG_*
+  uint16_t rxmoves, rxtrigs, rxdropped, rxerrors;
+  uint16_t shots; // trigger cycles fired since reset
+  uint8_t sweep;     // of the search spiral (turret_search.h), 0: none
+  uint16_t searches; // spirals started since reset
+  uint8_t crc;       // crc8 over type..payload
+} Telemetry;
+
+// sent once per CMDAIM when the slew ends
+typedef struct __attribute__((packed)) {
+  uint8_t sync[2];
+  uint8_t type; // TELEMAIMDONE
+  uint8_t len;
+  uint8_t id;     // CMDAIM id
+  uint8_t status; // AIM_*
+  int32_t phipos, thtpos; // udeg from center
+  uint8_t crc;
+} AimDone;
+
+// sent once per CMDTRACK at the first CCR write towards it, the host
+// places the MCU hops of the camera frame with it
+typedef struct __attribute__((packed)) {
+  uint8_t sync[2];
+  uint8_t type; // TELEMTRACKACK
+  uint8_t len;
+  uint32_t stamp;  // of the CMDTRACK
+  uint32_t rxtick; // thal_millis() when it came in
+  uint32_t setcycles, ccrcycles; // rx isr of the last byte -> setpoint, CCR
+  uint8_t crc;
+} TrackAck;
+
+void proto_init(Proto *p);
+int proto_feed(Proto *p, uint8_t byte);
+uint8_t proto_crc8(const uint8_t *data, int len);
+
+// fill sync, type, len and crc of a frame whose payload is already in place
+void proto_seal(uint8_t *frame, uint8_t type, int payloadlen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TURRET_PROTO_H */
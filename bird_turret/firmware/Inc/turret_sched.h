@@ -0,0 +1,82 @@
+/**
+ ******************************************************************************
+ * @file    turret_sched.h
+ * @brief   Execution model: who calls the turret.h entry points, and when.
+ *
+ * The protocol, control and trigger code is the same in every build,
+ * TURRET_RTOS picks how it is driven at compile time:
+ *
+ *   0  superloop + ISRs (stm32v2, host tools). The UART and TICKHZ timer
+ *      interrupts call turret_rxbyte() and turret_tick() themselves,
+ *      sched_start() runs turret_poll() and sleeps (thal_sleep()) until
+ *      the next interrupt.
+ *   1  FreeRTOS tasks (stm32). The UART isr puts the byte in a stream
+ *      buffer and the TICKHZ timer isr notifies, the work runs in tasks
+ *      ranked like the bare-metal interrupt priorities: the uart task
+ *      (sched_rxloop()) above the ctrl task (turret_tick()) above the poll
+ *      task (turret_poll(), woken by both). The trigger and cooldown timers
+ *      call turret_trigtick() / turret_cooldown() from their isr in both
+ *      models. The idle task sleeps with the tick suppressed
+ *      (configUSE_TICKLESS_IDLE).
+ *
+ * The target wires:
+ *   UART rx complete   -> sched_rxbyte()
+ *   TICKHZ timer       -> sched_tick(), started and stopped by
+ *                         thal_ticktimer()
+ *   trigger timers, uart tx complete -> sched_wake()
+ *   end of main()      -> sched_start()
+ *   uart task (RTOS)   -> sched_rxloop()
+ *   configPRE/POST_SLEEP_PROCESSING (RTOS) -> sched_presleep/postsleep()
+ *
+ * The TICKHZ timer runs only while something moves (turret.h): with the
+ * turret settled the core wakes for the host link, the trigger timers and
+ * the time base alone (SysTick in the superloop, which also runs
+ * turret_poll() for the telemetry; the poll task's TELEMPERIOD timeout in
+ * the RTOS build). A command starts the timer with a tick right away.
+ *
+ * Both models time a move or aim from the rx interrupt of its last byte
+ * to the setpoint (PROF_CMDLAT) and to the first TIM3 CCR write towards it
+ * (PROF_CMDPWM), CMDPROF reports them the same way. Only interrupts (UART,
+ * its DMA, the timers) wake the core, and an interrupt that comes in
+ * between turret_poll() and the sleep cancels the sleep, so idling adds
+ * no latency to either. PROF_AWAKE times each stretch from a wake-up to
+ * the next sleep: count * mean over the time since the reset is the
+ * share of the time the core was running.
+ ******************************************************************************
+ */
+#ifndef __TURRET_SCHED_H
+#define __TURRET_SCHED_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#ifndef TURRET_RTOS
+#define TURRET_RTOS 0
+#endif
+
+// superloop: never returns. RTOS: creates the rx buffer, the ctrl and poll
+// tasks and returns, main() then starts the kernel
+void sched_start(void);
+// from the UART rx complete interrupt
+void sched_rxbyte(uint8_t byte);
+// from the TICKHZ timer interrupt
+void sched_tick(void);
+// from an interrupt that leaves work for turret_poll()
+void sched_wake(void);
+
+#if TURRET_RTOS
+// body of the uart task: feeds the buffered bytes to turret_rxbyte()
+void sched_rxloop(void);
+// around the WFI of the tickless idle, interrupts masked
+void sched_presleep(void);
+void sched_postsleep(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TURRET_SCHED_H */
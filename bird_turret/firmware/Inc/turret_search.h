@@ -0,0 +1,65 @@
+/**
+ ******************************************************************************
+ * @file    turret_search.h
+ * @brief   Search spiral after the host has gone quiet on a target.
+ *
+ * rasptostm only sends while detection_2 sees the bird, so an occlusion
+ * used to leave the turret frozen. After SEARCHDELAY ms without a move,
+ * track or aim frame on an engaged target turret_poll() starts a spiral
+ * around the last target: the radius grows by the pitch every turn, the
+ * speed along the path is constant, and every point is clamped to the
+ * servo bounds. Each turn is a sweep, the telemetry carries its number.
+ * After the last sweep the turret recenters.
+ *
+ * The tick runs the spiral (search_step()). Any host command stops it at
+ * once from the rx side (search_stop()) and turret_poll() moves the ctrl
+ * targets to where the servos are (search_take()), so the host's next
+ * error applies to the pose the camera saw it from.
+ ******************************************************************************
+ */
+#ifndef __TURRET_SEARCH_H
+#define __TURRET_SEARCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+typedef struct {
+  volatile int active;  // spiral running, the tick owns the state below
+  volatile int stopped; // preempted, turret_poll() not told yet
+  volatile int done;    // all sweeps run
+  float cphi, ctht;     // counts from center, the last target
+  float theta;          // rad along the spiral
+  float pitch;          // counts the radius grows per sweep
+  float rate;           // counts per s along the path
+  int sweeps;
+  volatile uint8_t sweep; // 1.. while active, 0: not searching
+} Search;
+
+void search_init(Search *s);
+
+// radius growth per sweep and path speed in counts, number of sweeps
+void search_tune(Search *s, int pitch, int rate, int sweeps);
+
+// spiral around phi, tht (counts from center)
+void search_start(Search *s, float phi, float tht);
+
+// TICKHZ: next point inside lo..hi (counts), 0 when not searching
+int search_step(Search *s, float dt, const float lo[2], const float hi[2],
+                float *phi, float *tht);
+
+// a host command: stop and let search_take() know. Any context
+void search_stop(Search *s);
+// recenter: stop, nothing to take over
+void search_cancel(Search *s);
+
+// 1 once after a search_stop() that ended a spiral
+int search_take(Search *s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TURRET_SEARCH_H */
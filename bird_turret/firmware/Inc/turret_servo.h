@@ -0,0 +1,77 @@
+/**
+ ******************************************************************************
+ * @file    turret_servo.h
+ * @brief   Servo output: Q16 positions in, TIM3 compare values out.
+ *
+ * Positions are kept as Q16 TIM3 counts relative to the center pulse, so
+ * nothing upstream loses the fraction of a count; only the compare register
+ * write rounds. Callers that want physical units read and write
+ * micro-degrees (1 count = SERVOUDEGPERUS * 1e6 / TIM3HZ udeg).
+ *
+ * A calibration table (servo_setlut()) replaces the linear map for units
+ * whose pulse to angle curve is bent or offset: the compare value is
+ * interpolated between pulses measured at evenly spaced angles, so the
+ * positions become true angles (still in Q16 counts of SERVOUDEGPERUS)
+ * and the bounds turn into the angles at which the table reaches min and
+ * max. The lookup is a multiply by the reciprocal of the spacing, no
+ * division or search.
+ ******************************************************************************
+ */
+#ifndef __TURRET_SERVO_H
+#define __TURRET_SERVO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define SERVOLUTMAX 17 // table points, 16 segments
+
+typedef struct {
+  int n;          // points, 2..SERVOLUTMAX
+  int32_t start;  // Q16 counts of the first point
+  int32_t step;   // Q16 counts between points
+  uint64_t inv;   // 2^48 / step
+  int32_t ccr[SERVOLUTMAX]; // strictly monotonic, either direction
+} ServoLut;
+
+typedef struct {
+  int axis;             // thal_servo() output
+  int center;           // compare value at 0 udeg, without a table
+  int min, max;         // compare value bounds
+  int32_t lo, hi;       // the same bounds as Q16 positions
+  // servo_write() reads the table through lut while the other buffer fills,
+  // NULL: linear around center
+  const ServoLut *volatile lut;
+  ServoLut lutbuf[2];
+  volatile int32_t pos; // Q16 counts from center, last written
+  volatile int ccr;     // compare value last written
+} Servo;
+
+void servo_init(Servo *s, int axis, int center, int min, int max);
+
+// new center and bounds, the next servo_write() uses them
+void servo_setrange(Servo *s, int center, int min, int max);
+
+// calibration of n points, pulse ccr[i] at start + i * step udeg (step > 0,
+// the whole table under 2^30 Q16 counts, about 480deg); n = 0 goes back to
+// the linear map. 0 if the table is not monotonic or never gets inside
+// min..max. Moves the bounds: not while a servo_write() can preempt it
+int servo_setlut(Servo *s, int32_t start, int32_t step, const uint16_t *ccr,
+                 int n);
+
+// clamp to the bounds, round to the nearest count and write the register
+void servo_write(Servo *s, int32_t pos);
+void servo_write_udeg(Servo *s, int32_t udeg);
+
+int32_t servo_udeg(const Servo *s);
+
+int32_t servo_q16_to_udeg(int32_t pos);
+int32_t servo_udeg_to_q16(int32_t udeg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TURRET_SERVO_H */
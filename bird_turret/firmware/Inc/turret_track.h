@@ -0,0 +1,91 @@
+/**
+ ******************************************************************************
+ * @file    turret_track.h
+ * @brief   Alpha-beta target filter, extrapolated on the control tick.
+ *
+ * The host sees the bird 3-15 times a second. CMDTRACK frames carry the
+ * error of one camera frame together with the time the frame was taken,
+ * already converted to thal_millis() by the host (rasptostm syncs on the
+ * telemetry tick). Each one is turned into an absolute measurement, where
+ * the payload pointed at that time plus the error in counts, and fed to a
+ * per-axis alpha-beta filter. The camera saw the bird from the actual pose,
+ * which lags the filter by the trajectory and the servo, so the tick keeps
+ * the last TRACKHIST ms of servo pulses (track_pose()) and the measurement
+ * is built on the one the payload had reached at the frame's time. The
+ * control tick then steers to the filter's position extrapolated along its
+ * velocity, so the turret keeps moving with the bird between frames instead
+ * of stepping. Past the coast time without a new frame the extrapolation
+ * stops and the axis holds.
+ *
+ * track_update() runs in turret_poll(), track_target() in the tick, which
+ * preempts it but never the other way round: the estimate is handed over
+ * through two slots and a sequence number. Resets come from any priority
+ * (a recenter in the trigger isr) and only bump a generation count, so they
+ * never race the writer.
+ ******************************************************************************
+ */
+#ifndef __TURRET_TRACK_H
+#define __TURRET_TRACK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define TRACKHIST 256 // ms of servo pulses, above the camera latency
+
+typedef struct {
+  float phi, tht;   // counts from center at stamp
+  float phiv, thtv; // counts per ms
+  uint32_t stamp;   // thal_millis() of the camera frame
+  int active;       // 0: no estimate, the ctrl targets apply
+  uint32_t gen;     // Track.gen it was made in
+} TrackEstimate;
+
+typedef struct {
+  TrackEstimate slot[2];
+  volatile uint32_t seq; // slot[seq & 1] is the published one
+  volatile uint32_t gen; // bumped by track_reset(), drops older estimates
+  float alpha, beta;
+  uint32_t coast;    // ms of extrapolation past the last frame
+  float kphi, ktht;  // counts per error unit
+  uint32_t lag;      // ms from a pulse to the payload pointing there
+  // pulses in counts from center, [ms % TRACKHIST]; written by the tick
+  float histphi[TRACKHIST], histtht[TRACKHIST];
+  volatile uint32_t histlast; // thal_millis() of the last one
+  volatile int histn;         // ms recorded, up to TRACKHIST
+} Track;
+
+void track_init(Track *t);
+
+// gains, coast time and error scale (turret_param.h), lag of the payload
+// behind the pulse in ms
+void track_tune(Track *t, float alpha, float beta, int coastms, float kphi,
+                float ktht, int lagms);
+
+// the pulses written at now, counts from center. Tick
+void track_pose(Track *t, uint32_t now, float phi, float tht);
+
+// stop extrapolating, the ctrl targets apply again. Any context
+void track_reset(Track *t);
+
+// one camera frame: errors of the host and the time it was taken. lo and
+// hi bound the measurement (Q16 counts, Servo.lo, hi). phi, tht: in, the
+// ctrl targets, the pose before any pulse was recorded; out, the new
+// position at stamp, Q16 counts
+void track_update(Track *t, int phierr, int thterr, uint32_t stamp,
+                  const int32_t lo[2], const int32_t hi[2], int32_t *phi,
+                  int32_t *tht);
+
+// target at now in counts from center, 0 if not tracking
+int track_target(Track *t, uint32_t now, float *phi, float *tht);
+
+// the target still moves at now: an estimate within its coast time
+int track_moving(const Track *t, uint32_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TURRET_TRACK_H */
@@ -0,0 +1,56 @@
+/**
+ ******************************************************************************
+ * @file    turret_traj.h
+ * @brief   Jerk-limited (S-curve) trajectory towards a moving setpoint.
+ *
+ * Runs from the fixed-rate control tick. Each call of traj_step() advances
+ * position, velocity and acceleration by one period while keeping
+ * |vel| <= vmax, |acc| <= amax and |d acc/dt| <= jmax, and brakes early
+ * enough to stop on the target.
+ *
+ * With traj_shape() the output is also zero-vibration shaped for a lightly
+ * damped load (the launcher on its mount): a share k of every move goes out
+ * half a ringing period later, timed so that the ringing it starts cancels
+ * the one the first share started. The output arrives that much later but
+ * without oscillating around the target.
+ ******************************************************************************
+ */
+#ifndef __TURRET_TRAJ_H
+#define __TURRET_TRAJ_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRAJSHAPEMAX 256 // shaper delay in steps, 2Hz and up at 1kHz
+
+typedef struct {
+  float vmax, amax, jmax; // counts/s, counts/s^2, counts/s^3
+  float target;
+  float pos, vel, acc; // the S-curve
+  float out;           // shaped position, what traj_step() returned
+  float shapek;        // share of the move that goes out delayed
+  int delay, head;     // steps, 0: no shaper
+  int held;            // steps pos has been resting on the target, <= delay + 1
+  float past[TRAJSHAPEMAX]; // pos of the last delay steps
+} Traj;
+
+// no shaper until traj_shape()
+void traj_init(Traj *t, float pos, float vmax, float amax, float jmax);
+void traj_target(Traj *t, float target);
+
+// shape for a load ringing at hz with damping ratio zeta, steps of dt
+// seconds; hz = 0 turns the shaper off. Call at rest
+void traj_shape(Traj *t, float hz, float zeta, float dt);
+
+// advance by dt seconds, returns the new (shaped) position
+float traj_step(Traj *t, float dt);
+
+// at rest on the target, the shaped output as well
+int traj_done(const Traj *t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TURRET_TRAJ_H */
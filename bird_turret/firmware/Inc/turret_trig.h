@@ -0,0 +1,82 @@
+/**
+ ******************************************************************************
+ * @file    turret_trig.h
+ * @brief   Table-driven trigger sequence (TIM4) and shot cooldown (TIM2).
+ *
+ * A sequence is a table of {CCR1, ms} steps. trig_request() writes the first
+ * step and arms the trigger timer; each expiry moves to the next step, so
+ * nothing waits on the sequence and the aim keeps being serviced while the
+ * trigger servo runs. After the last step CCR1 returns to the rest pulse.
+ * A burst replays the table `shots` times with `interval` ms at rest in
+ * between; after the last cycle the cooldown timer starts and trig_step()
+ * reports completion.
+ ******************************************************************************
+ */
+#ifndef __TURRET_TRIG_H
+#define __TURRET_TRIG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define TRIGMAXSTEPS 8
+// longest step or interval thal_trigtimer() can time (TIM4 16 bit at 2kHz)
+#define TRIGMAXMS 32768
+
+// trig_step() results
+#define TRIG_BUSY 0 // inside a cycle or the interval after it
+#define TRIG_SHOT 1 // a cycle finished, more follow in this burst
+#define TRIG_DONE 2 // the last cycle finished, cooldown started
+#define TRIG_IDLE 3 // no burst playing: a late expiry after an abort
+
+typedef struct {
+  uint16_t ccr; // CCR1 for the length of the step
+  uint16_t ms;  // step length, 1..TRIGMAXMS
+} TrigStep;
+
+typedef struct {
+  int out; // thal_trigger() output and timers
+  TrigStep table[TRIGMAXSTEPS];
+  int nsteps;
+  int rest;               // CCR1 outside a sequence
+  int shots;              // cycles per request
+  int interval, cooldown; // ms between cycles, ms after the last one
+  volatile int progress;  // trigprogress, steps started in this cycle
+  volatile int shot;      // cycles finished in this burst
+  volatile int active;    // a burst is playing
+  volatile int shotflag;  // set from the request until the cooldown ends
+} Trig;
+
+void trig_init(Trig *t, int out, const TrigStep *table, int nsteps,
+               int rest);
+
+// replace the table, 0 if it is empty, too long, has a step of 0 or over
+// TRIGMAXMS ms, or a shot is still running
+int trig_settable(Trig *t, const TrigStep *table, int nsteps);
+
+// new rest pulse, written at once. 0 while a shot is running
+int trig_setrest(Trig *t, int rest);
+
+// burst shape, 0 if shots < 1, interval is over TRIGMAXMS or a shot is still
+// running. Single shot with no cooldown after trig_init()
+int trig_setburst(Trig *t, int shots, int interval, int cooldown);
+
+// start a burst, 0 if a shot or its cooldown is still running
+int trig_request(Trig *t);
+
+// trigger timer expired, TRIG_*
+int trig_step(Trig *t);
+
+// cut a burst short: trigger to rest, cooldown starts. 1 if one was playing
+int trig_abort(Trig *t);
+
+// cooldown timer elapsed
+void trig_cooldown(Trig *t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TURRET_TRIG_H */
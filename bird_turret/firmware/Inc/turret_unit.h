@@ -0,0 +1,69 @@
+/**
+ ******************************************************************************
+ * @file    turret_unit.h
+ * @brief   Descriptor table of the turrets one MCU drives.
+ *
+ * A unit is a pan/tilt pair, a trigger servo and a launcher motor on the
+ * turret_hal.h outputs of its descriptor. The rest of a unit's state
+ * (parameters, pid, trajectories, limits, filter, search, burst) is set up
+ * from the descriptor at turret_init(). The table has TURRETS entries, the
+ * default one is the single turret of turret_config.h on THAL_PHI,
+ * THAL_THT, THAL_TRIG and THAL_MOTOR; a board with more turrets builds with
+ * -DTURRETS=n and a TURRETUNITS initializer.
+ *
+ * The host link addresses one unit at a time. CMDUNIT selects the unit the
+ * following commands go to, and the MCU sends a TELEMUNIT frame ahead of
+ * the first frame (or result byte) of a unit other than the one before.
+ * Both ends start on unit 0, so a single turret never sees either.
+ ******************************************************************************
+ */
+#ifndef __TURRET_UNIT_H
+#define __TURRET_UNIT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "turret_trig.h"
+#include <stdint.h>
+
+#ifndef TURRETS
+#define TURRETS 1
+#endif
+
+typedef struct {
+  uint8_t servo;             // thal_servo() output
+  uint16_t center, min, max; // TIM3 counts, defaults of the unit parameters
+  const uint16_t *lut;       // calibration at reset (servo_setlut()), or 0
+  int32_t lutstart, lutstep; // udeg
+  uint8_t lutn;
+} AxisDesc;
+
+typedef struct {
+  uint8_t out;           // thal_trigger() output, its timers and shot led
+  uint8_t motor;         // thal_motor() output of the launcher
+  const TrigStep *table; // waveform at reset, CMDTRIGTABLE replaces it
+  uint8_t nsteps;
+} TrigDesc;
+
+typedef struct {
+  AxisDesc phi, tht;
+  TrigDesc trig;
+} UnitDesc;
+
+// sent ahead of frames from another unit than the last one
+typedef struct __attribute__((packed)) {
+  uint8_t sync[2];
+  uint8_t type; // TELEMUNIT
+  uint8_t len;
+  uint8_t unit;
+  uint8_t crc;
+} UnitFrame;
+
+extern const UnitDesc turret_units[TURRETS];
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TURRET_UNIT_H */
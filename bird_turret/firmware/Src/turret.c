@@ -0,0 +1,854 @@
+/**
+ ******************************************************************************
+ * @file    turret.c
+ * @brief   Turret application: ties protocol, control and trigger together.
+ ******************************************************************************
+ */
+#include "turret.h"
+#include "turret_config.h"
+#include "turret_hal.h"
+#include <string.h>
+
+Turret turret;
+
+#ifndef TURRETUNITS
+static const TrigStep trigtable[] = TRIGTABLE;
+#ifdef PHILUT
+static const uint16_t philut[] = PHILUT;
+#define PHILUTDESC                                                             \
+  philut, PHILUTSTART, PHILUTSTEP, sizeof(philut) / sizeof(philut[0])
+#else
+#define PHILUTDESC 0, 0, 0, 0
+#endif
+#ifdef THTLUT
+static const uint16_t thtlut[] = THTLUT;
+#define THTLUTDESC                                                             \
+  thtlut, THTLUTSTART, THTLUTSTEP, sizeof(thtlut) / sizeof(thtlut[0])
+#else
+#define THTLUTDESC 0, 0, 0, 0
+#endif
+// the one turret of turret_config.h on the first outputs
+#define TURRETUNITS                                                            \
+  {{{THAL_PHI, PHICENTER, PHIMIN, PHIMAX, PHILUTDESC},                         \
+    {THAL_THT, THTCENTER, THTMIN, THTMAX, THTLUTDESC},                         \
+    {THAL_TRIG, THAL_MOTOR, trigtable,                                         \
+     sizeof(trigtable) / sizeof(TrigStep)}}}
+#endif
+
+const UnitDesc turret_units[TURRETS] = TURRETUNITS;
+
+#define PARAM(u, name) (turret.params.v[(u)->id][PARAM_##name])
+
+static void aimEnd(TurretUnit *u, uint8_t status) {
+  // one AimDone per CMDAIM, turret_poll() sends it when tx is free
+  if (!u->aiming)
+    return;
+  u->aiming = 0;
+  AimDone *a = &u->aimdone;
+  a->id = u->aimid;
+  a->status = status;
+  a->phipos = servo_udeg(&u->phiservo);
+  a->thtpos = servo_udeg(&u->thtservo);
+  u->aimpending = 1;
+}
+
+static void recenter(TurretUnit *u) {
+  aimEnd(u, AIM_PREEMPTED);
+  limit_release(&u->limit);
+  track_reset(&u->track);
+  search_cancel(&u->search);
+  u->engaged = 0;
+  // the control tick slews the servos back along the S-curve
+  ctrl_reset(&u->ctrl);
+}
+
+static void disengage(TurretUnit *u) {
+  // back to center, ends a hold. The launcher keeps spinning for its idle
+  // hold in case the next target shows up
+  u->holding = 0;
+  recenter(u);
+}
+
+static float clampf(float v, float lo, float hi) {
+  return v < lo ? lo : v > hi ? hi : v;
+}
+
+// trajectory counts -> Q16 counts
+static int32_t toQ16(float pos) {
+  return (int32_t)(pos * 65536.f + (pos < 0 ? -.5f : .5f));
+}
+
+static void publish(TurretUnit *u) {
+  // hand the targets to the tick once they are complete
+  Setpoint sp = {u->ctrl.phi.target, u->ctrl.tht.target};
+  const Setpoint *last = &u->setpoint.slot[u->setpoint.seq & 1];
+  if (sp.phi != last->phi || sp.tht != last->tht)
+    dbuf_write(&u->setpoint, &sp);
+}
+
+static void sendResult(TurretUnit *u, uint8_t res) {
+  // uart tx is shared with telemetry, turret_poll() sends it when tx is free
+  u->resbuf = res;
+  u->respending = 1;
+}
+
+static void sendTelemetry(TurretUnit *u) {
+  Telemetry *t = &turret.telem;
+  t->tick = thal_millis();
+  t->seq++;
+  t->phipos = servo_udeg(&u->phiservo);
+  t->thtpos = servo_udeg(&u->thtservo);
+  t->phitarget = servo_q16_to_udeg(u->ctrl.phi.target);
+  t->thttarget = servo_q16_to_udeg(u->ctrl.tht.target);
+  t->trigprogress = u->trig.progress;
+  t->shotflag = u->trig.shotflag;
+  t->boundcnt = u->boundcnt;
+  t->flags = 0;
+  if (motor_on(&u->motor))
+    t->flags |= TELEMFLAG_MOTOR;
+  if (motor_ready(&u->motor))
+    t->flags |= TELEMFLAG_SPUN;
+  if (u->moveflag)
+    t->flags |= TELEMFLAG_MOVE;
+  if (u->aiming)
+    t->flags |= TELEMFLAG_AIM;
+  if (u->limit.phi.sat)
+    t->flags |= TELEMFLAG_PHISAT;
+  if (u->limit.tht.sat)
+    t->flags |= TELEMFLAG_THTSAT;
+  if (limit_latched(&u->limit))
+    t->flags |= TELEMFLAG_LIMIT;
+  if (u->holding)
+    t->flags |= TELEMFLAG_HOLD;
+  t->rxmoves = turret.proto.rxmoves, t->rxtrigs = turret.proto.rxtrigs;
+  t->rxdropped = turret.proto.rxdropped + turret.polldropped;
+  t->rxerrors = turret.proto.rxerrors;
+  t->shots = u->shots;
+  t->sweep = u->search.sweep;
+  t->searches = u->searches;
+  proto_seal((uint8_t *)t, TELEMSTATUS, sizeof(Telemetry) - 5);
+  thal_transmit((uint8_t *)t, sizeof(Telemetry));
+}
+
+static void applyAxes(TurretUnit *u) {
+  // the servos first, their bounds (in angle with a calibration table)
+  // limit the pid outputs
+  servo_setrange(&u->phiservo, PARAM(u, PHICENTER).i, PARAM(u, PHIMIN).i,
+                 PARAM(u, PHIMAX).i);
+  servo_setrange(&u->thtservo, PARAM(u, THTCENTER).i, PARAM(u, THTMIN).i,
+                 PARAM(u, THTMAX).i);
+  ctrl_tune(&u->ctrl.phi, PARAM(u, KPX).f, PARAM(u, KIX).f, PARAM(u, KDX).f,
+            u->phiservo.lo, u->phiservo.hi, PARAM(u, PIDRATE).i);
+  ctrl_tune(&u->ctrl.tht, PARAM(u, KPY).f, PARAM(u, KIY).f, PARAM(u, KDY).f,
+            u->thtservo.lo, u->thtservo.hi, PARAM(u, PIDRATE).i);
+  limit_setrange(&u->limit.phi, u->phiservo.lo, u->phiservo.hi);
+  limit_setrange(&u->limit.tht, u->thtservo.lo, u->thtservo.hi);
+  // the same targets may be other pulses now
+  u->remap = 1;
+}
+
+static void applyTrack(TurretUnit *u) {
+  track_tune(&u->track, PARAM(u, TRACKALPHA).f, PARAM(u, TRACKBETA).f,
+             PARAM(u, TRACKCOAST).i, PARAM(u, TRACKKX).f,
+             PARAM(u, TRACKKY).f, TRACKLAGMS);
+  search_tune(&u->search, PARAM(u, SEARCHPITCH).i, PARAM(u, SEARCHRATE).i,
+              PARAM(u, SEARCHSWEEPS).i);
+}
+
+static void takeSearch(TurretUnit *u) {
+  // the host saw its error from wherever the spiral had the camera, the
+  // pid continues from there instead of the last known direction
+  if (!search_take(&u->search))
+    return;
+  ctrl_aimaxis(&u->ctrl.phi, toQ16(u->phitraj.out));
+  ctrl_aimaxis(&u->ctrl.tht, toQ16(u->thttraj.out));
+}
+
+static void startSearch(TurretUnit *u) {
+  // once per loss, a move or track frame engages again
+  u->engaged = 0;
+  u->searches++;
+  track_reset(&u->track);
+  search_start(&u->search, u->ctrl.phi.target / 65536.f,
+               u->ctrl.tht.target / 65536.f);
+}
+
+static int32_t giveUp(TurretUnit *u, LimitAxis *l, CtrlAxis *c) {
+  // hold off the bound instead of pressing the servo against it
+  if (l->sat)
+    ctrl_aimaxis(c, limit_retreat(&u->limit, l));
+  return servo_q16_to_udeg(c->target);
+}
+
+static void checkLimits(TurretUnit *u, int phierr, int thterr) {
+  int sat = limit_update(&u->limit.phi, &u->ctrl.phi, phierr) |
+            limit_update(&u->limit.tht, &u->ctrl.tht, thterr);
+  if (!sat) {
+    u->boundcnt = PARAM(u, MAXBOUNDCNT).i;
+    return;
+  }
+  if (--u->boundcnt > 0)
+    return;
+  LimitFrame *f = &u->limittx;
+  f->sides = limit_sat(&u->limit);
+  f->phipos = giveUp(u, &u->limit.phi, &u->ctrl.phi);
+  f->thtpos = giveUp(u, &u->limit.tht, &u->ctrl.tht);
+  proto_seal((uint8_t *)f, TELEMLIMIT, sizeof(LimitFrame) - 5);
+  u->limitpending = 1;
+  // no extrapolating back into the bound
+  track_reset(&u->track);
+  u->boundcnt = PARAM(u, MAXBOUNDCNT).i;
+}
+
+static void applyPulses(TurretUnit *u, int olddflt, int oldtrig) {
+  // the table may be the host's (CMDTRIGTABLE), only the steps at the old
+  // rest and pull pulses follow
+  Trig *t = &u->trig;
+  TrigStep table[TRIGMAXSTEPS];
+  for (int i = 0; i < t->nsteps; i++) {
+    table[i] = t->table[i];
+    if (table[i].ccr == olddflt)
+      table[i].ccr = PARAM(u, DFLTPULSE).i;
+    else if (table[i].ccr == oldtrig)
+      table[i].ccr = PARAM(u, TRIGPULSE).i;
+  }
+  trig_settable(t, table, t->nsteps);
+  trig_setrest(t, PARAM(u, DFLTPULSE).i);
+}
+
+static int setParam(TurretUnit *u, int id, ParamValue v) {
+  int status = param_check(id, v);
+  if (status != PARAM_OK)
+    return status;
+  ParamValue p[PARAM_COUNT];
+  memcpy(p, turret.params.v[u->id], sizeof(p));
+  p[id] = v;
+  if (p[PARAM_PHIMIN].i > p[PARAM_PHICENTER].i ||
+      p[PARAM_PHICENTER].i > p[PARAM_PHIMAX].i ||
+      p[PARAM_THTMIN].i > p[PARAM_THTCENTER].i ||
+      p[PARAM_THTCENTER].i > p[PARAM_THTMAX].i)
+    return PARAM_RANGE;
+  int olddflt = PARAM(u, DFLTPULSE).i, oldtrig = PARAM(u, TRIGPULSE).i;
+  if (id == PARAM_DFLTPULSE || id == PARAM_TRIGPULSE) {
+    // the sequencer reads the table from its isr
+    if (u->trig.shotflag)
+      return PARAM_BUSY;
+    turret.params.v[u->id][id] = v;
+    applyPulses(u, olddflt, oldtrig);
+    return PARAM_OK;
+  }
+  turret.params.v[u->id][id] = v;
+  applyAxes(u);
+  applyTrack(u);
+  return PARAM_OK;
+}
+
+static void applyParam(TurretUnit *u) {
+  // the tick preempts turret_poll(): it leaves the unit alone until the
+  // servo ranges, pid limits and filter agree again
+  u->applying = 1;
+  int status = setParam(u, u->paramid, u->paramval);
+  u->applying = 0;
+  turret.paramunit = u->id;
+  turret.paramstatus = status;
+  turret.paramnext = u->paramid;
+  turret.paramend = u->paramid + 1;
+  u->paramflag = 0;
+}
+
+static void applyLut(TurretUnit *u) {
+  // positions keep their value and mean true angles from here on, the next
+  // tick moves the axis by the difference. The pid limits follow the new
+  // bounds
+  Servo *s = u->lutaxis == 0 ? &u->phiservo : &u->thtservo;
+  u->applying = 1;
+  if (servo_setlut(s, u->lutstart, u->lutstep, u->lutccr, u->lutn))
+    applyAxes(u);
+  else
+    turret.polldropped++;
+  u->applying = 0;
+  u->lutflag = 0;
+}
+
+static void commitParams(void) {
+  // blocks the main loop (poll task) for the write, about a second when
+  // the sector needs an erase; the interrupts keep the turret going
+  ParamCommitFrame *c = &turret.committx;
+  int erased;
+  c->ok = param_commit(&turret.params, &erased);
+  c->erased = erased;
+  c->seq = turret.params.seq;
+  c->used = turret.params.used;
+  c->size = thal_flashsize();
+  proto_seal((uint8_t *)c, TELEMPARAMCOMMIT, sizeof(ParamCommitFrame) - 5);
+  turret.commitpending = 1;
+}
+
+static void sendAimDone(TurretUnit *u) {
+  AimDone *a = &u->aimdone;
+  proto_seal((uint8_t *)a, TELEMAIMDONE, sizeof(AimDone) - 5);
+  thal_transmit((uint8_t *)a, sizeof(AimDone));
+}
+
+static void sendTrackAck(TurretUnit *u) {
+  TrackAck *k = &u->tracktx;
+  k->stamp = u->ackstamp;
+  k->rxtick = u->ackrxtick;
+  k->setcycles = u->ackset;
+  k->ccrcycles = u->ackccr;
+  proto_seal((uint8_t *)k, TELEMTRACKACK, sizeof(TrackAck) - 5);
+  thal_transmit((uint8_t *)k, sizeof(TrackAck));
+}
+
+static void unitDefaults(int id) {
+  // the descriptor's geometry, under the committed values
+  const UnitDesc *d = &turret_units[id];
+  ParamValue *v = turret.params.v[id];
+  v[PARAM_PHICENTER].i = d->phi.center;
+  v[PARAM_PHIMIN].i = d->phi.min;
+  v[PARAM_PHIMAX].i = d->phi.max;
+  v[PARAM_THTCENTER].i = d->tht.center;
+  v[PARAM_THTMIN].i = d->tht.min;
+  v[PARAM_THTMAX].i = d->tht.max;
+}
+
+static void unitInit(TurretUnit *u, int id) {
+  const UnitDesc *d = &turret_units[id];
+  u->id = id;
+  u->desc = d;
+  ctrl_init(&u->ctrl);
+  dbuf_init(&u->setpoint);
+  trig_init(&u->trig, d->trig.out, d->trig.table, d->trig.nsteps,
+            DFLTPULSE);
+  applyPulses(u, DFLTPULSE, TRIGPULSE);
+  limit_init(&u->limit, LIMITBACKOFF);
+  track_init(&u->track);
+  search_init(&u->search);
+  applyTrack(u);
+  trig_setburst(&u->trig, BURSTSHOTS, BURSTINTERVAL, COOLDOWNMS);
+  motor_init(&u->motor, d->trig.motor, MOTORDUTY, MOTORRAMPMS, MOTORIDLEMS);
+  u->hold = BURSTHOLD;
+  u->losstimeout = TRACKLOSSMS;
+  u->boundcnt = PARAM(u, MAXBOUNDCNT).i;
+  traj_init(&u->phitraj, 0, PHIVMAX, PHIAMAX, PHIJMAX);
+  traj_init(&u->thttraj, 0, THTVMAX, THTAMAX, THTJMAX);
+  traj_shape(&u->phitraj, SHAPEHZ, SHAPEZETA, 1.0f / TICKHZ);
+  traj_shape(&u->thttraj, SHAPEHZ, SHAPEZETA, 1.0f / TICKHZ);
+  servo_init(&u->thtservo, d->tht.servo, PARAM(u, THTCENTER).i,
+             PARAM(u, THTMIN).i, PARAM(u, THTMAX).i);
+  servo_init(&u->phiservo, d->phi.servo, PARAM(u, PHICENTER).i,
+             PARAM(u, PHIMIN).i, PARAM(u, PHIMAX).i);
+  if (d->phi.lutn)
+    servo_setlut(&u->phiservo, d->phi.lutstart, d->phi.lutstep, d->phi.lut,
+                 d->phi.lutn);
+  if (d->tht.lutn)
+    servo_setlut(&u->thtservo, d->tht.lutstart, d->tht.lutstep, d->tht.lut,
+                 d->tht.lutn);
+  applyAxes(u);
+}
+
+void turret_init(void) {
+  memset(&turret, 0, sizeof(turret));
+  proto_init(&turret.proto);
+  // the compile-time values, unless the flash has a committed set
+  param_defaults(&turret.params);
+  for (int i = 0; i < TURRETS; i++)
+    unitDefaults(i);
+  param_load(&turret.params);
+  for (int i = 0; i < TURRETS; i++)
+    unitInit(&turret.unit[i], i);
+  turret.telemetry = 1;
+  // the target starts the TICKHZ timer, the first ticks write the pulses
+  turret.ticking = 1;
+  turret.profnext = PROF_NPROBES;
+  turret.osnext = -1;
+}
+
+void turret_rxbyte(uint8_t byte) {
+  TurretUnit *u = &turret.unit[turret.rxunit];
+  switch (proto_feed(&turret.proto, byte)) {
+  case PROTO_MOVE:
+    // any command ends a search spiral at once, turret_poll() takes over
+    search_stop(&u->search);
+    if (u->moveflag == 0) {
+      turret.cmdstamp = turret.rxstamp;
+      u->movex = turret.proto.oper[1], u->movey = turret.proto.oper[2];
+      u->moveflag = 1;
+    } else
+      turret.proto.rxdropped++;
+    break;
+  case PROTO_TRACK:
+    search_stop(&u->search);
+    if (u->trackflag == 0) {
+      turret.cmdstamp = turret.rxstamp;
+      u->trackstamp = turret.proto.trackstamp;
+      u->trackx = turret.proto.trackx, u->tracky = turret.proto.tracky;
+      u->trackrx = turret.rxstamp;
+      u->trackrxtick = thal_millis();
+      u->trackflag = 1;
+    } else
+      turret.proto.rxdropped++;
+    break;
+  case PROTO_TRIG:
+    search_stop(&u->search);
+    // not while turret_poll() rewrites the pulse table
+    if (u->applying || !trig_request(&u->trig)) {
+      turret.proto.rxdropped++;
+      break;
+    }
+    motor_spin(&u->motor);
+    if (u->hold) {
+      u->holding = 1;
+      u->lasttrack = thal_millis();
+    }
+    break;
+  case PROTO_BURST:
+    // same isr priority as the trigger timers, nothing else touches trig
+    if (!trig_setburst(&u->trig, turret.proto.burstshots,
+                       turret.proto.burstinterval,
+                       turret.proto.burstcooldown)) {
+      turret.proto.rxdropped++;
+      break;
+    }
+    u->hold = turret.proto.bursthold;
+    u->losstimeout = turret.proto.burstloss;
+    break;
+  case PROTO_CENTER:
+    if (trig_abort(&u->trig))
+      sendResult(u, RES_DON);
+    u->boundcnt = PARAM(u, MAXBOUNDCNT).i;
+    u->centerflag = 1;
+    // the host is done with the target, no idle hold
+    motor_stop(&u->motor);
+    break;
+  case PROTO_SPIN:
+    // sent as soon as a bird is detected, ahead of the first move
+    if (turret.proto.spin)
+      motor_spin(&u->motor);
+    else
+      motor_stop(&u->motor);
+    break;
+  case PROTO_PROF:
+    // turret_poll() sends one frame per probe, between the telemetry
+    if (turret.proto.prof & PROF_DUMP)
+      turret.profnext = 0;
+    if (turret.proto.prof & PROF_RESET)
+      turret.profreset = 1;
+    break;
+  case PROTO_RTOSSTATS:
+    // frames of the target, none on bare metal
+    turret.osnext = 0;
+    break;
+  case PROTO_PARAMGET:
+    // turret_poll() sends them, one frame per parameter
+    turret.paramunit = u->id;
+    turret.paramstatus = PARAM_OK;
+    if (turret.proto.paramid == PARAM_ALL) {
+      turret.paramnext = 0;
+      turret.paramend = PARAM_COUNT;
+    } else {
+      if (turret.proto.paramid >= PARAM_COUNT)
+        turret.paramstatus = PARAM_UNKNOWN;
+      turret.paramnext = turret.proto.paramid;
+      turret.paramend = turret.proto.paramid + 1;
+    }
+    break;
+  case PROTO_PARAMSET:
+    // turret_poll() applies it, the tick must not see half of it
+    if (u->paramflag == 0) {
+      u->paramid = turret.proto.paramid;
+      u->paramval.i = (int32_t)turret.proto.paramraw;
+      u->paramflag = 1;
+    } else
+      turret.proto.rxdropped++;
+    break;
+  case PROTO_PARAMCOMMIT:
+    turret.commitflag = 1;
+    break;
+  case PROTO_SERVOLUT: {
+    // turret_poll() loads it, the tick must not see the bounds half moved
+    Proto *p = &turret.proto;
+    if (p->lutaxis > 1 || u->lutflag) {
+      p->rxdropped++;
+      break;
+    }
+    u->lutaxis = p->lutaxis;
+    u->lutstart = p->lutstart, u->lutstep = p->lutstep;
+    memcpy(u->lutccr, p->lutccr, p->lutn * sizeof(p->lutccr[0]));
+    u->lutn = p->lutn;
+    u->lutflag = 1;
+    break;
+  }
+  case PROTO_MOTORCFG:
+    if (!motor_config(&u->motor, turret.proto.motorduty,
+                      turret.proto.motorramp, turret.proto.motoridle))
+      turret.proto.rxdropped++;
+    break;
+  case PROTO_TRIGTABLE:
+    // only between shots, the sequencer reads the table from its isr
+    if (!trig_settable(&u->trig, turret.proto.trigtable,
+                       turret.proto.trignsteps))
+      turret.proto.rxdropped++;
+    break;
+  case PROTO_AIM:
+    search_stop(&u->search);
+    if (u->aimflag == 0) {
+      turret.cmdstamp = turret.rxstamp;
+      u->aimnext = turret.proto.aimid;
+      u->aimphi = turret.proto.aimphi, u->aimtht = turret.proto.aimtht;
+      u->aimflag = 1;
+    } else
+      turret.proto.rxdropped++;
+    break;
+  case PROTO_UNIT:
+    if (turret.proto.unit < TURRETS)
+      turret.rxunit = turret.proto.unit;
+    else
+      turret.proto.rxdropped++;
+    break;
+  }
+}
+
+void turret_rxerror(void) { turret.proto.rxerrors++; }
+
+static TurretUnit *trigUnit(int out) {
+  for (int i = 0; i < TURRETS; i++)
+    if (turret.unit[i].trig.out == out)
+      return &turret.unit[i];
+  return 0;
+}
+
+void turret_trigtick(int out) {
+  TurretUnit *u = trigUnit(out);
+  if (!u)
+    return;
+  int r = trig_step(&u->trig);
+  if (r == TRIG_BUSY || r == TRIG_IDLE)
+    return;
+  u->shots++;
+  // tracking goes on between the cycles of a burst
+  if (r == TRIG_SHOT)
+    return;
+  u->boundcnt = PARAM(u, MAXBOUNDCNT).i;
+  if (!u->hold)
+    u->centerflag = 1;
+  sendResult(u, RES_DON);
+}
+
+void turret_cooldown(int out) {
+  TurretUnit *u = trigUnit(out);
+  if (u)
+    trig_cooldown(&u->trig);
+}
+
+static void stepUnit(TurretUnit *u, float dt, int32_t pos[2]) {
+  // both targets from the same turret_poll(), never one old and one new
+  Setpoint sp;
+  dbuf_read(&u->setpoint, &sp);
+  u->tickphi = sp.phi;
+  u->ticktht = sp.tht;
+  float phi = u->tickphi / 65536.f;
+  float tht = u->ticktht / 65536.f;
+  const float lo[2] = {u->phiservo.lo / 65536.f, u->thtservo.lo / 65536.f};
+  const float hi[2] = {u->phiservo.hi / 65536.f, u->thtservo.hi / 65536.f};
+  // a search spiral goes around the ctrl targets without moving them,
+  // between camera frames the filter estimate moves on with the bird
+  if (!search_step(&u->search, dt, lo, hi, &phi, &tht) &&
+      track_target(&u->track, thal_millis(), &phi, &tht)) {
+    phi = clampf(phi, lo[0], hi[0]);
+    tht = clampf(tht, lo[1], hi[1]);
+  }
+  traj_target(&u->phitraj, phi);
+  traj_target(&u->thttraj, tht);
+  phi = traj_step(&u->phitraj, dt);
+  tht = traj_step(&u->thttraj, dt);
+  // what the camera will have seen the next track frames from
+  track_pose(&u->track, thal_millis(), phi, tht);
+  pos[0] = toQ16(phi);
+  pos[1] = toQ16(tht);
+}
+
+static int unitIdle(const TurretUnit *u, uint32_t now) {
+  // nothing left for the tick to move, ramp, time or report. A target
+  // changed since the last tick (poll, a recenter from the trigger isr)
+  // still has to reach the trajectory
+  return !u->applying && !u->remap && !u->aiming && !u->trackacking &&
+         !u->search.active && !u->trig.active && !motor_busy(&u->motor) &&
+         !track_moving(&u->track, now) && u->tickphi == u->ctrl.phi.target &&
+         u->ticktht == u->ctrl.tht.target && traj_done(&u->phitraj) &&
+         traj_done(&u->thttraj);
+}
+
+static int idle(void) {
+  if (turret.cmdpending)
+    return 0;
+  uint32_t now = thal_millis();
+  for (int i = 0; i < TURRETS; i++)
+    if (!unitIdle(&turret.unit[i], now))
+      return 0;
+  return 1;
+}
+
+void turret_tick(void) {
+  PROF_BEGIN(PROF_TICK);
+  const float dt = 1.0f / TICKHZ;
+  int32_t pos[TURRETS][2];
+  int held[TURRETS];
+  for (int i = 0; i < TURRETS; i++) {
+    // a unit whose settings turret_poll() is changing keeps its pulses
+    held[i] = turret.unit[i].applying;
+    if (!held[i])
+      stepUnit(&turret.unit[i], dt, pos[i]);
+  }
+  // every axis of every unit on the same PWM frame
+  thal_ccrhold(1);
+  for (int i = 0; i < TURRETS; i++) {
+    if (held[i])
+      continue;
+    servo_write(&turret.unit[i].phiservo, pos[i][0]);
+    servo_write(&turret.unit[i].thtservo, pos[i][1]);
+    turret.unit[i].remap = 0;
+  }
+  thal_ccrhold(0);
+  if (turret.cmdpending) {
+    PROF_SINCE(PROF_CMDPWM, turret.cmdstamp);
+    turret.cmdpending = 0;
+  }
+  for (int i = 0; i < TURRETS; i++) {
+    TurretUnit *u = &turret.unit[i];
+    if (u->trackacking) {
+      u->ackccr = thal_cycles() - u->trackrx;
+      u->trackacking = 0;
+      u->ackpending = 1;
+    }
+  }
+  for (int i = 0; i < TURRETS; i++) {
+    TurretUnit *u = &turret.unit[i];
+    // a burst holds the motor however long it takes
+    motor_tick(&u->motor, u->trig.active);
+    if (u->aiming && traj_done(&u->phitraj) && traj_done(&u->thttraj))
+      aimEnd(u, u->aimlimited ? AIM_LIMITED : AIM_ARRIVED);
+  }
+  // settled: no more wake-ups until turret_poll() has new work
+  if (idle()) {
+    turret.ticking = 0;
+    thal_ticktimer(0);
+  }
+  PROF_END(PROF_TICK);
+}
+
+static void pollUnit(TurretUnit *u) {
+  // recenters from the rx and trigger isrs: only turret_poll() writes the
+  // targets
+  if (u->centerflag) {
+    u->centerflag = 0;
+    disengage(u);
+  }
+  // stopped by a command from the rx side
+  takeSearch(u);
+
+  if (u->paramflag)
+    applyParam(u);
+  if (u->lutflag)
+    applyLut(u);
+
+  if (u->moveflag) {
+    PROF_BEGIN(PROF_MOVE);
+    // the frame may have come in while a spiral was being started below
+    search_stop(&u->search);
+    takeSearch(u);
+    // start dc motor, or keep it from idling out
+    motor_spin(&u->motor);
+
+    // an error frame takes over from an absolute aim, or the filter
+    aimEnd(u, AIM_PREEMPTED);
+    track_reset(&u->track);
+
+    // caculate pwm duty cycle
+    int phierr = limit_error(&u->limit.phi, -u->movex);
+    int thterr = limit_error(&u->limit.tht, u->movey);
+    ctrl_move(&u->ctrl, phierr, thterr);
+
+    // check bound: out of reach for MAXBOUNDCNT frames, give up
+    checkLimits(u, phierr, thterr);
+
+    // new setpoint, turret_tick() moves the servos there
+    u->lasttrack = thal_millis();
+    u->engaged = 1;
+
+    // reset flag
+    u->moveflag = 0;
+    PROF_END(PROF_MOVE);
+    PROF_SINCE(PROF_CMDLAT, turret.cmdstamp);
+    turret.cmdpending = 1;
+  }
+
+  if (u->trackflag) {
+    PROF_BEGIN(PROF_MOVE);
+    search_stop(&u->search);
+    takeSearch(u);
+    motor_spin(&u->motor);
+    aimEnd(u, AIM_PREEMPTED);
+    int phierr = limit_error(&u->limit.phi, -u->trackx);
+    int thterr = limit_error(&u->limit.tht, u->tracky);
+    int32_t lo[2] = {u->phiservo.lo, u->thtservo.lo};
+    int32_t hi[2] = {u->phiservo.hi, u->thtservo.hi};
+    int32_t phi = u->ctrl.phi.target, tht = u->ctrl.tht.target;
+    track_update(&u->track, phierr, thterr, u->trackstamp, lo, hi, &phi,
+                 &tht);
+    // the pid picks up from the estimate if MOVEOP frames come back
+    ctrl_aimaxis(&u->ctrl.phi, phi);
+    ctrl_aimaxis(&u->ctrl.tht, tht);
+    checkLimits(u, phierr, thterr);
+    u->lasttrack = thal_millis();
+    u->engaged = 1;
+    u->trackflag = 0;
+    // acked at the first CCR write towards the estimate, the last frame
+    // wins while the tx is busy
+    if (!u->trackacking) {
+      u->ackstamp = u->trackstamp;
+      u->ackrxtick = u->trackrxtick;
+      u->ackset = thal_cycles() - u->trackrx;
+      u->trackacking = 1;
+    }
+    PROF_END(PROF_MOVE);
+    PROF_SINCE(PROF_CMDLAT, turret.cmdstamp);
+    turret.cmdpending = 1;
+  }
+
+  if (u->aimflag) {
+    // one-shot slew: the S-curve goes straight to the new target
+    aimEnd(u, AIM_PREEMPTED);
+    motor_spin(&u->motor);
+    int32_t phi = servo_udeg_to_q16(u->aimphi);
+    int32_t tht = servo_udeg_to_q16(u->aimtht);
+    // clamped by the pid limits, AimDone tells the host
+    u->aimlimited = phi < u->phiservo.lo || phi > u->phiservo.hi ||
+                    tht < u->thtservo.lo || tht > u->thtservo.hi;
+    limit_release(&u->limit);
+    track_reset(&u->track);
+    // an absolute aim is the host's choice, nothing to search around
+    search_cancel(&u->search);
+    u->engaged = 0;
+    u->boundcnt = PARAM(u, MAXBOUNDCNT).i;
+    ctrl_aim(&u->ctrl, phi, tht);
+    u->aimid = u->aimnext;
+    u->aiming = 1;
+    u->lasttrack = thal_millis();
+    u->aimflag = 0;
+    PROF_SINCE(PROF_CMDLAT, turret.cmdstamp);
+    turret.cmdpending = 1;
+  }
+
+  // silence on a target: look around where it was last seen
+  if (u->engaged && PARAM(u, SEARCHDELAY).i && !u->trig.active &&
+      !u->moveflag && !u->trackflag &&
+      thal_millis() - u->lasttrack >= (uint32_t)PARAM(u, SEARCHDELAY).i)
+    startSearch(u);
+  // nothing found after the last sweep
+  if (u->search.done) {
+    u->search.done = 0;
+    disengage(u);
+  }
+
+  // track loss ends a hold, never in the middle of a burst or a search
+  if (u->holding && !u->trig.active && !u->search.active &&
+      thal_millis() - u->lasttrack >= u->losstimeout)
+    disengage(u);
+
+  publish(u);
+}
+
+static int txUnit(int id) {
+  // frames of another unit go behind a TELEMUNIT, 0 while it is sent
+  if (id == turret.txunit)
+    return 1;
+  turret.txunit = id;
+  turret.unittx.unit = id;
+  proto_seal((uint8_t *)&turret.unittx, TELEMUNIT, sizeof(UnitFrame) - 5);
+  thal_transmit((uint8_t *)&turret.unittx, sizeof(UnitFrame));
+  return 0;
+}
+
+static int sendUnit(TurretUnit *u) {
+  // 1 if the unit had something for tx
+  if (!u->respending && !u->aimpending && !u->limitpending &&
+      !u->ackpending)
+    return 0;
+  if (!txUnit(u->id))
+    return 1;
+  if (u->respending) {
+    u->respending = 0;
+    thal_transmit(&u->resbuf, 1);
+  } else if (u->aimpending) {
+    u->aimpending = 0;
+    sendAimDone(u);
+  } else if (u->limitpending) {
+    u->limitpending = 0;
+    thal_transmit((uint8_t *)&u->limittx, sizeof(LimitFrame));
+  } else {
+    u->ackpending = 0;
+    sendTrackAck(u);
+  }
+  return 1;
+}
+
+static void sendNext(void) {
+  // one transfer at a time, result bytes go before telemetry
+  for (int i = 0; i < TURRETS; i++)
+    if (sendUnit(&turret.unit[i]))
+      return;
+  if (turret.commitpending) {
+    turret.commitpending = 0;
+    thal_transmit((uint8_t *)&turret.committx, sizeof(ParamCommitFrame));
+  } else if (turret.paramnext < turret.paramend) {
+    if (!txUnit(turret.paramunit))
+      return;
+    param_frame(&turret.paramtx, &turret.params, turret.paramunit,
+                turret.paramnext++, turret.paramstatus);
+    thal_transmit((uint8_t *)&turret.paramtx, sizeof(ParamFrame));
+  } else if (turret.profnext < PROF_NPROBES) {
+    prof_frame(&turret.proftx, turret.profnext++);
+    thal_transmit((uint8_t *)&turret.proftx, sizeof(ProfFrame));
+  } else if (turret.osnext >= 0) {
+    const uint8_t *frame;
+    int len = thal_osframe(turret.osnext++, &frame);
+    if (len > 0)
+      thal_transmit(frame, len);
+    else
+      turret.osnext = -1;
+  } else if (turret.telemetry &&
+             thal_millis() - turret.telemtick >= TELEMPERIOD) {
+    // the units take turns
+    if (!txUnit(turret.telemunit))
+      return;
+    turret.telemtick = thal_millis();
+    sendTelemetry(&turret.unit[turret.telemunit]);
+    turret.telemunit = (turret.telemunit + 1) % TURRETS;
+  }
+}
+
+void turret_poll(void) {
+  for (int i = 0; i < TURRETS; i++)
+    pollUnit(&turret.unit[i]);
+
+  if (turret.commitflag) {
+    turret.commitflag = 0;
+    commitParams();
+  }
+
+  if (turret.profreset && turret.profnext >= PROF_NPROBES) {
+    turret.profreset = 0;
+    prof_reset();
+  }
+
+  // after the units: their new targets are what makes the turret busy.
+  // A tick that stopped the timer before that has finished by now
+  if (!turret.ticking && !idle()) {
+    turret.ticking = 1;
+    thal_ticktimer(1);
+  }
+
+  if (thal_txready())
+    sendNext();
+}
@@ -0,0 +1,60 @@
+/**
+ ******************************************************************************
+ * @file    turret_ctrl.c
+ * @brief   Pan/tilt control law: pixel error -> servo pulse.
+ *
+ * The camera rides on the turret, so the error is relative to the current
+ * aim: the integral term holds the aim and KIX/KIY play the part of the old
+ * `phipulse += kpx * err` gain. KP/KD add lead on top of it.
+ ******************************************************************************
+ */
+#include "turret_ctrl.h"
+#include "turret_config.h"
+
+static void axisInit(CtrlAxis *a, float kp, float ki, float kd, int center,
+                     int min, int max) {
+  pid_init(&a->pid, PID_Q15(kp), PID_Q15(ki), PID_Q15(kd),
+           (min - center) * 65536, (max - center) * 65536, PID_Q16(PIDRATE));
+  a->target = 0;
+}
+
+void ctrl_tune(CtrlAxis *a, float kp, float ki, float kd, int32_t lo,
+               int32_t hi, int rate) {
+  pid_tune(&a->pid, PID_Q15(kp), PID_Q15(ki), PID_Q15(kd), lo, hi,
+           rate * 65536);
+  a->target = a->pid.out;
+}
+
+static void axisMove(CtrlAxis *a, int err) {
+  // keeps the fraction, turret_servo rounds at the register
+  a->target = pid_update(&a->pid, err);
+}
+
+void ctrl_init(Ctrl *c) {
+  axisInit(&c->phi, KPX, KIX, KDX, PHICENTER, PHIMIN, PHIMAX);
+  axisInit(&c->tht, KPY, KIY, KDY, THTCENTER, THTMIN, THTMAX);
+}
+
+void ctrl_reset(Ctrl *c) {
+  pid_reset(&c->phi.pid, 0);
+  pid_reset(&c->tht.pid, 0);
+  c->phi.target = c->tht.target = 0;
+}
+
+static void axisAim(CtrlAxis *a, int32_t pos) {
+  // the integrator holds the aim, so it is the part that jumps
+  pid_reset(&a->pid, pos);
+  a->target = a->pid.out;
+}
+
+void ctrl_aimaxis(CtrlAxis *a, int32_t pos) { axisAim(a, pos); }
+
+void ctrl_aim(Ctrl *c, int32_t phi, int32_t tht) {
+  axisAim(&c->phi, phi);
+  axisAim(&c->tht, tht);
+}
+
+void ctrl_move(Ctrl *c, int phierr, int thterr) {
+  axisMove(&c->phi, phierr);
+  axisMove(&c->tht, thterr);
+}
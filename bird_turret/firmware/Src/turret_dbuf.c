@@ -0,0 +1,30 @@
+/**
+ ******************************************************************************
+ * @file    turret_dbuf.c
+ * @brief   Lock-free double buffer for the setpoint handed to the control
+ *          loop.
+ ******************************************************************************
+ */
+#include "turret_dbuf.h"
+#include <string.h>
+
+void dbuf_init(SetpointBuf *b) { memset(b, 0, sizeof(*b)); }
+
+void dbuf_write(SetpointBuf *b, const Setpoint *sp) {
+  uint32_t seq = b->seq;
+  b->slot[(seq + 1) & 1] = *sp;
+  // the slot must be complete before a reader can pick it (dmb on the M4)
+  __sync_synchronize();
+  b->seq = seq + 1;
+}
+
+uint32_t dbuf_read(SetpointBuf *b, Setpoint *sp) {
+  uint32_t seq;
+  do {
+    seq = b->seq;
+    __sync_synchronize();
+    *sp = b->slot[seq & 1];
+    __sync_synchronize();
+  } while (b->seq != seq);
+  return seq;
+}
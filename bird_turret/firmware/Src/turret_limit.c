@@ -0,0 +1,65 @@
+/**
+ ******************************************************************************
+ * @file    turret_limit.c
+ * @brief   Workspace limits: saturation of the setpoints and giving up.
+ ******************************************************************************
+ */
+#include "turret_limit.h"
+
+static int sides(int8_t v, int lo, int hi) {
+  return v < 0 ? lo : v > 0 ? hi : 0;
+}
+
+void limit_init(Limit *l, int backoff) {
+  l->phi.sat = l->phi.latched = 0;
+  l->tht.sat = l->tht.latched = 0;
+  l->backoff = backoff * 65536;
+}
+
+void limit_setrange(LimitAxis *a, int32_t lo, int32_t hi) {
+  a->lo = lo, a->hi = hi;
+}
+
+int limit_error(LimitAxis *a, int err) {
+  if (!a->latched || err == 0)
+    return err;
+  if ((err > 0) == (a->latched > 0))
+    return 0;
+  a->latched = 0;
+  return err;
+}
+
+int limit_update(LimitAxis *a, const CtrlAxis *c, int err) {
+  // the pid output grows with the error
+  if (c->target >= a->hi && err > 0)
+    a->sat = 1;
+  else if (c->target <= a->lo && err < 0)
+    a->sat = -1;
+  else
+    a->sat = 0;
+  return a->sat;
+}
+
+int32_t limit_retreat(Limit *l, LimitAxis *a) {
+  // half the range at most, a narrow axis ends up in the middle
+  int32_t back = l->backoff, half = (a->hi - a->lo) / 2;
+  back = back < half ? back : half;
+  a->latched = a->sat;
+  a->sat = 0;
+  return a->latched > 0 ? a->hi - back : a->lo + back;
+}
+
+int limit_sat(const Limit *l) {
+  return sides(l->phi.sat, LIMIT_PHILO, LIMIT_PHIHI) |
+         sides(l->tht.sat, LIMIT_THTLO, LIMIT_THTHI);
+}
+
+int limit_latched(const Limit *l) {
+  return sides(l->phi.latched, LIMIT_PHILO, LIMIT_PHIHI) |
+         sides(l->tht.latched, LIMIT_THTLO, LIMIT_THTHI);
+}
+
+void limit_release(Limit *l) {
+  l->phi.sat = l->phi.latched = 0;
+  l->tht.sat = l->tht.latched = 0;
+}
@@ -0,0 +1,65 @@
+/**
+ ******************************************************************************
+ * @file    turret_motor.c
+ * @brief   Launcher dc motor: soft start and idle hold.
+ ******************************************************************************
+ */
+#include "turret_motor.h"
+#include "turret_config.h"
+#include "turret_hal.h"
+
+void motor_init(Motor *m, int out, int runduty, int rampms, int idlehold) {
+  m->out = out;
+  m->enabled = 0;
+  m->lastuse = 0;
+  m->duty = 0;
+  if (!motor_config(m, runduty, rampms, idlehold))
+    motor_config(m, MOTORDUTY, MOTORRAMPMS, MOTORIDLEMS);
+  thal_motor(m->out, 0);
+}
+
+int motor_config(Motor *m, int runduty, int rampms, int idlehold) {
+  if (runduty < 1 || runduty > 1000 || rampms < 0 || idlehold < 1)
+    return 0;
+  int ticks = rampms * TICKHZ / 1000;
+  // no ramp: straight to the run duty, as the old on/off pin
+  m->ramp = ticks > 0 ? runduty * 65536 / ticks : runduty * 65536;
+  m->runduty = runduty;
+  m->idlehold = idlehold;
+  return 1;
+}
+
+void motor_spin(Motor *m) {
+  m->lastuse = thal_millis();
+  m->enabled = 1;
+}
+
+void motor_stop(Motor *m) { m->enabled = 0; }
+
+void motor_tick(Motor *m, int busy) {
+  uint32_t now = thal_millis();
+  if (busy)
+    m->lastuse = now;
+  int32_t want = 0;
+  if (m->enabled && now - m->lastuse < m->idlehold)
+    want = m->runduty * 65536;
+  if (m->duty == want)
+    return;
+  // ramp up only, the motor coasts down on its own
+  if (m->duty < want && want - m->duty > m->ramp)
+    m->duty += m->ramp;
+  else
+    m->duty = want;
+  thal_motor(m->out, (m->duty + 0x8000) >> 16);
+}
+
+int motor_on(const Motor *m) { return m->duty > 0; }
+
+int motor_busy(const Motor *m) {
+  return m->duty > 0 ||
+         (m->enabled && thal_millis() - m->lastuse < m->idlehold);
+}
+
+int motor_ready(const Motor *m) {
+  return m->duty > 0 && m->duty == m->runduty * 65536;
+}
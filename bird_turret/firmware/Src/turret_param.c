@@ -0,0 +1,193 @@
+/**
+ ******************************************************************************
+ * @file    turret_param.c
+ * @brief   Run-time parameter table, persisted in a reserved flash sector.
+ ******************************************************************************
+ */
+#include "turret_param.h"
+#include "turret_config.h"
+#include "turret_hal.h"
+#include "turret_proto.h"
+#include <string.h>
+
+#define PARAM_MAGIC 0x54505232u  // "TPR2": count is units << 16 | values
+#define PARAM_MAGIC1 0x54505231u // "TPR1": one unit, count is values
+#define PARAM_ERASED 0xffffffffu
+
+#define I(x) {.i = (x)}
+#define F(x) {.f = (x)}
+// servo pulses stay inside 500..2500us
+#define PULSEMIN (TIM3HZ / 2000)
+#define PULSEMAX (TIM3HZ / 400)
+
+const ParamDesc param_desc[PARAM_COUNT] = {
+    [PARAM_PHICENTER] = {"phicenter", PARAM_INT, I(PULSEMIN), I(PULSEMAX),
+                         I(PHICENTER)},
+    [PARAM_THTCENTER] = {"thtcenter", PARAM_INT, I(PULSEMIN), I(PULSEMAX),
+                         I(THTCENTER)},
+    [PARAM_PHIMIN] = {"phimin", PARAM_INT, I(PULSEMIN), I(PULSEMAX),
+                      I(PHIMIN)},
+    [PARAM_PHIMAX] = {"phimax", PARAM_INT, I(PULSEMIN), I(PULSEMAX),
+                      I(PHIMAX)},
+    [PARAM_THTMIN] = {"thtmin", PARAM_INT, I(PULSEMIN), I(PULSEMAX),
+                      I(THTMIN)},
+    [PARAM_THTMAX] = {"thtmax", PARAM_INT, I(PULSEMIN), I(PULSEMAX),
+                      I(THTMAX)},
+    [PARAM_DFLTPULSE] = {"dfltpulse", PARAM_INT, I(PULSEMIN), I(PULSEMAX),
+                         I(DFLTPULSE)},
+    [PARAM_TRIGPULSE] = {"trigpulse", PARAM_INT, I(PULSEMIN), I(PULSEMAX),
+                         I(TRIGPULSE)},
+    [PARAM_MAXBOUNDCNT] = {"maxboundcnt", PARAM_INT, I(1), I(255),
+                           I(MAXBOUNDCNT)},
+    [PARAM_KPX] = {"kpx", PARAM_FLOAT, F(0), F(50), F(KPX)},
+    [PARAM_KIX] = {"kix", PARAM_FLOAT, F(0), F(50), F(KIX)},
+    [PARAM_KDX] = {"kdx", PARAM_FLOAT, F(0), F(50), F(KDX)},
+    [PARAM_KPY] = {"kpy", PARAM_FLOAT, F(0), F(50), F(KPY)},
+    [PARAM_KIY] = {"kiy", PARAM_FLOAT, F(0), F(50), F(KIY)},
+    [PARAM_KDY] = {"kdy", PARAM_FLOAT, F(0), F(50), F(KDY)},
+    [PARAM_PIDRATE] = {"pidrate", PARAM_INT, I(0), I(PULSEMAX),
+                       I(PIDRATE)},
+    [PARAM_TRACKALPHA] = {"trackalpha", PARAM_FLOAT, F(0), F(1),
+                          F(TRACKALPHA)},
+    [PARAM_TRACKBETA] = {"trackbeta", PARAM_FLOAT, F(0), F(1), F(TRACKBETA)},
+    [PARAM_TRACKCOAST] = {"trackcoast", PARAM_INT, I(0), I(2000),
+                          I(TRACKCOASTMS)},
+    [PARAM_TRACKKX] = {"trackkx", PARAM_FLOAT, F(0), F(100), F(TRACKKX)},
+    [PARAM_TRACKKY] = {"trackky", PARAM_FLOAT, F(0), F(100), F(TRACKKY)},
+    [PARAM_SEARCHDELAY] = {"searchdelay", PARAM_INT, I(0), I(60000),
+                           I(SEARCHDELAYMS)},
+    [PARAM_SEARCHPITCH] = {"searchpitch", PARAM_INT, I(30), I(3000),
+                           I(SEARCHPITCH)},
+    [PARAM_SEARCHRATE] = {"searchrate", PARAM_INT, I(100), I(10000),
+                          I(SEARCHRATE)},
+    [PARAM_SEARCHSWEEPS] = {"searchsweep", PARAM_INT, I(1), I(20),
+                            I(SEARCHSWEEPS)},
+};
+
+typedef struct {
+  uint32_t magic;
+  uint32_t seq;
+  uint32_t count; // values per unit that follow, then the crc32 of all
+} ParamHeader;
+
+static uint32_t crc32(const uint8_t *data, int len) {
+  // bitwise, a commit is rare and the sector is scanned once at boot
+  uint32_t crc = ~0u;
+  while (len--) {
+    crc ^= *data++;
+    for (int i = 0; i < 8; i++)
+      crc = crc & 1 ? (crc >> 1) ^ 0xedb88320u : crc >> 1;
+  }
+  return ~crc;
+}
+
+static uint32_t recordSize(uint32_t count) {
+  return sizeof(ParamHeader) + 4 * count + 4;
+}
+
+void param_defaults(Params *p) {
+  for (int u = 0; u < TURRETS; u++)
+    for (int i = 0; i < PARAM_COUNT; i++)
+      p->v[u][i] = param_desc[i].dflt;
+  p->seq = 0;
+  p->used = 0;
+}
+
+int param_check(int id, ParamValue v) {
+  if (id < 0 || id >= PARAM_COUNT)
+    return PARAM_UNKNOWN;
+  const ParamDesc *d = &param_desc[id];
+  if (d->type == PARAM_FLOAT)
+    // the comparisons are false for a nan
+    return v.f >= d->min.f && v.f <= d->max.f ? PARAM_OK : PARAM_RANGE;
+  return v.i >= d->min.i && v.i <= d->max.i ? PARAM_OK : PARAM_RANGE;
+}
+
+int param_load(Params *p) {
+  const uint8_t *flash = thal_flashdata();
+  uint32_t size = thal_flashsize(), off = 0;
+  const uint8_t *last = NULL;
+  uint32_t lastunits = 0, lastcount = 0;
+  while (off + recordSize(0) <= size) {
+    ParamHeader h;
+    memcpy(&h, flash + off, sizeof(h));
+    if (h.magic == PARAM_ERASED)
+      break;
+    uint32_t units = 1, count = h.count;
+    if (h.magic == PARAM_MAGIC)
+      units = h.count >> 16, count = h.count & 0xffff;
+    if ((h.magic != PARAM_MAGIC && h.magic != PARAM_MAGIC1) ||
+        units * count > size / 4 || off + recordSize(units * count) > size) {
+      // garbage, nothing behind it can be trusted: the next commit erases
+      off = size;
+      break;
+    }
+    uint32_t len = recordSize(units * count), crc;
+    memcpy(&crc, flash + off + len - 4, 4);
+    if (crc == crc32(flash + off, len - 4)) {
+      last = flash + off;
+      lastunits = units, lastcount = count;
+    }
+    off += len;
+  }
+  p->used = off;
+  if (!last)
+    return 0;
+  ParamHeader h;
+  memcpy(&h, last, sizeof(h));
+  p->seq = h.seq;
+  const uint8_t *values = last + sizeof(ParamHeader);
+  for (uint32_t u = 0; u < lastunits && u < TURRETS; u++)
+    for (uint32_t i = 0; i < lastcount && i < PARAM_COUNT; i++) {
+      ParamValue v;
+      memcpy(&v, values + 4 * (u * lastcount + i), 4);
+      if (param_check(i, v) == PARAM_OK)
+        p->v[u][i] = v;
+    }
+  return 1;
+}
+
+int param_commit(Params *p, int *erased) {
+  uint32_t words[recordSize(TURRETS * PARAM_COUNT) / 4];
+  uint32_t size = thal_flashsize(), len = sizeof(words);
+  *erased = 0;
+  if (size < len)
+    return 0;
+  ParamHeader h = {PARAM_MAGIC, p->seq + 1, TURRETS << 16 | PARAM_COUNT};
+  memcpy(words, &h, sizeof(h));
+  memcpy(words + sizeof(h) / 4, p->v, sizeof(p->v));
+  words[len / 4 - 1] = crc32((const uint8_t *)words, len - 4);
+  if (p->used + len > size) {
+    if (!thal_flasherase())
+      return 0;
+    p->used = 0;
+    *erased = 1;
+  }
+  // a failed write leaves a torn record that param_load() skips
+  uint32_t off = p->used;
+  p->used += len;
+  if (!thal_flashwrite(off, words, len / 4) ||
+      memcmp(thal_flashdata() + off, words, len))
+    return 0;
+  p->seq = h.seq;
+  return 1;
+}
+
+void param_frame(ParamFrame *f, const Params *p, int unit, int id,
+                 int status) {
+  f->id = id;
+  f->count = PARAM_COUNT;
+  f->status = status;
+  if (id >= 0 && id < PARAM_COUNT) {
+    const ParamDesc *d = &param_desc[id];
+    f->ptype = d->type;
+    memcpy(f->name, d->name, PARAM_NAMELEN);
+    f->value = p->v[unit][id];
+    f->min = d->min, f->max = d->max, f->dflt = d->dflt;
+  } else {
+    memset(f->name, 0, PARAM_NAMELEN);
+    f->ptype = PARAM_INT;
+    f->value.i = f->min.i = f->max.i = f->dflt.i = 0;
+  }
+  proto_seal((uint8_t *)f, TELEMPARAM, sizeof(ParamFrame) - 5);
+}
@@ -0,0 +1,67 @@
+/**
+ ******************************************************************************
+ * @file    turret_pid.c
+ * @brief   Fixed-point discrete PID for one servo axis.
+ ******************************************************************************
+ */
+#include "turret_pid.h"
+
+// Q15 * Q16 -> Q16, rounded
+static int32_t mulq15(int32_t k, int32_t x) {
+  return (int32_t)(((int64_t)k * x + (1 << 14)) >> 15);
+}
+
+static int32_t clamp(int32_t x, int32_t lo, int32_t hi) {
+  return x < lo ? lo : x > hi ? hi : x;
+}
+
+void pid_init(Pid *p, int32_t kp, int32_t ki, int32_t kd, int32_t outmin,
+              int32_t outmax, int32_t ratemax) {
+  p->kp = kp, p->ki = ki, p->kd = kd;
+  // bleed half of the clamped excess out of the integrator per update
+  p->kb = PID_Q15(.5f);
+  p->dalpha = PID_Q15(.3f);
+  p->outmin = outmin, p->outmax = outmax;
+  p->ratemax = ratemax;
+  pid_reset(p, 0);
+}
+
+void pid_reset(Pid *p, int32_t out) {
+  p->out = p->integ = clamp(out, p->outmin, p->outmax);
+  p->dterm = 0;
+  p->preverr = 0;
+  p->primed = 0;
+  p->saturated = 0;
+}
+
+void pid_tune(Pid *p, int32_t kp, int32_t ki, int32_t kd, int32_t outmin,
+              int32_t outmax, int32_t ratemax) {
+  p->kp = kp, p->ki = ki, p->kd = kd;
+  p->outmin = outmin, p->outmax = outmax;
+  p->ratemax = ratemax;
+  p->integ = clamp(p->integ, outmin, outmax);
+  p->out = clamp(p->out, outmin, outmax);
+}
+
+int32_t pid_update(Pid *p, int32_t err) {
+  // the first sample after a reset has no previous error to difference
+  if (!p->primed)
+    p->preverr = err, p->primed = 1;
+  // errors are whole units, scaling by 2^16 makes the products Q16
+  int32_t e = err * 65536, de = (err - p->preverr) * 65536;
+  p->preverr = err;
+  p->dterm += mulq15(p->dalpha, mulq15(p->kd, de) - p->dterm);
+
+  // this frame's error is in the output at once, the integral is most of
+  // the gain and a frame late it would act a whole host frame behind
+  int32_t integ = p->integ + mulq15(p->ki, e);
+  int32_t u = mulq15(p->kp, e) + integ + p->dterm;
+  int32_t out = clamp(u, p->outmin, p->outmax);
+  if (p->ratemax)
+    out = clamp(out, p->out - p->ratemax, p->out + p->ratemax);
+  p->saturated = out != u;
+
+  p->integ = clamp(integ + mulq15(p->kb, out - u), p->outmin, p->outmax);
+  p->out = out;
+  return out;
+}
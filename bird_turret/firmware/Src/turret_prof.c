@@ -0,0 +1,43 @@
+/**
+ ******************************************************************************
+ * @file    turret_prof.c
+ * @brief   Cycle counter probes: min/max/mean and a log2 histogram per probe.
+ ******************************************************************************
+ */
+#include "turret_prof.h"
+#include "turret_proto.h"
+#include "turret_sched.h"
+#include <string.h>
+
+static ProfProbe probes[PROF_NPROBES];
+
+static const char names[PROF_NPROBES][PROF_NAMELEN] = {
+    "uartirq", "uartrx", "timcb", "tick", "move", "cmdlat", "cmdpwm", "awake"};
+
+void prof_record(int probe, uint32_t cycles) {
+  ProfProbe *p = &probes[probe];
+  if (p->count == 0 || cycles < p->min)
+    p->min = cycles;
+  if (cycles > p->max)
+    p->max = cycles;
+  p->count++;
+  p->sum += cycles;
+  // clz is one instruction on the M4
+  p->hist[cycles ? 31 - __builtin_clz(cycles) : 0]++;
+}
+
+void prof_reset(void) { memset(probes, 0, sizeof(probes)); }
+
+void prof_frame(ProfFrame *f, int probe) {
+  const ProfProbe *p = &probes[probe];
+  f->probe = probe;
+  f->nprobes = PROF_NPROBES;
+  f->sched = TURRET_RTOS;
+  memcpy(f->name, names[probe], PROF_NAMELEN);
+  f->count = p->count;
+  f->min = p->min;
+  f->max = p->max;
+  f->mean = p->count ? (uint32_t)(p->sum / p->count) : 0;
+  memcpy(f->hist, p->hist, sizeof(f->hist));
+  proto_seal((uint8_t *)f, TELEMPROF, sizeof(ProfFrame) - 5);
+}
@@ -0,0 +1,188 @@
+/**
+ ******************************************************************************
+ * @file    turret_proto.c
+ * @brief   Host link: command frame parser and telemetry frame encoder.
+ ******************************************************************************
+ */
+#include "turret_proto.h"
+#include <string.h>
+
+void proto_init(Proto *p) { memset(p, 0, sizeof(*p)); }
+
+static int32_t getle32(const uint8_t *b) {
+  return (int32_t)((uint32_t)b[0] | (uint32_t)b[1] << 8 |
+                   (uint32_t)b[2] << 16 | (uint32_t)b[3] << 24);
+}
+
+static uint16_t getle16(const uint8_t *b) {
+  return (uint16_t)(b[0] | b[1] << 8);
+}
+
+static int knownType(uint8_t type) {
+  return type == CMDAIM || type == CMDTRIGTABLE || type == CMDBURST ||
+         type == CMDCENTER || type == CMDSPIN || type == CMDMOTORCFG ||
+         type == CMDPROF || type == CMDRTOSSTATS || type == CMDPARAMGET ||
+         type == CMDPARAMSET || type == CMDPARAMCOMMIT || type == CMDSERVOLUT ||
+         type == CMDTRACK || type == CMDUNIT;
+}
+
+static int lenOk(uint8_t type, uint8_t len) {
+  switch (type) {
+  case CMDAIM:
+    return len == CMDAIMLEN;
+  case CMDBURST:
+    return len == CMDBURSTLEN;
+  case CMDCENTER:
+  case CMDRTOSSTATS:
+  case CMDPARAMCOMMIT:
+    return len == 0;
+  case CMDSPIN:
+    return len == CMDSPINLEN;
+  case CMDMOTORCFG:
+    return len == CMDMOTORCFGLEN;
+  case CMDPROF:
+    return len == CMDPROFLEN;
+  case CMDPARAMGET:
+    return len == CMDPARAMGETLEN;
+  case CMDPARAMSET:
+    return len == CMDPARAMSETLEN;
+  case CMDTRACK:
+    return len == CMDTRACKLEN;
+  case CMDUNIT:
+    return len == CMDUNITLEN;
+  case CMDSERVOLUT:
+    return len >= CMDSERVOLUTLEN(0) && len <= CMDSERVOLUTLEN(SERVOLUTMAX) &&
+           (len - CMDSERVOLUTLEN(0)) % 2 == 0;
+  }
+  return len > 0 && len % 4 == 0 && len <= TRIGMAXSTEPS * 4;
+}
+
+static int decode(Proto *p) {
+  const uint8_t *b = p->frame + 4;
+  switch (p->frame[2]) {
+  case CMDAIM:
+    p->aimid = b[0];
+    p->aimphi = getle32(b + 1);
+    p->aimtht = getle32(b + 5);
+    return PROTO_AIM;
+  case CMDBURST:
+    p->burstshots = b[0];
+    p->bursthold = b[1];
+    p->burstinterval = getle16(b + 2);
+    p->burstcooldown = getle16(b + 4);
+    p->burstloss = getle16(b + 6);
+    return PROTO_BURST;
+  case CMDCENTER:
+    return PROTO_CENTER;
+  case CMDSPIN:
+    p->spin = b[0];
+    return PROTO_SPIN;
+  case CMDMOTORCFG:
+    p->motorduty = getle16(b);
+    p->motorramp = getle16(b + 2);
+    p->motoridle = getle16(b + 4);
+    return PROTO_MOTORCFG;
+  case CMDPROF:
+    p->prof = b[0];
+    return PROTO_PROF;
+  case CMDRTOSSTATS:
+    return PROTO_RTOSSTATS;
+  case CMDPARAMGET:
+    p->paramid = b[0];
+    return PROTO_PARAMGET;
+  case CMDPARAMSET:
+    p->paramid = b[0];
+    p->paramraw = (uint32_t)getle32(b + 1);
+    return PROTO_PARAMSET;
+  case CMDPARAMCOMMIT:
+    return PROTO_PARAMCOMMIT;
+  case CMDSERVOLUT:
+    p->lutaxis = b[0];
+    p->lutstart = getle32(b + 1);
+    p->lutstep = getle32(b + 5);
+    p->lutn = (p->frame[3] - CMDSERVOLUTLEN(0)) / 2;
+    for (int i = 0; i < p->lutn; i++)
+      p->lutccr[i] = getle16(b + 9 + 2 * i);
+    return PROTO_SERVOLUT;
+  case CMDTRACK:
+    p->trackstamp = (uint32_t)getle32(b);
+    p->trackx = (int8_t)b[4];
+    p->tracky = (int8_t)b[5];
+    // a move as far as the host's lag accounting goes
+    p->rxmoves++;
+    return PROTO_TRACK;
+  case CMDUNIT:
+    p->unit = b[0];
+    return PROTO_UNIT;
+  }
+  p->trignsteps = p->frame[3] / 4;
+  for (int i = 0; i < p->trignsteps; i++) {
+    p->trigtable[i].ccr = getle16(b + 4 * i);
+    p->trigtable[i].ms = getle16(b + 4 * i + 2);
+  }
+  return PROTO_TRIGTABLE;
+}
+
+static int feedFrame(Proto *p, uint8_t byte) {
+  int pos = p->framepos;
+  if (pos == 0 || (pos == 1 && byte != TELEMSYNC1) ||
+      (pos == 2 && !knownType(byte)) ||
+      (pos == 3 && !lenOk(p->frame[2], byte))) {
+    // not a frame (any more), the byte may start the next one
+    p->framepos = byte == TELEMSYNC0;
+    p->frame[0] = byte;
+    return PROTO_NONE;
+  }
+  p->frame[pos] = byte;
+  p->framepos++;
+  if (pos < 4 + p->frame[3])
+    return PROTO_NONE;
+  p->framepos = 0;
+  if (proto_crc8(p->frame + 2, p->frame[3] + 2) != byte) {
+    p->rxerrors++;
+    return PROTO_NONE;
+  }
+  return decode(p);
+}
+
+int proto_feed(Proto *p, uint8_t byte) {
+  int r = feedFrame(p, byte);
+  if (r != PROTO_NONE || p->framepos > 3) {
+    // length and payload bytes never reach the legacy window
+    memset(p->oper, -1, sizeof(p->oper));
+    return r;
+  }
+  p->oper[0] = p->oper[1];
+  p->oper[1] = p->oper[2];
+  p->oper[2] = p->oper[3];
+  p->oper[3] = (int8_t)byte;
+  if (p->oper[3] != ENDOFDATA)
+    return PROTO_NONE;
+  if (p->oper[0] == MOVEOP) {
+    p->rxmoves++;
+    return PROTO_MOVE;
+  }
+  if (p->oper[0] == TRIGOP) {
+    p->rxtrigs++;
+    return PROTO_TRIG;
+  }
+  return PROTO_NONE;
+}
+
+uint8_t proto_crc8(const uint8_t *data, int len) {
+  uint8_t crc = 0;
+  while (len--) {
+    crc ^= *data++;
+    for (int i = 0; i < 8; i++)
+      crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+  }
+  return crc;
+}
+
+void proto_seal(uint8_t *frame, uint8_t type, int payloadlen) {
+  frame[0] = TELEMSYNC0;
+  frame[1] = TELEMSYNC1;
+  frame[2] = type;
+  frame[3] = (uint8_t)payloadlen;
+  frame[4 + payloadlen] = proto_crc8(frame + 2, payloadlen + 2);
+}
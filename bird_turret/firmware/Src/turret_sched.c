@@ -0,0 +1,147 @@
+/**
+ ******************************************************************************
+ * @file    turret_sched.c
+ * @brief   Execution model: who calls the turret.h entry points, and when.
+ ******************************************************************************
+ */
+#include "turret_sched.h"
+#include "turret.h"
+#include "turret_config.h"
+#include "turret_hal.h"
+#include "turret_prof.h"
+
+#if TURRET_RTOS
+#include "FreeRTOS.h"
+#include "stream_buffer.h"
+#include "task.h"
+
+#define SCHED_RXBYTES 64 // 5.5ms at 115200
+#define SCHED_STACK 256  // words
+
+typedef struct {
+  uint32_t stamp; // thal_cycles() in the rx isr
+  uint8_t byte;
+} RxByte;
+
+// each byte keeps its rx stamp, so a backlog in the buffer shows up in
+// PROF_CMDLAT instead of hiding behind a later stamp. The isr is the only
+// writer and puts whole records, the uart task takes whole records
+static StreamBufferHandle_t rxstream;
+static TaskHandle_t ctrltask, polltask;
+static uint32_t awake; // thal_cycles() at the last wake-up
+
+static void ctrlLoop(void *arg) {
+  (void)arg;
+  for (;;) {
+    // a tick missed while a higher task ran is dropped, like a TIM7
+    // interrupt left pending twice
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    turret_tick();
+    // telemetry and track loss run on the tick while it runs
+    xTaskNotifyGive(polltask);
+  }
+}
+
+static void pollLoop(void *arg) {
+  (void)arg;
+  for (;;) {
+    // the tick stopped: telemetry, search delay and track loss come due on
+    // the timeout, the idle task sleeps until then
+    ulTaskNotifyTake(pdTRUE, turret.ticking ? portMAX_DELAY
+                                            : pdMS_TO_TICKS(TELEMPERIOD));
+    turret_poll();
+  }
+}
+
+void sched_start(void) {
+  rxstream = xStreamBufferCreate(SCHED_RXBYTES * sizeof(RxByte),
+                                 sizeof(RxByte));
+  configASSERT(rxstream);
+  // the uart task (.ioc, osPriorityHigh) ranks above both, as UART5 does
+  // above TIM7 and the main loop in the superloop build
+  BaseType_t ctrl = xTaskCreate(ctrlLoop, "ctrlTask", SCHED_STACK, NULL,
+                                tskIDLE_PRIORITY + 4, &ctrltask);
+  BaseType_t poll = xTaskCreate(pollLoop, "pollTask", SCHED_STACK, NULL,
+                                tskIDLE_PRIORITY + 3, &polltask);
+  configASSERT(ctrl == pdPASS && poll == pdPASS);
+}
+
+void sched_rxbyte(uint8_t byte) {
+  RxByte rx = {thal_cycles(), byte};
+  BaseType_t woken = pdFALSE;
+  // a full buffer loses the byte like an overrun. Never half a record:
+  // the send would store what fits
+  if (xStreamBufferSpacesAvailable(rxstream) < sizeof(rx)) {
+    turret_rxerror();
+    return;
+  }
+  xStreamBufferSendFromISR(rxstream, &rx, sizeof(rx), &woken);
+  portYIELD_FROM_ISR(woken);
+}
+
+void sched_tick(void) {
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(ctrltask, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+
+void sched_wake(void) {
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(polltask, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+
+void sched_rxloop(void) {
+  RxByte rx[8];
+  for (;;) {
+    // what came in since the last wake-up, up to 8 bytes
+    size_t n = xStreamBufferReceive(rxstream, rx, sizeof(rx), portMAX_DELAY) /
+               sizeof(RxByte);
+    for (size_t i = 0; i < n; i++) {
+      // turret_rxbyte() shares trig with the trigger timer isrs, which can
+      // not preempt it in the superloop build either
+      taskENTER_CRITICAL();
+      turret.rxstamp = rx[i].stamp;
+      turret_rxbyte(rx[i].byte);
+      taskEXIT_CRITICAL();
+    }
+    // whole frames before the poll task looks at the flags
+    if (xStreamBufferIsEmpty(rxstream))
+      xTaskNotifyGive(polltask);
+  }
+}
+
+void sched_presleep(void) { PROF_SINCE(PROF_AWAKE, awake); }
+
+void sched_postsleep(void) { awake = thal_cycles(); }
+
+#else
+
+// set by every interrupt with work for turret_poll(), the loop sleeps only
+// when none came in since it cleared it
+static volatile int wake;
+
+void sched_start(void) {
+  uint32_t awake = thal_cycles();
+  for (;;) {
+    wake = 0;
+    turret_poll();
+    PROF_SINCE(PROF_AWAKE, awake);
+    awake = thal_sleep(&wake);
+  }
+}
+
+void sched_rxbyte(uint8_t byte) {
+  turret.rxstamp = thal_cycles();
+  turret_rxbyte(byte);
+  wake = 1;
+}
+
+void sched_tick(void) {
+  turret_tick();
+  wake = 1;
+}
+
+void sched_wake(void) { wake = 1; }
+
+#endif
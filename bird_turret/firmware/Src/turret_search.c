@@ -0,0 +1,73 @@
+/**
+ ******************************************************************************
+ * @file    turret_search.c
+ * @brief   Search spiral after the host has gone quiet on a target.
+ ******************************************************************************
+ */
+#include "turret_search.h"
+#include <math.h>
+#include <string.h>
+
+#define TWOPI 6.28318531f
+
+static float clampf(float v, float lo, float hi) {
+  return v < lo ? lo : v > hi ? hi : v;
+}
+
+void search_init(Search *s) { memset(s, 0, sizeof(*s)); }
+
+void search_tune(Search *s, int pitch, int rate, int sweeps) {
+  s->pitch = pitch;
+  s->rate = rate;
+  s->sweeps = sweeps;
+}
+
+void search_start(Search *s, float phi, float tht) {
+  s->cphi = phi, s->ctht = tht;
+  s->theta = 0;
+  s->sweep = 1;
+  s->stopped = s->done = 0;
+  // last, the tick picks the spiral up from here
+  s->active = 1;
+}
+
+int search_step(Search *s, float dt, const float lo[2], const float hi[2],
+                float *phi, float *tht) {
+  if (!s->active)
+    return 0;
+  // the first turn at one pitch out, constant speed along the path
+  float r = s->pitch * (1 + s->theta / TWOPI);
+  s->theta += s->rate * dt / r;
+  int sweep = 1 + (int)(s->theta / TWOPI);
+  if (sweep > s->sweeps) {
+    s->active = 0;
+    s->sweep = 0;
+    s->done = 1;
+    return 0;
+  }
+  s->sweep = sweep;
+  *phi = clampf(s->cphi + r * cosf(s->theta), lo[0], hi[0]);
+  *tht = clampf(s->ctht + r * sinf(s->theta), lo[1], hi[1]);
+  return 1;
+}
+
+void search_stop(Search *s) {
+  if (!s->active)
+    return;
+  s->active = 0;
+  s->sweep = 0;
+  s->stopped = 1;
+}
+
+void search_cancel(Search *s) {
+  s->active = 0;
+  s->sweep = 0;
+  s->stopped = s->done = 0;
+}
+
+int search_take(Search *s) {
+  if (!s->stopped)
+    return 0;
+  s->stopped = 0;
+  return 1;
+}
@@ -0,0 +1,125 @@
+/**
+ ******************************************************************************
+ * @file    turret_servo.c
+ * @brief   Servo output: Q16 positions in, TIM3 compare values out.
+ ******************************************************************************
+ */
+#include "turret_servo.h"
+#include "turret_config.h"
+#include "turret_hal.h"
+
+// udeg per TIM3 count, 30000 (0.03deg) with the defaults
+#define UDEGPERCOUNT ((int64_t)SERVOUDEGPERUS * 1000000 / TIM3HZ)
+
+static int32_t clamp(int32_t v, int32_t lo, int32_t hi) {
+  return v < lo ? lo : v > hi ? hi : v;
+}
+
+static int lutCcr(const ServoLut *l, int32_t pos) {
+  // pos is inside the table: segment and Q32 fraction in one multiply,
+  // the offset is below 2^30 and inv below 2^33
+  uint64_t t = (uint64_t)(uint32_t)(pos - l->start) * l->inv >> 16;
+  int i = (int)(t >> 32);
+  if (i >= l->n - 1)
+    return l->ccr[l->n - 1];
+  uint32_t frac = (uint32_t)t;
+  int32_t d = l->ccr[i + 1] - l->ccr[i];
+  return l->ccr[i] + (int)(((int64_t)d * frac + (1ll << 31)) >> 32);
+}
+
+static int32_t lutPos(const ServoLut *l, int ccr) {
+  // inverse, for the bounds: the position where the table crosses ccr
+  int up = l->ccr[l->n - 1] > l->ccr[0];
+  for (int i = 0; i < l->n - 1; i++) {
+    int a = l->ccr[i], b = l->ccr[i + 1];
+    if (up ? ccr <= b : ccr >= b) {
+      int64_t f = ((int64_t)(ccr - a) << 16) / (b - a);
+      f = f < 0 ? 0 : f;
+      return l->start + i * l->step + (int32_t)((f * l->step) >> 16);
+    }
+  }
+  return l->start + (l->n - 1) * l->step;
+}
+
+static void updateBounds(Servo *s) {
+  const ServoLut *l = s->lut;
+  if (!l) {
+    s->lo = (s->min - s->center) * 65536;
+    s->hi = (s->max - s->center) * 65536;
+    return;
+  }
+  int32_t a = lutPos(l, s->min), b = lutPos(l, s->max);
+  s->lo = a < b ? a : b;
+  s->hi = a < b ? b : a;
+}
+
+void servo_init(Servo *s, int axis, int center, int min, int max) {
+  s->axis = axis;
+  s->center = center;
+  s->min = min, s->max = max;
+  s->lut = 0;
+  updateBounds(s);
+  servo_write(s, 0);
+}
+
+void servo_setrange(Servo *s, int center, int min, int max) {
+  s->center = center;
+  s->min = min, s->max = max;
+  updateBounds(s);
+}
+
+int servo_setlut(Servo *s, int32_t start, int32_t step, const uint16_t *ccr,
+                 int n) {
+  if (n == 0) {
+    s->lut = 0;
+    updateBounds(s);
+    return 1;
+  }
+  if (n < 2 || n > SERVOLUTMAX || step <= 0)
+    return 0;
+  int up = ccr[1] > ccr[0];
+  for (int i = 1; i < n; i++)
+    if (up ? ccr[i] <= ccr[i - 1] : ccr[i] >= ccr[i - 1])
+      return 0;
+  int first = up ? ccr[0] : ccr[n - 1], last = up ? ccr[n - 1] : ccr[0];
+  if (last < s->min || first > s->max)
+    return 0;
+  ServoLut *l = &s->lutbuf[s->lut == &s->lutbuf[0]];
+  l->n = n;
+  l->start = servo_udeg_to_q16(start);
+  l->step = servo_udeg_to_q16(step);
+  if (l->step <= 0 || (int64_t)l->step * (n - 1) >= 1 << 30 ||
+      (int64_t)l->start + (int64_t)l->step * (n - 1) > INT32_MAX)
+    return 0;
+  l->inv = (1ull << 48) / (uint32_t)l->step;
+  for (int i = 0; i < n; i++)
+    l->ccr[i] = ccr[i];
+  s->lut = l;
+  updateBounds(s);
+  return 1;
+}
+
+void servo_write(Servo *s, int32_t pos) {
+  const ServoLut *l = s->lut;
+  pos = clamp(pos, s->lo, s->hi);
+  s->pos = pos;
+  if (l)
+    s->ccr = clamp(lutCcr(l, pos), s->min, s->max);
+  else
+    s->ccr = s->center + ((pos + 0x8000) >> 16);
+  thal_servo(s->axis, s->ccr);
+}
+
+void servo_write_udeg(Servo *s, int32_t udeg) {
+  servo_write(s, servo_udeg_to_q16(udeg));
+}
+
+int32_t servo_udeg(const Servo *s) { return servo_q16_to_udeg(s->pos); }
+
+int32_t servo_q16_to_udeg(int32_t pos) {
+  return (int32_t)(((int64_t)pos * UDEGPERCOUNT + (1 << 15)) >> 16);
+}
+
+int32_t servo_udeg_to_q16(int32_t udeg) {
+  return (int32_t)((int64_t)udeg * 65536 / UDEGPERCOUNT);
+}
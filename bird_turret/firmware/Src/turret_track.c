@@ -0,0 +1,155 @@
+/**
+ ******************************************************************************
+ * @file    turret_track.c
+ * @brief   Alpha-beta target filter, extrapolated on the control tick.
+ ******************************************************************************
+ */
+#include "turret_track.h"
+#include <string.h>
+
+// a gap this long starts over instead of dividing a jump by it
+#define TRACKMAXGAP 1000 // ms
+
+static float clampf(float v, float lo, float hi) {
+  return v < lo ? lo : v > hi ? hi : v;
+}
+
+static void publish(Track *t, const TrackEstimate *e) {
+  uint32_t seq = t->seq;
+  t->slot[(seq + 1) & 1] = *e;
+  // the slot must be complete before the tick can pick it (dmb on the M4)
+  __sync_synchronize();
+  t->seq = seq + 1;
+}
+
+static const TrackEstimate *current(const Track *t) {
+  return &t->slot[t->seq & 1];
+}
+
+static float ahead(const Track *t, const TrackEstimate *e, uint32_t now) {
+  // ms to extrapolate, frames from the future (clock skew) are taken as now
+  int32_t age = (int32_t)(now - e->stamp);
+  age = age < 0 ? 0 : age;
+  return (float)((uint32_t)age < t->coast ? (uint32_t)age : t->coast);
+}
+
+void track_init(Track *t) {
+  memset(t, 0, sizeof(*t));
+}
+
+void track_tune(Track *t, float alpha, float beta, int coastms, float kphi,
+                float ktht, int lagms) {
+  t->alpha = alpha, t->beta = beta;
+  t->coast = coastms;
+  t->kphi = kphi, t->ktht = ktht;
+  t->lag = lagms < 0 ? 0 : lagms;
+}
+
+void track_pose(Track *t, uint32_t now, float phi, float tht) {
+  uint32_t last = t->histlast;
+  int n = t->histn;
+  // fill the ms a late tick skipped with the pulse that was still on
+  if (n && (int32_t)(now - last) > 1) {
+    uint32_t gap = now - last - 1;
+    gap = gap < TRACKHIST ? gap : TRACKHIST;
+    for (uint32_t i = 1; i <= gap; i++) {
+      t->histphi[(last + i) % TRACKHIST] = t->histphi[last % TRACKHIST];
+      t->histtht[(last + i) % TRACKHIST] = t->histtht[last % TRACKHIST];
+    }
+    n += gap;
+  }
+  t->histphi[now % TRACKHIST] = phi;
+  t->histtht[now % TRACKHIST] = tht;
+  t->histlast = now;
+  if (!n || now != last)
+    n++;
+  t->histn = n < TRACKHIST ? n : TRACKHIST;
+}
+
+// where the payload pointed at ms, 0 before the first pulse. Runs below
+// the tick: the newest slot may change under it, the one asked for is at
+// least the servo lag old
+static int pose(const Track *t, uint32_t ms, float *phi, float *tht) {
+  uint32_t last = t->histlast;
+  int n = t->histn;
+  if (!n)
+    return 0;
+  int32_t age = (int32_t)(last - ms);
+  // frames from the future take the newest pulse, older than the history
+  // the oldest one left
+  age = age < 0 ? 0 : age > n - 2 ? (n > 2 ? n - 2 : 0) : age;
+  uint32_t i = (last - (uint32_t)age) % TRACKHIST;
+  *phi = t->histphi[i], *tht = t->histtht[i];
+  return 1;
+}
+
+void track_reset(Track *t) { t->gen++; }
+
+static void axisUpdate(const Track *t, float *x, float *v, float z,
+                       float dt) {
+  float r = z - (*x + *v * dt);
+  *x += *v * dt + t->alpha * r;
+  *v += t->beta * r / dt;
+}
+
+void track_update(Track *t, int phierr, int thterr, uint32_t stamp,
+                  const int32_t lo[2], const int32_t hi[2], int32_t *phi,
+                  int32_t *tht) {
+  // only this side writes the slots, the published one is stable here
+  TrackEstimate e = *current(t);
+  uint32_t gen = t->gen;
+  if (e.gen != gen || !e.active) {
+    // not tracking: the turret was sent to the ctrl targets
+    e.active = 0;
+    e.phi = *phi / 65536.f, e.tht = *tht / 65536.f;
+    e.phiv = e.thtv = 0;
+  }
+  // where the payload pointed at stamp, and where the bird was seen from it
+  float dt = (float)(int32_t)(stamp - e.stamp);
+  float pphi = *phi / 65536.f, ptht = *tht / 65536.f;
+  pose(t, stamp - t->lag, &pphi, &ptht);
+  float zphi = clampf(pphi + t->kphi * phierr, lo[0] / 65536.f,
+                      hi[0] / 65536.f);
+  float ztht = clampf(ptht + t->ktht * thterr, lo[1] / 65536.f,
+                      hi[1] / 65536.f);
+  if (e.active && dt <= 0) {
+    // not newer than the estimate (reordered or repeated): dropped
+    *phi = (int32_t)(e.phi * 65536.f);
+    *tht = (int32_t)(e.tht * 65536.f);
+    return;
+  }
+  if (!e.active || dt > TRACKMAXGAP) {
+    // first frame after a reset or a long gap: position only
+    e.phi = zphi, e.tht = ztht;
+    e.phiv = e.thtv = 0;
+  } else {
+    axisUpdate(t, &e.phi, &e.phiv, zphi, dt);
+    axisUpdate(t, &e.tht, &e.thtv, ztht, dt);
+    e.phi = clampf(e.phi, lo[0] / 65536.f, hi[0] / 65536.f);
+    e.tht = clampf(e.tht, lo[1] / 65536.f, hi[1] / 65536.f);
+  }
+  e.stamp = stamp;
+  e.active = 1;
+  // a reset from here on still drops this one
+  e.gen = gen;
+  publish(t, &e);
+  *phi = (int32_t)(e.phi * 65536.f);
+  *tht = (int32_t)(e.tht * 65536.f);
+}
+
+int track_target(Track *t, uint32_t now, float *phi, float *tht) {
+  // runs above track_update(), the slot can not change under it
+  const TrackEstimate *e = current(t);
+  if (!e->active || e->gen != t->gen)
+    return 0;
+  float at = ahead(t, e, now);
+  *phi = e->phi + e->phiv * at;
+  *tht = e->tht + e->thtv * at;
+  return 1;
+}
+
+int track_moving(const Track *t, uint32_t now) {
+  const TrackEstimate *e = current(t);
+  return e->active && e->gen == t->gen &&
+         (int32_t)(now - e->stamp) < (int32_t)t->coast;
+}
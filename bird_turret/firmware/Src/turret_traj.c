@@ -0,0 +1,154 @@
+/**
+ ******************************************************************************
+ * @file    turret_traj.c
+ * @brief   Jerk-limited (S-curve) trajectory towards a moving setpoint.
+ *
+ * Online bang-bang in jerk: every step tries +jmax, 0 and -jmax and keeps
+ * the first whose next state can still brake onto the target (closed form
+ * stopping distance) without exceeding vmax. This replans from the current
+ * state on every call, so the target may change at any time.
+ ******************************************************************************
+ */
+#include "turret_traj.h"
+#include <math.h>
+
+// closer than this, slower and with less acceleration counts as arrived.
+// Plus what a single step of jerk moves: below that the bang-bang would
+// chatter around the target instead of landing on it (a fraction of a
+// count, the servo can't resolve it anyway)
+#define TRAJEPS 0.05f
+#define TRAJVEPS 2.0f
+#define TRAJAEPS 200.0f
+
+typedef struct {
+  float pos, vel, acc;
+} State;
+
+static float clampf(float x, float lim) {
+  return x > lim ? lim : x < -lim ? -lim : x;
+}
+
+// constant jerk j for t seconds
+static void segment(State *s, float j, float t) {
+  s->pos += (s->vel + (s->acc * 0.5f + j * t * (1.0f / 6)) * t) * t;
+  s->vel += (s->acc + j * t * 0.5f) * t;
+  s->acc += j * t;
+}
+
+// distance to come to rest from s (vel >= 0 side): ramp the acceleration
+// down to -ap, hold it, ramp back to zero exactly as vel reaches zero
+static float stopdist(const Traj *t, State s) {
+  float j = t->jmax;
+  float vz = s.vel + s.acc * fabsf(s.acc) / (2 * j); // vel once acc is zero
+  if (vz <= 0)
+    return -INFINITY; // not heading for the target
+  float ap = sqrtf(j * (s.vel + s.acc * s.acc / (2 * j)));
+  float hold = 0;
+  if (ap > t->amax) {
+    ap = t->amax;
+    hold = (s.vel + s.acc * s.acc / (2 * j)) / ap - ap / j;
+  }
+  State e = {0, s.vel, s.acc};
+  if (s.acc + ap > 0)
+    segment(&e, -j, (s.acc + ap) / j);
+  segment(&e, 0, hold);
+  segment(&e, j, ap / j);
+  return e.pos;
+}
+
+void traj_init(Traj *t, float pos, float vmax, float amax, float jmax) {
+  t->vmax = vmax, t->amax = amax, t->jmax = jmax;
+  t->target = t->pos = t->out = pos;
+  t->vel = t->acc = 0;
+  t->shapek = 0;
+  t->delay = t->head = 0;
+  t->held = 1;
+}
+
+void traj_target(Traj *t, float target) { t->target = target; }
+
+void traj_shape(Traj *t, float hz, float zeta, float dt) {
+  t->delay = t->head = 0;
+  t->held = 1;
+  if (hz <= 0 || zeta < 0 || zeta >= 1)
+    return;
+  // ZV shaper: impulses 1 / (1 + k) and k / (1 + k) half a damped period
+  // apart
+  float r = sqrtf(1 - zeta * zeta);
+  int delay = (int)(0.5f / (hz * r * dt) + 0.5f);
+  t->delay = delay < 1 ? 1 : delay > TRAJSHAPEMAX ? TRAJSHAPEMAX : delay;
+  t->shapek = expf(-zeta * 3.14159265f / r);
+  for (int i = 0; i < t->delay; i++)
+    t->past[i] = t->pos;
+  t->held = t->delay + 1;
+}
+
+static float shape(Traj *t) {
+  if (!t->delay) {
+    t->out = t->pos;
+    return t->out;
+  }
+  float old = t->past[t->head];
+  t->past[t->head] = t->pos;
+  t->head = t->head + 1 < t->delay ? t->head + 1 : 0;
+  // exact once both ends rest on the same spot
+  t->out = old == t->pos ? old : (t->pos + t->shapek * old) / (1 + t->shapek);
+  return t->out;
+}
+
+static void plan(Traj *t, float dt);
+
+float traj_step(Traj *t, float dt) {
+  float d = t->target - t->pos;
+  float ja = t->jmax * dt, jv = ja * dt, jp = jv * dt;
+  if (fabsf(d) < TRAJEPS + 5 * jp && fabsf(t->vel) < TRAJVEPS + 2 * jv &&
+      fabsf(t->acc) < TRAJAEPS + ja) {
+    t->pos = t->target;
+    t->vel = t->acc = 0;
+    if (t->held <= t->delay)
+      t->held++;
+  } else {
+    t->held = 0;
+    plan(t, dt);
+  }
+  return shape(t);
+}
+
+static void plan(Traj *t, float dt) {
+  float d = t->target - t->pos;
+
+  // work in the direction of the target
+  float dir = d < 0 ? -1 : 1;
+  State now = {0, t->vel * dir, t->acc * dir}, next = now;
+  static const float jerks[] = {1, 0, -1};
+  for (int i = 0; i < 3; i++) {
+    float j = jerks[i] * t->jmax;
+    next = now;
+    segment(&next, j, dt);
+    if (fabsf(next.acc) > t->amax) {
+      // reaches amax within the step and holds it for the rest
+      float lim = next.acc > 0 ? t->amax : -t->amax;
+      float tj = (lim - now.acc) / j;
+      next = now;
+      if (tj > 0)
+        segment(&next, j, tj);
+      else
+        tj = 0;
+      next.acc = lim;
+      segment(&next, 0, dt - tj);
+    }
+    if (next.vel + next.acc * fabsf(next.acc) / (2 * t->jmax) > t->vmax)
+      continue;
+    if (i == 2 || next.pos + stopdist(t, next) <= fabsf(d))
+      break;
+  }
+
+  t->pos += next.pos * dir;
+  t->vel = clampf(next.vel, t->vmax) * dir;
+  t->acc = next.acc * dir;
+}
+
+int traj_done(const Traj *t) {
+  // the delayed share has caught up once pos rested for the whole delay
+  return t->pos == t->target && t->vel == 0 && t->held > t->delay;
+}
@@ -0,0 +1,114 @@
+/**
+ ******************************************************************************
+ * @file    turret_trig.c
+ * @brief   Table-driven trigger sequence (TIM4) and shot cooldown (TIM2).
+ ******************************************************************************
+ */
+#include "turret_trig.h"
+#include "turret_hal.h"
+#include <string.h>
+
+void trig_init(Trig *t, int out, const TrigStep *table, int nsteps,
+               int rest) {
+  t->out = out;
+  t->nsteps = 0;
+  t->rest = rest;
+  t->shots = 1;
+  t->interval = t->cooldown = 0;
+  t->progress = t->shot = t->active = 0;
+  t->shotflag = 0;
+  trig_settable(t, table, nsteps);
+  thal_trigger(t->out, rest);
+}
+
+int trig_settable(Trig *t, const TrigStep *table, int nsteps) {
+  if (t->shotflag || nsteps <= 0 || nsteps > TRIGMAXSTEPS)
+    return 0;
+  for (int i = 0; i < nsteps; i++)
+    if (table[i].ms == 0 || table[i].ms > TRIGMAXMS)
+      return 0;
+  memcpy(t->table, table, nsteps * sizeof(TrigStep));
+  t->nsteps = nsteps;
+  return 1;
+}
+
+int trig_setrest(Trig *t, int rest) {
+  if (t->shotflag)
+    return 0;
+  t->rest = rest;
+  thal_trigger(t->out, rest);
+  return 1;
+}
+
+int trig_setburst(Trig *t, int shots, int interval, int cooldown) {
+  if (t->shotflag || shots < 1 || interval < 0 || interval > TRIGMAXMS ||
+      cooldown < 0)
+    return 0;
+  t->shots = shots;
+  t->interval = interval;
+  t->cooldown = cooldown;
+  return 1;
+}
+
+static void play(Trig *t) {
+  const TrigStep *s = &t->table[t->progress++];
+  thal_trigger(t->out, s->ccr);
+  thal_trigtimer(t->out, s->ms);
+}
+
+int trig_request(Trig *t) {
+  if (t->shotflag || t->nsteps == 0)
+    return 0;
+  t->shotflag = 1;
+  t->active = 1;
+  thal_shotled(t->out, 1);
+  t->progress = t->shot = 0;
+  play(t);
+  return 1;
+}
+
+static void finish(Trig *t) {
+  thal_trigger(t->out, t->rest);
+  t->progress = 0;
+  t->active = 0;
+  thal_trigtimer(t->out, 0);
+  if (t->cooldown > 0)
+    thal_cooldowntimer(t->out, t->cooldown);
+  else
+    trig_cooldown(t);
+}
+
+int trig_step(Trig *t) {
+  // the timer can have expired just before finish() stopped it
+  if (!t->active)
+    return TRIG_IDLE;
+  if (t->progress < t->nsteps) {
+    play(t);
+    return TRIG_BUSY;
+  }
+  if (++t->shot >= t->shots) {
+    finish(t);
+    return TRIG_DONE;
+  }
+  // rest for the interval, the next expiry starts the table again
+  thal_trigger(t->out, t->rest);
+  t->progress = 0;
+  if (t->interval > 0)
+    thal_trigtimer(t->out, t->interval);
+  else
+    play(t);
+  return TRIG_SHOT;
+}
+
+int trig_abort(Trig *t) {
+  if (!t->active)
+    return 0;
+  finish(t);
+  return 1;
+}
+
+void trig_cooldown(Trig *t) {
+  t->shotflag = 0;
+  thal_shotled(t->out, 0);
+  thal_cooldowntimer(t->out, 0);
+}
@@ -0,0 +1,53 @@
+/**
+ ******************************************************************************
+ * @file    bench.h
+ * @brief   Minimal timing helpers for the host benchmarks.
+ ******************************************************************************
+ */
+#ifndef __BENCH_H
+#define __BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+static inline uint64_t bench_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline uint64_t bench_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return bench_ns();
+#endif
+}
+
+typedef struct {
+  const char *name;
+  uint64_t ns, cycles;
+} Bench;
+
+static inline void bench_begin(Bench *b, const char *name) {
+  b->name = name;
+  b->ns = bench_ns();
+  b->cycles = bench_cycles();
+}
+
+// prints "<name>: <ns>/op <cycles>/op" for n operations
+static inline void bench_end(Bench *b, uint64_t n) {
+  uint64_t cycles = bench_cycles() - b->cycles;
+  uint64_t ns = bench_ns() - b->ns;
+  printf("%-24s %10llu ops %8.2f ns/op %8.2f cycles/op\n", b->name,
+         (unsigned long long)n, (double)ns / n, (double)cycles / n);
+}
+
+// keep the optimizer from dropping results
+static volatile int bench_sink;
+
+#endif /* __BENCH_H */
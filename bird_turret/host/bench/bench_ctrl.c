@@ -0,0 +1,31 @@
+/**
+ ******************************************************************************
+ * @file    bench_ctrl.c
+ * @brief   Control law cost per error frame.
+ ******************************************************************************
+ */
+#include "bench.h"
+#include "turret_ctrl.h"
+#include <stdlib.h>
+
+#define NFRAMES (1 << 22)
+
+int main(void) {
+  static int8_t err[2 * 4096];
+  Ctrl c;
+  Bench b;
+
+  srand(2);
+  for (int i = 0; i < (int)sizeof(err); i++)
+    err[i] = rand() % 255 - 127;
+
+  ctrl_init(&c);
+  bench_begin(&b, "ctrl_move");
+  for (int i = 0; i < NFRAMES; i++) {
+    int k = 2 * (i % 4096);
+    ctrl_move(&c, -err[k], err[k + 1]);
+  }
+  bench_end(&b, NFRAMES);
+  bench_sink = c.phi.target + c.tht.target;
+  return 0;
+}
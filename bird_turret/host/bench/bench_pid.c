@@ -0,0 +1,106 @@
+/**
+ ******************************************************************************
+ * @file    bench_pid.c
+ * @brief   Closed-loop step response of the pan controller, and its cost.
+ *
+ * The loop runs at the camera rate: every FRAMEMS the host sees the error
+ * between the bird and the aim FRAMELAG frames ago, scaled to the int8
+ * units rasptostm.py sends, and the servo follows the target through the
+ * 1kHz shaped S-curve and the rounding of the compare register. The legacy law
+ * is the old `phipulse += kpx * err` on an int with 0.3deg counts, which
+ * never moves for errors below 1 / kpx. The error itself is only
+ * 1 / UNITSPERDEG deg fine, bench_servo shows the open-loop resolution.
+ ******************************************************************************
+ */
+#include "../sim/servo_model.h"
+#include "bench.h"
+#include "turret_config.h"
+#include "turret_ctrl.h"
+#include "turret_pid.h"
+#include "turret_traj.h"
+#include <math.h>
+
+#define FRAMEMS 33
+#define FRAMELAG 1
+#define NFRAMES 150
+#define UNITSPERDEG 4.23 // 640px/60deg camera, x / 320 * 127
+#define RISETOL 0.1      // deg
+#define NUPDATES (1 << 22)
+#define LEGACYKPX .06f // stm32v2 kpx before the pid
+#define LEGACYCOUNT 10 // TIM3 counts per old 300kHz count
+
+enum { LEGACY, PID, NLAWS };
+static const char *lawnames[] = {"legacy", "pid"};
+
+typedef struct {
+  int rise;         // frames until within RISETOL
+  double overshoot; // deg
+  double finalerr;  // deg, mean |error| over the last 30 frames
+} StepResult;
+
+static StepResult step(double deg, int law) {
+  StepResult r = {-1, 0, 0};
+  double aim[NFRAMES];
+  Ctrl c;
+  Traj t;
+  int legacy = 0; // old counts from center
+  ctrl_init(&c);
+  traj_init(&t, 0, PHIVMAX, PHIAMAX, PHIJMAX);
+  traj_shape(&t, SHAPEHZ, SHAPEZETA, 1e-3f);
+
+  for (int f = 0; f < NFRAMES; f++) {
+    // what the servo is told: the trajectory rounded at the register
+    int quantum = law == LEGACY ? LEGACYCOUNT : 1;
+    aim[f] = lround(t.out / quantum) * quantum * DEGPERCOUNT;
+    double seen = deg - aim[f >= FRAMELAG ? f - FRAMELAG : 0];
+    long err = lround(seen * UNITSPERDEG);
+    err = err > 127 ? 127 : err < -127 ? -127 : err;
+
+    float target;
+    if (law == LEGACY) {
+      legacy += LEGACYKPX * err; // float truncated into an int
+      target = legacy * LEGACYCOUNT;
+    } else {
+      ctrl_move(&c, (int)err, 0);
+      target = c.phi.target / 65536.f;
+    }
+    traj_target(&t, target);
+    for (int ms = 0; ms < FRAMEMS; ms++)
+      traj_step(&t, 1e-3f);
+
+    double e = lround(t.out / quantum) * quantum * DEGPERCOUNT - deg;
+    if (r.rise < 0 && fabs(e) <= RISETOL)
+      r.rise = f + 1;
+    if (e * (deg > 0 ? 1 : -1) > r.overshoot)
+      r.overshoot = fabs(e);
+    if (f >= NFRAMES - 30)
+      r.finalerr += fabs(e) / 30;
+  }
+  return r;
+}
+
+int main(void) {
+  static const double steps[] = {0.9, 3, 12, 45};
+  Bench b;
+
+  printf("%8s %8s %12s %12s %12s\n", "step", "law", "rise frames",
+         "overshoot", "final err");
+  for (int i = 0; i < (int)(sizeof(steps) / sizeof(steps[0])); i++) {
+    for (int law = 0; law < NLAWS; law++) {
+      StepResult r = step(steps[i], law);
+      printf("%6.2fdeg %8s %12d %9.3fdeg %9.3fdeg\n", steps[i],
+             lawnames[law], r.rise, r.overshoot, r.finalerr);
+    }
+  }
+
+  Pid p;
+  pid_init(&p, PID_Q15(KPX), PID_Q15(KIX), PID_Q15(KDX), -3000 * 65536,
+           3000 * 65536, PID_Q16(PIDRATE));
+  int32_t sum = 0;
+  bench_begin(&b, "pid_update");
+  for (int i = 0; i < NUPDATES; i++)
+    sum += pid_update(&p, (i * 37) % 255 - 127);
+  bench_end(&b, NUPDATES);
+  bench_sink = sum;
+  return 0;
+}
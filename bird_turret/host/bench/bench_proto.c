@@ -0,0 +1,60 @@
+/**
+ ******************************************************************************
+ * @file    bench_proto.c
+ * @brief   Command parser and telemetry encoder throughput.
+ ******************************************************************************
+ */
+#include "bench.h"
+#include "turret.h"
+#include "turret_proto.h"
+#include <stdlib.h>
+
+#define NBYTES (1 << 20)
+#define ROUNDS 16
+
+extern uint32_t thal_now;
+
+int main(void) {
+  static uint8_t stream[NBYTES];
+  Proto p;
+  Bench b;
+
+  // rasptostm.py traffic: [op, x, y, ENDOFDATA] with random errors
+  srand(1);
+  for (int i = 0; i < NBYTES; i += 4) {
+    stream[i] = rand() % 8 ? MOVEOP : TRIGOP;
+    stream[i + 1] = rand() % 255 - 127;
+    stream[i + 2] = rand() % 255 - 127;
+    stream[i + 3] = ENDOFDATA;
+  }
+
+  proto_init(&p);
+  int events = 0;
+  bench_begin(&b, "proto_feed");
+  for (int r = 0; r < ROUNDS; r++)
+    for (int i = 0; i < NBYTES; i++)
+      events += proto_feed(&p, stream[i]) != PROTO_NONE;
+  bench_end(&b, (uint64_t)ROUNDS * NBYTES);
+  bench_sink = events;
+
+  uint8_t frame[sizeof(Telemetry)] = {0};
+  bench_begin(&b, "proto_seal(telemetry)");
+  for (int i = 0; i < NBYTES; i++) {
+    frame[4] = (uint8_t)i;
+    proto_seal(frame, TELEMSTATUS, sizeof(Telemetry) - 5);
+  }
+  bench_end(&b, NBYTES);
+  bench_sink = frame[sizeof(Telemetry) - 1];
+
+  // full rx isr + main loop path, telemetry every 5th iteration
+  turret_init();
+  bench_begin(&b, "turret_rxbyte+poll");
+  for (int i = 0; i < NBYTES; i++) {
+    turret_rxbyte(stream[i]);
+    thal_now = i / 4;
+    turret_poll();
+  }
+  bench_end(&b, NBYTES);
+  bench_sink = turret.unit[0].ctrl.phi.target;
+  return 0;
+}
@@ -0,0 +1,110 @@
+/**
+ ******************************************************************************
+ * @file    bench_servo.c
+ * @brief   Open-loop aim resolution of the servo output, and its cost.
+ *
+ * Commands every angle in [0, SWEEPDEG) in SWEEPSTEP udeg steps through
+ * turret_servo, lets the servo + mount model of sim/servo_model.h settle
+ * and compares the payload angle with the command. "300kHz" rounds the
+ * same command to the old TIM3 count (prescaler 280) for comparison.
+ *
+ * The second sweep runs a unit whose pulse to angle curve is offset, off in
+ * gain and bowed, once with the linear map and once with a calibration
+ * table measured on it (servo_setlut()), then times both lookups.
+ ******************************************************************************
+ */
+#include "../sim/servo_model.h"
+#include "bench.h"
+#include "turret_config.h"
+#include "turret_hal.h"
+#include "turret_servo.h"
+#include <math.h>
+
+#define SWEEPDEG 3
+#define SWEEPSTEP 7000 // udeg
+#define SETTLEMS 1500
+#define NWRITES (1 << 22)
+#define LEGACYCOUNT 10 // TIM3 counts per old 300kHz count
+#define BENTDEG 60     // second sweep, -BENTDEG..BENTDEG
+#define BENTSTEP 500000
+#define LUTPOINTS 17
+#define LUTSTART -80000000 // udeg
+#define LUTSTEP 10000000
+
+extern int thal_ccr[2];
+
+// the shaft of the bent unit follows this many nominal counts
+static double bent(double counts) {
+  return 1.04 * counts + 45 * sin(counts * 3.14159265 / 3000) + 40;
+}
+
+static double settled(int ccr, int isbent) {
+  ServoModel m = {0};
+  m.ccr = isbent ? bent(ccr - PHICENTER) : ccr - PHICENTER;
+  for (int i = 0; i < SETTLEMS * 10; i++)
+    servo_model_step(&m, 1e-4);
+  return m.angle;
+}
+
+int main(void) {
+  Servo s;
+  Bench b;
+
+  servo_init(&s, THAL_PHI, PHICENTER, PHIMIN, PHIMAX);
+  for (int coarse = 1; coarse >= 0; coarse--) {
+    double sum = 0, worst = 0;
+    int n = 0;
+    for (int32_t udeg = 0; udeg < SWEEPDEG * 1000000; udeg += SWEEPSTEP) {
+      servo_write_udeg(&s, udeg);
+      int ccr = thal_ccr[THAL_PHI];
+      if (coarse)
+        ccr = PHICENTER + (int)lround((double)(ccr - PHICENTER) /
+                                      LEGACYCOUNT) * LEGACYCOUNT;
+      double err = fabs(settled(ccr, 0) - udeg * 1e-6);
+      sum += err;
+      worst = err > worst ? err : worst;
+      n++;
+    }
+    printf("%-8s %4d commands  mean %.4fdeg  max %.4fdeg\n",
+           coarse ? "300kHz" : "3MHz", n, sum / n, worst);
+  }
+
+  // calibrate: the pulse that settles the bent unit at each table angle
+  uint16_t lut[LUTPOINTS];
+  for (int i = 0; i < LUTPOINTS; i++) {
+    double deg = (LUTSTART + (double)i * LUTSTEP) * 1e-6, lo = -4000, hi = 4000;
+    for (int k = 0; k < 40; k++) {
+      double mid = (lo + hi) / 2;
+      if (bent(mid) * DEGPERCOUNT < deg)
+        lo = mid;
+      else
+        hi = mid;
+    }
+    lut[i] = (uint16_t)lround(PHICENTER + lo);
+  }
+  for (int withlut = 0; withlut <= 1; withlut++) {
+    servo_setlut(&s, LUTSTART, LUTSTEP, lut, withlut ? LUTPOINTS : 0);
+    double sum = 0, worst = 0;
+    int n = 0;
+    for (int32_t udeg = -BENTDEG * 1000000; udeg <= BENTDEG * 1000000;
+         udeg += BENTSTEP) {
+      servo_write_udeg(&s, udeg);
+      double err = fabs(settled(thal_ccr[THAL_PHI], 1) - udeg * 1e-6);
+      sum += err;
+      worst = err > worst ? err : worst;
+      n++;
+    }
+    printf("bent %-4s %4d commands  mean %.4fdeg  max %.4fdeg\n",
+           withlut ? "lut" : "lin", n, sum / n, worst);
+  }
+
+  for (int withlut = 0; withlut <= 1; withlut++) {
+    servo_setlut(&s, LUTSTART, LUTSTEP, lut, withlut ? LUTPOINTS : 0);
+    bench_begin(&b, withlut ? "servo_write_udeg lut" : "servo_write_udeg");
+    for (int i = 0; i < NWRITES; i++)
+      servo_write_udeg(&s, (i % 90000) * 1000 - 45000000);
+    bench_end(&b, NWRITES);
+    bench_sink = s.ccr;
+  }
+  return 0;
+}
@@ -0,0 +1,87 @@
+/**
+ ******************************************************************************
+ * @file    bench_traj.c
+ * @brief   Settling of the payload after a setpoint step, and tick cost.
+ *
+ * Replays a step of the phi setpoint through the servo + mount model of
+ * sim/servo_model.h twice: once with the pulse written straight to TIM3
+ * (the behaviour before the control tick) and once through turret_tick(),
+ * whose S-curve is zero-vibration shaped for the mount (SHAPEHZ). Settling
+ * is the last time the payload is outside +-SETTLETOL of the final angle.
+ ******************************************************************************
+ */
+#include "../sim/servo_model.h"
+#include "bench.h"
+#include "turret.h"
+#include "turret_config.h"
+#include "turret_hal.h"
+#include <math.h>
+
+#define SIMMS 3000
+#define SETTLETOL 0.5 // deg
+#define NTICKS (1 << 22)
+
+extern int thal_ccr[2];
+
+typedef struct {
+  double rise, settle, overshoot; // ms, ms, deg
+} StepResult;
+
+static StepResult step(int counts, int profiled) {
+  ServoModel s = {0};
+  StepResult r = {-1, 0, 0};
+  double final = counts * DEGPERCOUNT;
+
+  turret_init();
+  turret.unit[0].ctrl.phi.target = counts * 65536;
+  for (int ms = 0; ms < SIMMS; ms++) {
+    if (profiled)
+      turret_tick();
+    else
+      servo_write(&turret.unit[0].phiservo, turret.unit[0].ctrl.phi.target);
+    if (ms % (SERVOFRAME / 1000) == 0)
+      s.ccr = thal_ccr[THAL_PHI] - PHICENTER;
+    for (int k = 0; k < 10; k++)
+      servo_model_step(&s, 1e-4);
+
+    double err = s.angle - final;
+    if (r.rise < 0 && fabs(err) <= SETTLETOL)
+      r.rise = ms;
+    if (fabs(err) > SETTLETOL)
+      r.settle = ms + 1;
+    if (err * (counts > 0 ? 1 : -1) > r.overshoot)
+      r.overshoot = fabs(err);
+  }
+  return r;
+}
+
+int main(void) {
+  static const int steps[] = {100, 500, 1500, 3000};
+  Bench b;
+
+  printf("%8s %8s %10s %10s %12s\n", "step", "mode", "rise ms", "settle ms",
+         "overshoot");
+  for (int i = 0; i < (int)(sizeof(steps) / sizeof(steps[0])); i++) {
+    for (int profiled = 0; profiled < 2; profiled++) {
+      StepResult r = step(steps[i], profiled);
+      printf("%6.1fdeg %8s %10.0f %10.0f %9.2fdeg\n",
+             steps[i] * DEGPERCOUNT, profiled ? "scurve" : "direct", r.rise,
+             r.settle, r.overshoot);
+    }
+  }
+
+  // worst case for the isr: both axes moving
+  turret_init();
+  bench_begin(&b, "turret_tick");
+  for (int i = 0; i < NTICKS; i++) {
+    if (i % 2000 == 0) {
+      turret.unit[0].ctrl.phi.target = (i % 4000 ? PHIMIN : PHIMAX) - PHICENTER;
+      turret.unit[0].ctrl.tht.target = (i % 4000 ? THTMIN : THTMAX) - THTCENTER;
+      turret.unit[0].ctrl.phi.target *= 65536, turret.unit[0].ctrl.tht.target *= 65536;
+    }
+    turret_tick();
+  }
+  bench_end(&b, NTICKS);
+  bench_sink = thal_ccr[0] + thal_ccr[1];
+  return 0;
+}
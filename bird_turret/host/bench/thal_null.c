@@ -0,0 +1,60 @@
+/**
+ ******************************************************************************
+ * @file    thal_null.c
+ * @brief   turret_hal.h stub for the benchmarks: records outputs, no timing.
+ ******************************************************************************
+ */
+#include "turret_hal.h"
+
+int thal_ccr[2], thal_ccr1;
+uint32_t thal_now;
+
+void thal_servo(int out, int ccr) { thal_ccr[out] = ccr; }
+void thal_trigger(int out, int ccr) {
+  (void)out;
+  thal_ccr1 = ccr;
+}
+void thal_ccrhold(int hold) { (void)hold; }
+void thal_motor(int out, int permille) {
+  (void)out;
+  (void)permille;
+}
+void thal_shotled(int out, int on) {
+  (void)out;
+  (void)on;
+}
+void thal_trigtimer(int out, int ms) {
+  (void)out;
+  (void)ms;
+}
+void thal_cooldowntimer(int out, int ms) {
+  (void)out;
+  (void)ms;
+}
+void thal_ticktimer(int on) { (void)on; }
+uint32_t thal_millis(void) { return thal_now; }
+uint32_t thal_cycles(void) { return 0; }
+uint32_t thal_sleep(volatile const int *wake) {
+  (void)wake;
+  return 0;
+}
+int thal_txready(void) { return 1; }
+void thal_transmit(const uint8_t *data, int len) {
+  (void)data;
+  (void)len;
+}
+int thal_osframe(int i, const uint8_t **frame) {
+  (void)i;
+  (void)frame;
+  return 0;
+}
+// no parameter sector, the benches run on the defaults
+uint32_t thal_flashsize(void) { return 0; }
+const uint8_t *thal_flashdata(void) { return 0; }
+int thal_flasherase(void) { return 0; }
+int thal_flashwrite(uint32_t offset, const uint32_t *words, int nwords) {
+  (void)offset;
+  (void)words;
+  (void)nwords;
+  return 0;
+}
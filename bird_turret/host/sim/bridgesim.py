@@ -0,0 +1,361 @@
+#!/usr/bin/env python3
+"""Closed loop through the real bridge: detector stand-in -> rasptostm.py -> vmcu.
+
+turretsim runs the firmware with C stand-ins for detection_2.py and
+rasptostm.py, so its time-to-lock gate never exercises the bridge itself.
+This one starts vmcu on a pty and loads the unmodified rasptostm.py node
+against it, with rospy, pyserial, the message packages and bird_metrics
+replaced by in-process stubs. Everything on the link is the bridge's own:
+CMDTRACK framing and the camera stamps it converts to MCU ticks with the
+clock offsets it takes from the telemetry, the TelemetryParser, the
+CMDPARAMGET handshake of load_params() and the TrackAck bookkeeping.
+
+The detector is still a stand-in for detection_2.py (no camera, no model):
+at the detection rate it projects a scripted bird through the pinhole of
+camera_model.h from the payload pose in the latest /bird_turret/telemetry
+(the servo pulses, not the servo model: turretsim covers the plant), waits
+the inference latency and hands a BirdDetection with the capture stamp to
+the node's detection callback.
+
+Runs in real time against vmcu's clock. Exit status 1 when the bird is not
+locked within -x seconds of its appearance, no CMDTRACK came back as a
+TrackAck, or the link saw crc or rx errors.
+
+    ./bridgesim.py --vmcu build/vmcu -s hover -x 2
+"""
+import argparse
+import fcntl
+import math
+import os
+import select
+import struct
+import subprocess
+import sys
+import tempfile
+import termios
+import threading
+import time
+import tty
+import types
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+BRIDGE = os.path.join(HERE, '..', '..', 'bird_turret', 'src')
+
+# camera_model.h
+CAMW, CAMH, CAMHFOV = 640, 480, 60.0
+PROXIMITY = 50  # px, detection_2 sets shoot inside it
+LOCKHOLD = 0.2  # s inside the cone that counts as a lock
+
+SCENARIOS = {
+    # t, az, el [s, deg], linear in between
+    'hover': [(0.5, 20, -10), (1e9, 20, -10)],
+    'cross': [(0.5, -25, -8), (5.5, 25, -8), (1e9, 25, -8)],
+}
+
+
+class Time:
+    """rospy.Time/Duration on time.monotonic(), in float seconds."""
+
+    def __init__(self, secs=0.0):
+        self.secs = secs
+
+    @classmethod
+    def now(cls):
+        return cls(time.monotonic())
+
+    @classmethod
+    def from_sec(cls, secs):
+        return cls(secs)
+
+    def to_sec(self):
+        return self.secs
+
+    def is_zero(self):
+        return self.secs == 0
+
+    def __sub__(self, other):
+        return Time(self.secs - other.secs)
+
+
+class Msg:
+    """Attribute bag for every message type, with the header and hops fields."""
+
+    def __init__(self, *args, **kwargs):
+        self.header = types.SimpleNamespace(stamp=Time())
+        self.hops = types.SimpleNamespace(camera=Time(), publish=Time())
+        self.__dict__.update(kwargs)
+
+
+class Topics:
+    """rospy.Publisher/Subscriber: subscribers by topic, last message published."""
+
+    subs, pubs = {}, {}
+
+    class Subscriber:
+        def __init__(self, topic, _type, callback):
+            Topics.subs[topic] = callback
+
+    class Publisher:
+        def __init__(self, topic, _type, queue_size=None):
+            self.topic = topic
+            self.resolved_name = topic
+            self.count = 0
+            self.last = None
+            Topics.pubs[topic] = self
+
+        def publish(self, msg):
+            self.count += 1
+            self.last = msg
+
+
+class Serial:
+    """pyserial on the pty slave vmcu prints."""
+
+    def __init__(self, port, baudrate=115200, timeout=None):
+        self.fd = os.open(port, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self.fd)
+        self.timeout = timeout
+
+    @property
+    def in_waiting(self):
+        return struct.unpack('i', fcntl.ioctl(self.fd, termios.FIONREAD, b'\0' * 4))[0]
+
+    out_waiting = 0
+
+    def read(self, n):
+        if not select.select([self.fd], [], [], self.timeout)[0]:
+            return b''
+        return os.read(self.fd, n)
+
+    def write(self, data):
+        view = memoryview(data)
+        while view:
+            view = view[os.write(self.fd, view):]
+
+    def close(self):
+        os.close(self.fd)
+
+
+class Metric:
+    def __init__(self, *args, **kwargs):
+        pass
+
+    def inc(self, n=1):
+        pass
+
+    def set(self, value):
+        pass
+
+    def observe(self, value):
+        pass
+
+
+def stub_modules(params, shutdown, log):
+    """rasptostm.py's imports, before it is loaded."""
+    def module(name, **attrs):
+        m = types.ModuleType(name)
+        m.__dict__.update(attrs)
+        sys.modules[name] = m
+        return m
+
+    def logger(level):
+        return lambda msg, *a: log(level, msg)
+
+    def throttled(level):
+        return lambda _period, msg, *a: log(level, msg)
+
+    module('rospy', init_node=lambda *a, **k: None,
+           Subscriber=Topics.Subscriber, Publisher=Topics.Publisher,
+           get_param=lambda name, default=None: params.get(name, default),
+           has_param=lambda name: name in params,
+           resolve_name=lambda name: name, on_shutdown=lambda fn: None,
+           get_time=time.monotonic, Time=Time, is_shutdown=shutdown.is_set,
+           sleep=time.sleep, spin=shutdown.wait,
+           loginfo=logger('info'), logwarn=logger('warn'), logerr=logger('error'),
+           logwarn_throttle=throttled('warn'), logerr_throttle=throttled('error'))
+    module('dynamic_reconfigure')
+    module('dynamic_reconfigure.server', Server=lambda *a, **k: types.SimpleNamespace(
+        update_configuration=lambda config: None))
+    module('serial', Serial=Serial)
+    metrics = types.SimpleNamespace(counter=Metric, gauge=Metric, histogram=Metric)
+    module('bird_metrics', serve=lambda name: metrics)
+    module('std_msgs')
+    module('std_msgs.msg', Empty=Msg, Int32=Msg)
+    module('bird_turret')
+    module('bird_turret.cfg', TurretConfig=Msg)
+    module('bird_turret.msg', TurretAimDone=Msg, TurretLimit=Msg, TurretTelemetry=Msg)
+    module('bird_alert_msgs')
+    module('bird_alert_msgs.msg', Aim=Msg, BirdDetection=Msg, TrackAck=Msg)
+
+
+def bird_at(script, t):
+    if t < script[0][0]:
+        return None
+    for (t0, az0, el0), (t1, az1, el1) in zip(script, script[1:]):
+        if t <= t1:
+            a = (t - t0) / (t1 - t0)
+            return az0 + a * (az1 - az0), el0 + a * (el1 - el0)
+    return None
+
+
+def direction(az, el):
+    az, el = math.radians(az), math.radians(el)
+    return (math.cos(el) * math.sin(az), math.sin(el), math.cos(el) * math.cos(az))
+
+
+def axes(phi, tht):
+    # camera_model_axes(): the payload pans by -phi, x right and y down
+    yaw, pitch = math.radians(-phi), math.radians(tht)
+    right = (math.cos(yaw), 0, -math.sin(yaw))
+    down = (-math.sin(pitch) * math.sin(yaw), math.cos(pitch), -math.sin(pitch) * math.cos(yaw))
+    fwd = (math.cos(pitch) * math.sin(yaw), math.sin(pitch), math.cos(pitch) * math.cos(yaw))
+    return right, down, fwd
+
+
+def dot(a, b):
+    return sum(x * y for x, y in zip(a, b))
+
+
+def project(f, phi, tht, az, el):
+    """Pixel of the bird, None behind the camera or off the image."""
+    d = direction(az, el)
+    right, down, fwd = axes(phi, tht)
+    z = dot(d, fwd)
+    if z <= 0:
+        return None
+    u = CAMW / 2 + f * dot(d, right) / z
+    v = CAMH / 2 + f * dot(d, down) / z
+    return (u, v) if 0 <= u < CAMW and 0 <= v < CAMH else None
+
+
+def error(phi, tht, az, el):
+    c = dot(direction(az, el), axes(phi, tht)[2])
+    return math.degrees(math.acos(max(-1.0, min(1.0, c))))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    ap.add_argument('--vmcu', required=True, help='vmcu executable')
+    ap.add_argument('-s', '--scenario', default='hover', choices=sorted(SCENARIOS))
+    ap.add_argument('-t', '--duration', type=float, default=5.0, help='s')
+    ap.add_argument('-f', '--fps', type=float, default=15.0, help='detection rate')
+    ap.add_argument('-L', '--latency', type=float, default=70.0, help='inference ms')
+    ap.add_argument('-c', '--cone', type=float, default=2.0, help='lock cone, deg')
+    ap.add_argument('-x', '--expect', type=float, default=None,
+                    help='fail unless locked within this many s')
+    ap.add_argument('-q', '--quiet', action='store_true', help='no bridge log')
+    args = ap.parse_args()
+
+    shutdown = threading.Event()
+
+    def log(level, msg):
+        if not args.quiet or level == 'error':
+            print(f'[{level}] {msg}', file=sys.stderr)
+
+    tmp = tempfile.mkdtemp(prefix='bridgesim')
+    link = os.path.join(tmp, 'ttyVMCU')
+    vmcu = subprocess.Popen([args.vmcu, '-l', link], stdout=subprocess.PIPE, text=True)
+    try:
+        vmcu.stdout.readline()
+        stub_modules({'~port': link}, shutdown, log)
+        # no __pycache__ in the source tree from a ctest run
+        sys.dont_write_bytecode = True
+        sys.path.insert(0, BRIDGE)
+        import rasptostm
+        node = rasptostm.UART_START()
+        return run(args, node, rasptostm)
+    finally:
+        shutdown.set()
+        vmcu.terminate()
+        vmcu.wait()
+        if os.path.lexists(link):
+            os.unlink(link)
+        os.rmdir(tmp)
+
+
+def run(args, node, rasptostm):
+    script = SCENARIOS[args.scenario]
+    f = CAMW / 2 / math.tan(math.radians(CAMHFOV / 2))
+    detect = Topics.subs['/bird_detection_2/detection']
+    telemetry = Topics.pubs['/bird_turret/telemetry']
+    acks = Topics.pubs['/bird_turret/track_ack']
+    # the parameter table goes out first
+    wait = time.monotonic() + 1
+    while telemetry.last is None and time.monotonic() < wait:
+        time.sleep(0.01)
+    if telemetry.last is None:
+        print('bridgesim: no telemetry from vmcu', file=sys.stderr)
+        return 1
+
+    start = time.monotonic()
+    appear = script[0][0]
+    lock = lockstart = None
+    frames = detections = 0
+    errs = []
+    next_frame = start
+    while time.monotonic() - start < args.duration:
+        # detection_2.py: grab a frame, infer, publish
+        time.sleep(max(0.0, next_frame - time.monotonic()))
+        capture = time.monotonic()
+        next_frame = capture + 1 / args.fps
+        pose = telemetry.last
+        phi, tht = pose.phi_udeg / 1e6, pose.tht_udeg / 1e6
+        bird = bird_at(script, capture - start)
+        msg = rasptostm.BirdDetection()
+        msg.header.stamp = Time(capture)
+        msg.hops.camera = msg.header.stamp
+        msg.error_x = msg.error_y = 0
+        msg.shoot = False
+        pixel = bird and project(f, phi, tht, *bird)
+        if pixel:
+            msg.error_x = int(pixel[0]) - CAMW // 2
+            msg.error_y = int(pixel[1]) - CAMH // 2
+            msg.shoot = abs(msg.error_x) < PROXIMITY and abs(msg.error_y) < PROXIMITY
+            detections += 1
+        frames += 1
+        # inference: the pose keeps coming in meanwhile, the lock is judged
+        # on every telemetry frame of it
+        done = capture + args.latency / 1000
+        while time.monotonic() < done:
+            time.sleep(0.005)
+            t = time.monotonic() - start
+            bird = bird_at(script, t)
+            if bird is None:
+                continue
+            pose = telemetry.last
+            err = error(pose.phi_udeg / 1e6, pose.tht_udeg / 1e6, *bird)
+            if err > args.cone:
+                lockstart = None
+            elif lockstart is None:
+                lockstart = t
+            if lock is None and lockstart is not None and t - lockstart >= LOCKHOLD:
+                lock = lockstart
+            if lock is not None:
+                errs.append(err)
+        msg.hops.publish = Time.now()
+        detect(msg)
+
+    last = telemetry.last
+    ttl = lock - appear if lock is not None else None
+    errs.sort()
+    p50 = errs[len(errs) // 2] if errs else float('nan')
+    print(f'bridgesim {args.scenario}: time to lock '
+          f'{f"{ttl:.2f}s" if ttl is not None else "never"}, error p50 {p50:.2f}deg, '
+          f'{frames} frames, {detections} detections, {acks.count} track acks, '
+          f'rx moves/dropped/errors {last.rx_moves}/{last.rx_dropped}/{last.rx_errors}, '
+          f'crc errors {node.parser.crc_errors}, telemetry {telemetry.count}')
+    ok = True
+    if args.expect is not None and (ttl is None or ttl > args.expect):
+        print(f'bridgesim: not locked within {args.expect}s', file=sys.stderr)
+        ok = False
+    if acks.count == 0:
+        print('bridgesim: no CMDTRACK acknowledged', file=sys.stderr)
+        ok = False
+    if last.rx_errors or node.parser.crc_errors:
+        print('bridgesim: errors on the link', file=sys.stderr)
+        ok = False
+    return 0 if ok else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
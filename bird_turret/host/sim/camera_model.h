@@ -0,0 +1,75 @@
+/**
+ ******************************************************************************
+ * @file    camera_model.h
+ * @brief   Pinhole model of the turret camera (usb_cam2) for the host sims.
+ *
+ * The camera rides on the turret payload. Directions are azimuth and
+ * elevation in degrees from the turret center, x right and y down like the
+ * image, so a positive elevation is below the center. The payload pans by
+ * -phi (a positive error x turns phi down, turret.c) and tilts by +tht.
+ ******************************************************************************
+ */
+#ifndef __CAMERA_MODEL_H
+#define __CAMERA_MODEL_H
+
+#include <math.h>
+
+// usb_cam2 as detection_2 sees it
+#define CAMW 640
+#define CAMH 480
+#define CAMFPS 30.0
+#define CAMHFOV 60.0 // deg, typical for the usb webcam
+
+#define CAMDEG (3.14159265358979 / 180)
+
+typedef struct {
+  double f; // px, square pixels
+} CameraModel;
+
+static inline void camera_model_init(CameraModel *c, double hfovdeg) {
+  c->f = CAMW / 2 / tan(hfovdeg / 2 * CAMDEG);
+}
+
+static inline void camera_model_dir(double az, double el, double d[3]) {
+  d[0] = cos(el * CAMDEG) * sin(az * CAMDEG);
+  d[1] = sin(el * CAMDEG);
+  d[2] = cos(el * CAMDEG) * cos(az * CAMDEG);
+}
+
+// camera axes for payload angles phi, tht: right, down, forward
+static inline void camera_model_axes(double phi, double tht, double r[3],
+                                     double dn[3], double fw[3]) {
+  double yaw = -phi * CAMDEG, pitch = tht * CAMDEG;
+  r[0] = cos(yaw), r[1] = 0, r[2] = -sin(yaw);
+  dn[0] = -sin(pitch) * sin(yaw), dn[1] = cos(pitch);
+  dn[2] = -sin(pitch) * cos(yaw);
+  fw[0] = cos(pitch) * sin(yaw), fw[1] = sin(pitch);
+  fw[2] = cos(pitch) * cos(yaw);
+}
+
+// pixel of direction az/el, 0 when it is behind the camera or off the image
+static inline int camera_model_project(const CameraModel *c, double phi,
+                                       double tht, double az, double el,
+                                       double *u, double *v) {
+  double d[3], r[3], dn[3], fw[3];
+  camera_model_dir(az, el, d);
+  camera_model_axes(phi, tht, r, dn, fw);
+  double z = d[0] * fw[0] + d[1] * fw[1] + d[2] * fw[2];
+  if (z <= 0)
+    return 0;
+  *u = CAMW / 2 + c->f * (d[0] * r[0] + d[1] * r[1] + d[2] * r[2]) / z;
+  *v = CAMH / 2 + c->f * (d[0] * dn[0] + d[1] * dn[1] + d[2] * dn[2]) / z;
+  return *u >= 0 && *u < CAMW && *v >= 0 && *v < CAMH;
+}
+
+// angle between the optical axis and direction az/el, deg
+static inline double camera_model_error(double phi, double tht, double az,
+                                        double el) {
+  double d[3], r[3], dn[3], fw[3];
+  camera_model_dir(az, el, d);
+  camera_model_axes(phi, tht, r, dn, fw);
+  double c = d[0] * fw[0] + d[1] * fw[1] + d[2] * fw[2];
+  return acos(c > 1 ? 1 : c < -1 ? -1 : c) / CAMDEG;
+}
+
+#endif /* __CAMERA_MODEL_H */
@@ -0,0 +1,44 @@
+/**
+ ******************************************************************************
+ * @file    servo_model.h
+ * @brief   Hobby servo + turret payload plant for the host simulations.
+ *
+ * The servo latches the TIM3 pulse once per 20ms frame and drives its shaft
+ * with a rate-limited first-order loop. The launcher sits on the horn
+ * through a compliant mount, modelled as an underdamped second-order
+ * system, so step commands make the payload ring.
+ ******************************************************************************
+ */
+#ifndef __SERVO_MODEL_H
+#define __SERVO_MODEL_H
+
+// 500..2500us over 180deg, TIM3 count = 1/3MHz
+#define DEGPERCOUNT 0.03
+#define SERVOFRAME 20000 // us, TIM3 84MHz / 28 / 60000
+#define SERVORATE 350.0  // deg/s
+#define SERVOTAU 0.03    // s
+#define MOUNTFREQ 6.0    // Hz, payload on the horn
+#define MOUNTZETA 0.25
+
+typedef struct {
+  double ccr;   // latched pulse, relative to the center pulse
+  double shaft; // deg
+  double angle; // payload deg
+  double omega; // payload deg/s
+} ServoModel;
+
+static inline void servo_model_step(ServoModel *s, double dt) {
+  double rate = (s->ccr * DEGPERCOUNT - s->shaft) / SERVOTAU;
+  if (rate > SERVORATE)
+    rate = SERVORATE;
+  if (rate < -SERVORATE)
+    rate = -SERVORATE;
+  s->shaft += rate * dt;
+
+  const double wn = 2 * 3.14159265358979 * MOUNTFREQ;
+  double alpha = wn * wn * (s->shaft - s->angle) - 2 * MOUNTZETA * wn * s->omega;
+  s->omega += alpha * dt;
+  s->angle += s->omega * dt;
+}
+
+#endif /* __SERVO_MODEL_H */
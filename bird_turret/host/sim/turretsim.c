@@ -0,0 +1,616 @@
+/**
+ ******************************************************************************
+ * @file    turretsim.c
+ * @brief   Closed-loop turret + camera simulation, time-to-lock benchmark.
+ *
+ * Runs the firmware sources in bird_turret/firmware against the servo plant
+ * of servo_model.h, the camera of camera_model.h and a scripted bird, in
+ * simulated time and as fast as the host allows. The detector and the
+ * bridge stand in for detection_2.py and rasptostm.py: the same box center
+ * error, proximity trigger and int8 scaling, and the same bytes on the link
+ * (CMDTRACK, or MOVEOP frames with -T, and TRIGOP), paced at the baud rate
+ * into sched_rxbyte() like vmcu. sim/bridgesim.py runs the real rasptostm.py
+ * against vmcu instead, for the bridge code itself.
+ *
+ * Reports per run and over all runs: time to lock (the payload within the
+ * cone around the bird for LOCKHOLD, from the bird's appearance), trigger
+ * pulls on and off target and the distribution of the tracking error once
+ * locked. The same seed gives the same numbers.
+ *
+ * Operating point: at 10-15fps and up to 70ms of latency every scenario
+ * locks on every run (ctest runs the defaults with -x 2). Below 10fps sine
+ * locks on about half the runs and cross takes 2-5s.
+ ******************************************************************************
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "turret.h"
+#include "turret_config.h"
+#include "turret_hal.h"
+#include "turret_sched.h"
+#include "camera_model.h"
+#include "servo_model.h"
+
+#define STEP 10 // us of simulated time per loop
+#define TIM7PERIOD (1000000 / TICKHZ)
+#define BRIDGEDELAY 1000 // us, detection topic to serial write
+#define PROXIMITY 50     // px, detection_2 sets z (shoot) inside it
+#define LOCKHOLD 0.2     // s inside the cone that counts as a lock
+#define MAXPOINTS 512
+
+typedef struct {
+  int running;
+  uint64_t next, period; // us
+} Timer;
+
+typedef struct {
+  double t, az, el; // s, deg
+} Waypoint;
+
+typedef struct {
+  double appear, detect, lock; // s, -1: never
+  int frames, detections, pulls, hits;
+} RunResult;
+
+// options
+static double duration = 10, latency = 70, detectfps = 15, noise = 2;
+static double missprob = 0.05, hfov = CAMHFOV, cone = 2;
+static long baud = 115200;
+static int track = 1, hold = 0, quiet = 0;
+static FILE *trace = NULL;
+
+// bird script
+static Waypoint script[MAXPOINTS];
+static int npoints;
+
+// peripheral and plant state, reset per run
+static uint64_t now;
+static int ccr1 = DFLTPULSE, ccr3 = THTCENTER, ccr4 = PHICENTER;
+static Timer tim2, tim4;
+static ServoModel phiservo, thtservo;
+static uint64_t servonext, simnext, ticknext, txbusyuntil;
+static int tickon;
+static uint8_t rxq[4096];
+static int rxhead, rxlen;
+static uint64_t rxnext;
+static CameraModel camera;
+
+// detector and bridge
+static uint64_t capturenext, lastproc, busyuntil, publishat;
+static int pending, pendx, pendy, pendz;
+static uint32_t pendstamp; // thal_millis() of the camera frame
+
+// results
+static RunResult run;
+static double lockstart;
+static double *errs;
+static size_t nerrs, caperrs;
+
+static uint64_t bytetime(void) { return baud > 0 ? 10000000 / baud : 0; }
+
+static void timerstart(Timer *t, uint64_t period) {
+  if (t->running)
+    return;
+  t->running = 1;
+  t->period = period;
+  t->next = now + period;
+}
+
+static int birdAt(double t, double *az, double *el) {
+  // linear between waypoints, absent outside the script
+  if (npoints == 0 || t < script[0].t || t > script[npoints - 1].t)
+    return 0;
+  int i = 0;
+  while (i + 1 < npoints && script[i + 1].t < t)
+    i++;
+  if (i + 1 == npoints) {
+    *az = script[i].az, *el = script[i].el;
+    return 1;
+  }
+  const Waypoint *a = &script[i], *b = &script[i + 1];
+  double k = b->t > a->t ? (t - a->t) / (b->t - a->t) : 1;
+  *az = a->az + k * (b->az - a->az);
+  *el = a->el + k * (b->el - a->el);
+  return 1;
+}
+
+static double simtime(void) { return now / 1e6; }
+
+static double randunit(void) { return rand() / ((double)RAND_MAX + 1); }
+
+static double randnormal(void) {
+  double u = randunit() + 1e-12, v = randunit();
+  return sqrt(-2 * log(u)) * cos(2 * 3.14159265358979 * v);
+}
+
+// turret_hal.h, one turret on the channels of the stm32 targets
+void thal_servo(int out, int ccr) {
+  if (out == THAL_PHI)
+    ccr4 = ccr;
+  else
+    ccr3 = ccr;
+}
+
+void thal_trigger(int out, int ccr) {
+  (void)out;
+  // a pull from rest launches
+  int rest = turret.unit[0].trig.rest;
+  if (ccr != rest && ccr1 == rest) {
+    double az, el;
+    run.pulls++;
+    if (birdAt(simtime(), &az, &el) &&
+        camera_model_error(phiservo.angle, thtservo.angle, az, el) <= cone)
+      run.hits++;
+  }
+  ccr1 = ccr;
+}
+
+void thal_ccrhold(int hold) { (void)hold; }
+void thal_motor(int out, int permille) {
+  (void)out;
+  (void)permille;
+}
+void thal_shotled(int out, int on) {
+  (void)out;
+  (void)on;
+}
+
+void thal_trigtimer(int out, int ms) {
+  (void)out;
+  tim4.running = 0;
+  if (ms > 0)
+    timerstart(&tim4, (uint64_t)ms * 1000);
+}
+
+void thal_cooldowntimer(int out, int ms) {
+  (void)out;
+  tim2.running = 0;
+  if (ms > 0)
+    timerstart(&tim2, (uint64_t)ms * 1000);
+}
+
+void thal_ticktimer(int on) {
+  // TIM7 with an update event: the first tick comes right away
+  tickon = on;
+  ticknext = now;
+}
+
+uint32_t thal_millis(void) { return (uint32_t)(now / 1000); }
+// simulated 168MHz cycles
+uint32_t thal_cycles(void) { return (uint32_t)(now * 168); }
+uint32_t thal_sleep(volatile const int *wake) {
+  (void)wake;
+  return thal_cycles();
+}
+
+int thal_txready(void) { return now >= txbusyuntil; }
+
+void thal_transmit(const uint8_t *data, int len) {
+  // nobody reads the telemetry, it only keeps the link busy
+  (void)data;
+  txbusyuntil = now + (uint64_t)len * bytetime();
+}
+
+int thal_osframe(int i, const uint8_t **frame) {
+  (void)i;
+  (void)frame;
+  return 0;
+}
+
+// no parameter sector, every run starts from the defaults
+uint32_t thal_flashsize(void) { return 0; }
+const uint8_t *thal_flashdata(void) { return 0; }
+int thal_flasherase(void) { return 0; }
+int thal_flashwrite(uint32_t offset, const uint32_t *words, int nwords) {
+  (void)offset;
+  (void)words;
+  (void)nwords;
+  return 0;
+}
+
+static void send(const uint8_t *data, int len) {
+  for (int i = 0; i < len && rxlen < (int)sizeof(rxq); i++) {
+    if (rxlen == 0 && rxnext < now)
+      rxnext = now + bytetime();
+    rxq[(rxhead + rxlen++) % sizeof(rxq)] = data[i];
+  }
+}
+
+static void bridge(void) {
+  // rasptostm.py callback(): 640x480 error to int8, nothing for (0, 0, 0).
+  // The error goes out on shoot frames too, ahead of the trigger
+  int x = (int)(pendx / 320.0 * 127), y = (int)(pendy / 240.0 * 127);
+  if ((x || y) && track) {
+    // the stamp is the capture time of the frame, as on the host
+    uint8_t f[5 + CMDTRACKLEN];
+    memcpy(&f[4], &pendstamp, 4);
+    f[8] = (uint8_t)x, f[9] = (uint8_t)y;
+    proto_seal(f, CMDTRACK, CMDTRACKLEN);
+    send(f, sizeof(f));
+  } else if (x || y) {
+    uint8_t cmd[4] = {MOVEOP, (uint8_t)x, (uint8_t)y, ENDOFDATA};
+    send(cmd, 4);
+  }
+  if (pendz == TRIGOP) {
+    uint8_t cmd[4] = {TRIGOP, (uint8_t)x, (uint8_t)y, ENDOFDATA};
+    send(cmd, 4);
+  }
+}
+
+static void capture(void) {
+  // detection_2.py: one frame per 1/detectfps, dropped while inferring
+  if (now < busyuntil || now - lastproc < (uint64_t)(1e6 / detectfps))
+    return;
+  lastproc = now;
+  busyuntil = now + (uint64_t)(latency * 1000);
+  run.frames++;
+  pendstamp = thal_millis();
+  double az, el, u, v;
+  pendx = pendy = pendz = 0;
+  if (birdAt(simtime(), &az, &el) &&
+      camera_model_project(&camera, phiservo.angle, thtservo.angle, az, el,
+                           &u, &v) &&
+      randunit() >= missprob) {
+    u += noise * randnormal(), v += noise * randnormal();
+    u = u < 0 ? 0 : u >= CAMW ? CAMW - 1 : u;
+    v = v < 0 ? 0 : v >= CAMH ? CAMH - 1 : v;
+    pendx = (int)u - CAMW / 2, pendy = (int)v - CAMH / 2;
+    pendz = abs(pendx) < PROXIMITY && abs(pendy) < PROXIMITY ? TRIGOP : MOVEOP;
+    run.detections++;
+    if (run.detect < 0)
+      run.detect = simtime();
+  }
+  publishat = busyuntil + BRIDGEDELAY;
+  pending = 1;
+}
+
+static void deliver(void) {
+  while (rxlen && now >= rxnext) {
+    sched_rxbyte(rxq[rxhead]);
+    rxhead = (rxhead + 1) % sizeof(rxq);
+    rxlen--;
+    rxnext += bytetime();
+    turret_poll();
+  }
+}
+
+static void timers(void) {
+  while (tickon && now >= ticknext) {
+    ticknext += TIM7PERIOD;
+    sched_tick();
+  }
+  if (tim4.running && now >= tim4.next) {
+    tim4.next += tim4.period;
+    turret_trigtick(THAL_TRIG);
+  }
+  if (tim2.running && now >= tim2.next) {
+    tim2.next += tim2.period;
+    turret_cooldown(THAL_TRIG);
+  }
+}
+
+static void record(double err) {
+  if (nerrs == caperrs) {
+    caperrs = caperrs ? caperrs * 2 : 4096;
+    errs = realloc(errs, caperrs * sizeof(double));
+    if (!errs) {
+      perror("turretsim");
+      exit(1);
+    }
+  }
+  errs[nerrs++] = err;
+}
+
+static void simulate(void) {
+  while (now >= servonext) {
+    phiservo.ccr = ccr4 - PHICENTER;
+    thtservo.ccr = ccr3 - THTCENTER;
+    servonext += SERVOFRAME;
+  }
+  while (now >= simnext) {
+    servo_model_step(&phiservo, 1e-3);
+    servo_model_step(&thtservo, 1e-3);
+    double t = simnext / 1e6, az, el, err = -1;
+    simnext += 1000;
+    if (!birdAt(t, &az, &el)) {
+      lockstart = -1;
+      continue;
+    }
+    if (run.appear < 0)
+      run.appear = t;
+    err = camera_model_error(phiservo.angle, thtservo.angle, az, el);
+    if (err > cone)
+      lockstart = -1;
+    else if (lockstart < 0)
+      lockstart = t;
+    if (run.lock < 0 && lockstart >= 0 && t - lockstart >= LOCKHOLD)
+      run.lock = lockstart;
+    if (run.lock >= 0)
+      record(err);
+    if (trace)
+      fprintf(trace, "%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n", t, az, el,
+              phiservo.angle, thtservo.angle, err);
+  }
+}
+
+static void simrun(unsigned seed) {
+  srand(seed);
+  memset(&run, 0, sizeof(run));
+  run.appear = run.detect = run.lock = lockstart = -1;
+  now = 0;
+  ccr1 = DFLTPULSE, ccr3 = THTCENTER, ccr4 = PHICENTER;
+  memset(&tim2, 0, sizeof(tim2));
+  memset(&tim4, 0, sizeof(tim4));
+  memset(&phiservo, 0, sizeof(phiservo));
+  memset(&thtservo, 0, sizeof(thtservo));
+  servonext = simnext = ticknext = txbusyuntil = rxnext = 0;
+  tickon = 1;
+  rxhead = rxlen = 0;
+  capturenext = lastproc = busyuntil = publishat = 0;
+  pending = 0;
+  turret_init();
+  if (hold) {
+    // rasptostm ~burst_hold: one shot, stay on the bird
+    uint8_t f[5 + CMDBURSTLEN] = {0};
+    uint16_t interval = 200, cooldown = 1000, loss = 1000;
+    f[4] = 1, f[5] = 1;
+    memcpy(&f[6], &interval, 2);
+    memcpy(&f[8], &cooldown, 2);
+    memcpy(&f[10], &loss, 2);
+    proto_seal(f, CMDBURST, CMDBURSTLEN);
+    send(f, sizeof(f));
+  }
+  uint64_t end = (uint64_t)(duration * 1e6);
+  for (; now < end; now += STEP) {
+    if (now >= capturenext) {
+      capture();
+      capturenext += (uint64_t)(1e6 / CAMFPS);
+    }
+    if (pending && now >= publishat) {
+      pending = 0;
+      bridge();
+    }
+    deliver();
+    timers();
+    turret_poll();
+    simulate();
+  }
+}
+
+static int cmpdouble(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return x < y ? -1 : x > y;
+}
+
+static double percentile(const double *sorted, size_t n, double p) {
+  if (!n)
+    return NAN;
+  size_t i = (size_t)(p / 100 * (n - 1) + .5);
+  return sorted[i < n ? i : n - 1];
+}
+
+static void addPoint(double t, double az, double el) {
+  if (npoints < MAXPOINTS)
+    script[npoints++] = (Waypoint){t, az, el};
+}
+
+static int scenario(const char *name) {
+  // built-in birds; anything else is a file of "t az el" lines
+  npoints = 0;
+  if (!strcmp(name, "hover")) {
+    addPoint(0.5, 20, -10);
+    addPoint(duration, 20, -10);
+  } else if (!strcmp(name, "cross")) {
+    // 10deg/s across the view
+    addPoint(0.5, -25, -8);
+    addPoint(5.5, 25, -8);
+    addPoint(duration, 25, -8);
+  } else if (!strcmp(name, "sine")) {
+    for (double t = 0.5; t <= duration; t += 0.02)
+      addPoint(t, 15 * sin(2 * 3.14159265358979 * 0.2 * (t - 0.5)),
+               -10 + 5 * sin(2 * 3.14159265358979 * 0.3 * (t - 0.5)));
+  } else if (!strcmp(name, "dart")) {
+    // lands somewhere else every 2s
+    static const double spots[][2] = {{10, -5}, {-15, -12}, {20, -20},
+                                      {-5, -3}, {0, -15}};
+    for (int i = 0; i < 5 && 0.5 + 2 * i < duration; i++) {
+      addPoint(0.5 + 2 * i, spots[i][0], spots[i][1]);
+      addPoint(0.5 + 2 * i + 1.999, spots[i][0], spots[i][1]);
+    }
+  } else {
+    FILE *f = fopen(name, "r");
+    char line[256];
+    if (!f)
+      return -1;
+    while (fgets(line, sizeof(line), f)) {
+      double t, az, el;
+      if (line[0] != '#' && sscanf(line, "%lf %lf %lf", &t, &az, &el) == 3)
+        addPoint(t, az, el);
+    }
+    fclose(f);
+  }
+  return npoints ? 0 : -1;
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "usage: %s [-s scenario] [-t secs] [-r runs] [-S seed] [-L ms]\n"
+          "          [-f fps] [-n px] [-m prob] [-F deg] [-k deg] [-b baud]\n"
+          "          [-T] [-H] [-o trace.csv] [-x secs] [-q]\n"
+          "  -s name   hover, cross, sine, dart or a file of \"t az el\" "
+          "lines\n"
+          "            (s, deg from center, el down) (cross)\n"
+          "  -t secs   simulated time per run (10)\n"
+          "  -r runs   runs with seeds seed, seed+1, ... (1)\n"
+          "  -S seed   first random seed (1)\n"
+          "  -L ms     camera frame to detection on the bridge (70)\n"
+          "  -f fps    detection rate, detection_2 throttles to 15 (15)\n"
+          "  -n px     box center noise, 1 sigma (2)\n"
+          "  -m prob   missed detection per frame (0.05)\n"
+          "  -F deg    horizontal field of view of usb_cam2 (60)\n"
+          "  -k deg    cone around the bird for lock and hits (2)\n"
+          "  -b baud   link rate (115200)\n"
+          "  -T        MOVEOP frames instead of CMDTRACK (~track false)\n"
+          "  -H        stay on the bird after a shot (~burst_hold)\n"
+          "  -o file   1kHz csv trace of bird, payload and error (first run)\n"
+          "  -x secs   exit 1 when the median time to lock is above secs\n"
+          "  -q        summary only\n",
+          prog);
+}
+
+int main(int argc, char **argv) {
+  const char *name = "cross", *tracepath = NULL;
+  unsigned seed = 1;
+  int runs = 1, opt;
+  double maxlock = -1;
+  while ((opt = getopt(argc, argv, "s:t:r:S:L:f:n:m:F:k:b:THo:x:qh")) != -1) {
+    switch (opt) {
+    case 's':
+      name = optarg;
+      break;
+    case 't':
+      duration = atof(optarg);
+      break;
+    case 'r':
+      runs = atoi(optarg);
+      break;
+    case 'S':
+      seed = (unsigned)atol(optarg);
+      break;
+    case 'L':
+      latency = atof(optarg);
+      break;
+    case 'f':
+      detectfps = atof(optarg);
+      break;
+    case 'n':
+      noise = atof(optarg);
+      break;
+    case 'm':
+      missprob = atof(optarg);
+      break;
+    case 'F':
+      hfov = atof(optarg);
+      break;
+    case 'k':
+      cone = atof(optarg);
+      break;
+    case 'b':
+      baud = atol(optarg);
+      break;
+    case 'T':
+      track = 0;
+      break;
+    case 'H':
+      hold = 1;
+      break;
+    case 'o':
+      tracepath = optarg;
+      break;
+    case 'x':
+      maxlock = atof(optarg);
+      break;
+    case 'q':
+      quiet = 1;
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+  if (runs < 1 || duration <= 0 || detectfps <= 0 || scenario(name)) {
+    usage(argv[0]);
+    return 1;
+  }
+  camera_model_init(&camera, hfov);
+
+  double *locks = calloc(runs, sizeof(double));
+  int nlocks = 0, frames = 0, detections = 0, pulls = 0, hits = 0;
+  for (int r = 0; r < runs; r++) {
+    if (r == 0 && tracepath) {
+      trace = fopen(tracepath, "w");
+      if (!trace) {
+        perror("turretsim: trace");
+        return 1;
+      }
+      fprintf(trace, "t_s,bird_az,bird_el,phi_deg,tht_deg,err_deg\n");
+    }
+    size_t first = nerrs;
+    simrun(seed + r);
+    if (trace) {
+      fclose(trace);
+      trace = NULL;
+    }
+    double locktime = run.lock >= 0 ? run.lock - run.appear : -1;
+    if (locktime >= 0)
+      locks[nlocks++] = locktime;
+    frames += run.frames, detections += run.detections;
+    pulls += run.pulls, hits += run.hits;
+    if (!quiet) {
+      qsort(errs + first, nerrs - first, sizeof(double), cmpdouble);
+      printf("run %u: detect %.2fs, %d pulls %d on target, ", seed + r,
+             run.detect, run.pulls, run.hits);
+      if (locktime >= 0)
+        printf("lock %.2fs, error p50 %.2f p95 %.2f deg\n", locktime,
+               percentile(errs + first, nerrs - first, 50),
+               percentile(errs + first, nerrs - first, 95));
+      else
+        printf("no lock\n");
+    }
+  }
+
+  qsort(locks, nlocks, sizeof(double), cmpdouble);
+  qsort(errs, nerrs, sizeof(double), cmpdouble);
+  printf("turretsim: %s, %d run%s of %.1fs, latency %.0fms at %.0ffps, "
+         "%s\n",
+         name, runs, runs > 1 ? "s" : "", duration, latency, detectfps,
+         track ? "CMDTRACK" : "MOVEOP");
+  if (nlocks)
+    printf("  time to lock   p50 %.2fs p90 %.2fs max %.2fs, %d/%d locked "
+           "(%.1fdeg for %.0fms)\n",
+           percentile(locks, nlocks, 50), percentile(locks, nlocks, 90),
+           locks[nlocks - 1], nlocks, runs, cone, LOCKHOLD * 1000);
+  else
+    printf("  time to lock   never (%.1fdeg for %.0fms)\n", cone,
+           LOCKHOLD * 1000);
+  printf("  shots          %d pulls, %d on target (%.0f%%)\n", pulls, hits,
+         pulls ? 100.0 * hits / pulls : 0);
+  printf("  detections     %d of %d frames\n", detections, frames);
+  if (!nerrs) {
+    free(locks);
+    return maxlock >= 0;
+  }
+  printf("  tracking error p50 %.2f p90 %.2f p95 %.2f p99 %.2f max %.2f deg "
+         "(%zu ms locked)\n",
+         percentile(errs, nerrs, 50), percentile(errs, nerrs, 90),
+         percentile(errs, nerrs, 95), percentile(errs, nerrs, 99),
+         percentile(errs, nerrs, 100), nerrs);
+  // share of the locked time per error band
+  static const double edges[] = {0.25, 0.5, 1, 2, 4, 8};
+  size_t i = 0;
+  double lo = 0;
+  printf("  error histogram");
+  for (int b = 0; b <= (int)(sizeof(edges) / sizeof(edges[0])); b++) {
+    size_t n = 0;
+    double hi = b < (int)(sizeof(edges) / sizeof(edges[0])) ? edges[b] : 1e9;
+    while (i < nerrs && errs[i] < hi)
+      i++, n++;
+    if (hi < 1e9)
+      printf(" %g-%g:%.1f%%", lo, hi, 100.0 * n / nerrs);
+    else
+      printf(" >%g:%.1f%%", lo, 100.0 * n / nerrs);
+    lo = hi;
+  }
+  printf("\n");
+
+  int fail = maxlock >= 0 && (nlocks * 2 <= runs ||
+                              percentile(locks, nlocks, 50) > maxlock);
+  free(locks);
+  free(errs);
+  return fail;
+}
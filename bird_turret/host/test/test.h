@@ -0,0 +1,42 @@
+/**
+ ******************************************************************************
+ * @file    test.h
+ * @brief   Minimal assertions for the host unit tests (ctest).
+ *
+ * A failed CHECK prints the expression and carries on, so one run lists
+ * every broken case; test_end() turns the count into the exit status.
+ ******************************************************************************
+ */
+#ifndef __TEST_H
+#define __TEST_H
+
+#include <stdio.h>
+
+static int test_failures;
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);          \
+      test_failures++;                                                         \
+    }                                                                          \
+  } while (0)
+
+// integers, both values printed on failure
+#define CHECK_EQ(a, b)                                                         \
+  do {                                                                         \
+    long long a_ = (long long)(a), b_ = (long long)(b);                        \
+    if (a_ != b_) {                                                            \
+      printf("%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__,       \
+             __LINE__, #a, #b, a_, b_);                                        \
+      test_failures++;                                                         \
+    }                                                                          \
+  } while (0)
+
+// exit status of main()
+static inline int test_end(const char *name) {
+  printf("%s: %s\n", name, test_failures ? "FAILED" : "ok");
+  return test_failures != 0;
+}
+
+#endif /* __TEST_H */
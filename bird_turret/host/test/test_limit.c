@@ -0,0 +1,111 @@
+/**
+ ******************************************************************************
+ * @file    test_limit.c
+ * @brief   limit_*() and turret.c on top of it: saturation, the
+ *          MAXBOUNDCNT count, the back-off and the latch.
+ ******************************************************************************
+ */
+#include "test.h"
+#include "turret.h"
+#include "turret_config.h"
+#include "turret_proto.h"
+
+#define LO (-1000 * 65536)
+#define HI (1000 * 65536)
+
+static void setup(Limit *l) {
+  limit_init(l, 33);
+  limit_setrange(&l->phi, LO, HI);
+  limit_setrange(&l->tht, LO, HI);
+}
+
+// on a bound and still pushing out: saturated, pulling back in: free
+static void update(void) {
+  Limit l;
+  setup(&l);
+  CtrlAxis c = {.target = HI};
+  CHECK_EQ(limit_update(&l.phi, &c, 5), 1);
+  CHECK_EQ(limit_sat(&l), LIMIT_PHIHI);
+  CHECK_EQ(limit_update(&l.phi, &c, -5), 0);
+  CHECK_EQ(limit_update(&l.phi, &c, 0), 0);
+  c.target = LO;
+  CHECK_EQ(limit_update(&l.tht, &c, -5), -1);
+  CHECK_EQ(limit_sat(&l), LIMIT_THTLO);
+  c.target = HI - 1;
+  CHECK_EQ(limit_update(&l.tht, &c, 5), 0);
+  CHECK_EQ(limit_sat(&l), 0);
+}
+
+// backs off by backoff, latches, drops errors out until one points back in
+static void retreat(void) {
+  Limit l;
+  setup(&l);
+  CtrlAxis c = {.target = HI};
+  limit_update(&l.phi, &c, 5);
+  CHECK_EQ(limit_retreat(&l, &l.phi), HI - 33 * 65536);
+  CHECK_EQ(limit_sat(&l), 0);
+  CHECK_EQ(limit_latched(&l), LIMIT_PHIHI);
+  CHECK_EQ(limit_error(&l.phi, 5), 0);
+  CHECK_EQ(limit_error(&l.phi, 0), 0);
+  CHECK_EQ(limit_latched(&l), LIMIT_PHIHI);
+  CHECK_EQ(limit_error(&l.phi, -5), -5);
+  CHECK_EQ(limit_latched(&l), 0);
+  CHECK_EQ(limit_error(&l.phi, 5), 5);
+
+  // a narrow axis ends up in the middle
+  limit_setrange(&l.tht, -10 * 65536, 20 * 65536);
+  c.target = -10 * 65536;
+  limit_update(&l.tht, &c, -5);
+  CHECK_EQ(limit_retreat(&l, &l.tht), 5 * 65536);
+  CHECK_EQ(limit_latched(&l), LIMIT_THTLO);
+  limit_release(&l);
+  CHECK_EQ(limit_latched(&l), 0);
+}
+
+static void move(int8_t x, int8_t y) {
+  const uint8_t frame[] = {MOVEOP, (uint8_t)x, (uint8_t)y, ENDOFDATA};
+  for (int i = 0; i < 4; i++)
+    turret_rxbyte(frame[i]);
+  turret_poll();
+}
+
+// MAXBOUNDCNT saturated frames in a row give up, a free one starts over
+static void count(void) {
+  turret_init();
+  TurretUnit *u = &turret.unit[0];
+  // movex is negated into phi: -x pushes phi up to its hi bound
+  int n = 0;
+  while (!limit_sat(&u->limit) && n++ < 10000)
+    move(-100, 0);
+  CHECK_EQ(limit_sat(&u->limit), LIMIT_PHIHI);
+  CHECK_EQ(u->ctrl.phi.target, u->phiservo.hi);
+  for (int i = 1; i < MAXBOUNDCNT - 1; i++)
+    move(-100, 0);
+  CHECK_EQ(u->boundcnt, 1);
+  // one frame that stops pushing resets the count
+  move(0, 0);
+  CHECK_EQ(u->boundcnt, MAXBOUNDCNT);
+  CHECK(!limit_latched(&u->limit));
+  for (int i = 0; i < MAXBOUNDCNT - 1; i++)
+    move(-100, 0);
+  CHECK(!limit_latched(&u->limit));
+  move(-100, 0);
+  CHECK_EQ(limit_latched(&u->limit), LIMIT_PHIHI);
+  CHECK_EQ(u->ctrl.phi.target, u->phiservo.hi - LIMITBACKOFF * 65536);
+  CHECK_EQ(u->limittx.sides, LIMIT_PHIHI);
+
+  // errors out no longer move it, one back in does
+  move(-100, 0);
+  CHECK_EQ(u->ctrl.phi.target, u->phiservo.hi - LIMITBACKOFF * 65536);
+  CHECK_EQ(limit_sat(&u->limit), 0);
+  move(10, 0);
+  CHECK(!limit_latched(&u->limit));
+  CHECK(u->ctrl.phi.target < u->phiservo.hi - LIMITBACKOFF * 65536);
+}
+
+int main(void) {
+  update();
+  retreat();
+  count();
+  return test_end("test_limit");
+}
@@ -0,0 +1,116 @@
+/**
+ ******************************************************************************
+ * @file    test_motor.c
+ * @brief   motor_*(): soft-start ramp, idle hold, stop and config checks.
+ ******************************************************************************
+ */
+#include "test.h"
+#include "turret_motor.h"
+
+extern int thal_motorpm;
+extern uint32_t thal_now;
+
+static void tick(Motor *m, int busy) {
+  thal_now++;
+  motor_tick(m, busy);
+}
+
+// 10ms at 1kHz from 0 to 1000: 100 permille per tick
+static void ramp(void) {
+  Motor m;
+  thal_now = 1000;
+  motor_init(&m, 0, 1000, 10, 500);
+  CHECK_EQ(thal_motorpm, 0);
+  CHECK(!motor_busy(&m));
+  motor_spin(&m);
+  CHECK(motor_busy(&m));
+  CHECK(!motor_on(&m));
+  for (int i = 1; i < 10; i++) {
+    tick(&m, 0);
+    CHECK_EQ(thal_motorpm, 100 * i);
+    CHECK(motor_on(&m));
+    CHECK(!motor_ready(&m));
+  }
+  tick(&m, 0);
+  CHECK_EQ(thal_motorpm, 1000);
+  CHECK(motor_ready(&m));
+  tick(&m, 0);
+  CHECK_EQ(thal_motorpm, 1000);
+
+  // no ramp: straight to the run duty
+  motor_init(&m, 0, 600, 0, 500);
+  motor_spin(&m);
+  tick(&m, 0);
+  CHECK_EQ(thal_motorpm, 600);
+  CHECK(motor_ready(&m));
+}
+
+// runs for the idle hold after the last use, then off in one step
+static void idle(void) {
+  Motor m;
+  thal_now = 1000;
+  motor_init(&m, 0, 800, 0, 500);
+  motor_spin(&m);
+  while (thal_now < 1000 + 499) {
+    tick(&m, 0);
+    CHECK_EQ(thal_motorpm, 800);
+  }
+  tick(&m, 0);
+  CHECK_EQ(thal_motorpm, 0);
+  CHECK(!motor_on(&m));
+  CHECK(!motor_busy(&m));
+
+  // busy ticks hold it like motor_spin() does
+  motor_spin(&m);
+  for (int i = 0; i < 2000; i++)
+    tick(&m, 1);
+  CHECK_EQ(thal_motorpm, 800);
+  for (int i = 0; i < 499; i++)
+    tick(&m, 0);
+  CHECK_EQ(thal_motorpm, 800);
+  tick(&m, 0);
+  CHECK_EQ(thal_motorpm, 0);
+}
+
+// off on the next tick, even while busy
+static void stop(void) {
+  Motor m;
+  thal_now = 1000;
+  motor_init(&m, 0, 1000, 10, 500);
+  motor_spin(&m);
+  for (int i = 0; i < 5; i++)
+    tick(&m, 0);
+  CHECK_EQ(thal_motorpm, 500);
+  motor_stop(&m);
+  CHECK(motor_busy(&m));
+  tick(&m, 1);
+  CHECK_EQ(thal_motorpm, 0);
+  CHECK(!motor_busy(&m));
+  // a new spin ramps from 0 again
+  motor_spin(&m);
+  tick(&m, 0);
+  CHECK_EQ(thal_motorpm, 100);
+}
+
+static void config(void) {
+  Motor m;
+  motor_init(&m, 0, 1000, 10, 500);
+  CHECK(!motor_config(&m, 0, 10, 500));
+  CHECK(!motor_config(&m, 1001, 10, 500));
+  CHECK(!motor_config(&m, 500, -1, 500));
+  CHECK(!motor_config(&m, 500, 10, 0));
+  CHECK_EQ(m.runduty, 1000);
+  CHECK_EQ(m.idlehold, 500);
+  CHECK(motor_config(&m, 500, 20, 100));
+  CHECK_EQ(m.runduty, 500);
+  CHECK_EQ(m.ramp, 500 * 65536 / 20);
+  CHECK_EQ(m.idlehold, 100);
+}
+
+int main(void) {
+  ramp();
+  idle();
+  stop();
+  config();
+  return test_end("test_motor");
+}
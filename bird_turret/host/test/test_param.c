@@ -0,0 +1,136 @@
+/**
+ ******************************************************************************
+ * @file    test_param.c
+ * @brief   param_load() and param_commit() on a RAM sector (thal_test.c).
+ ******************************************************************************
+ */
+#include "test.h"
+#include "turret_hal.h"
+#include "turret_param.h"
+#include <string.h>
+
+extern uint32_t thal_testflash[];
+extern uint32_t thal_testflashsize;
+extern int thal_testfail;
+
+// what turret_init() does: defaults, then the sector over them
+static int boot(Params *p) {
+  param_defaults(p);
+  return param_load(p);
+}
+
+static int commit(Params *p) {
+  int erased;
+  return param_commit(p, &erased);
+}
+
+static void empty(void) {
+  Params p;
+  thal_flasherase();
+  CHECK(!boot(&p));
+  CHECK_EQ(p.seq, 0);
+  CHECK_EQ(p.used, 0);
+  CHECK_EQ(p.v[0][PARAM_KPX].f == param_desc[PARAM_KPX].dflt.f, 1);
+}
+
+static void roundtrip(void) {
+  Params p, q;
+  thal_flasherase();
+  boot(&p);
+  p.v[0][PARAM_PHICENTER].i = 4321;
+  p.v[0][PARAM_KPX].f = 2.5f;
+  CHECK(commit(&p));
+  CHECK_EQ(p.seq, 1);
+  p.v[0][PARAM_PHICENTER].i = 4400;
+  CHECK(commit(&p));
+  CHECK_EQ(p.seq, 2);
+
+  // the last record wins
+  CHECK(boot(&q));
+  CHECK_EQ(q.seq, 2);
+  CHECK_EQ(q.used, p.used);
+  CHECK_EQ(q.v[0][PARAM_PHICENTER].i, 4400);
+  CHECK(q.v[0][PARAM_KPX].f == 2.5f);
+  CHECK(memcmp(p.v, q.v, sizeof(p.v)) == 0);
+}
+
+static void torn(void) {
+  Params p, q;
+  thal_flasherase();
+  boot(&p);
+  p.v[0][PARAM_MAXBOUNDCNT].i = 7;
+  CHECK(commit(&p));
+  // reset in the middle of the next write
+  p.v[0][PARAM_MAXBOUNDCNT].i = 9;
+  thal_testfail = 1;
+  CHECK(!commit(&p));
+  thal_testfail = 0;
+  CHECK(boot(&q));
+  CHECK_EQ(q.seq, 1);
+  CHECK_EQ(q.v[0][PARAM_MAXBOUNDCNT].i, 7);
+  // the sector is not trusted past the torn record, the next commit erases
+  CHECK(commit(&q));
+  CHECK(boot(&p));
+  CHECK_EQ(p.seq, 2);
+  CHECK_EQ(p.v[0][PARAM_MAXBOUNDCNT].i, 7);
+}
+
+static void range(void) {
+  Params p, q;
+  thal_flasherase();
+  boot(&p);
+  // a record from a build with another range: that value falls back
+  p.v[0][PARAM_PHIMIN].i = -5;
+  p.v[0][PARAM_PHIMAX].i = 7000;
+  CHECK(commit(&p));
+  CHECK(boot(&q));
+  CHECK_EQ(q.v[0][PARAM_PHIMIN].i, param_desc[PARAM_PHIMIN].dflt.i);
+  CHECK_EQ(q.v[0][PARAM_PHIMAX].i, 7000);
+}
+
+static void full(void) {
+  Params p, q;
+  int erased = 0, commits = 0;
+  thal_flasherase();
+  boot(&p);
+  while (!erased && commits < 1000) {
+    p.v[0][PARAM_SEARCHSWEEPS].i = 1 + commits % 20;
+    CHECK(param_commit(&p, &erased));
+    commits++;
+  }
+  CHECK(erased);
+  CHECK(commits > 1);
+  // after the erase only the newest record is there
+  CHECK(boot(&q));
+  CHECK_EQ(q.seq, commits);
+  CHECK_EQ(q.used, p.used);
+  CHECK(q.used < thal_testflashsize / 2);
+  CHECK_EQ(q.v[0][PARAM_SEARCHSWEEPS].i, 1 + (commits - 1) % 20);
+
+  // garbage in the sector: ignored from there on, the next commit erases
+  thal_testflash[q.used / 4] = 0x12345678;
+  CHECK(boot(&q));
+  CHECK_EQ(q.used, thal_testflashsize);
+  CHECK(param_commit(&q, &erased));
+  CHECK(erased);
+}
+
+static void noflash(void) {
+  Params p;
+  uint32_t size = thal_testflashsize;
+  thal_testflashsize = 0;
+  CHECK(!boot(&p));
+  CHECK(!commit(&p));
+  CHECK_EQ(p.seq, 0);
+  thal_testflashsize = size;
+}
+
+int main(void) {
+  empty();
+  roundtrip();
+  torn();
+  range();
+  full();
+  noflash();
+  return test_end("test_param");
+}
@@ -0,0 +1,86 @@
+/**
+ ******************************************************************************
+ * @file    test_pid.c
+ * @brief   pid_update(): clamp, rate limit, integral, anti-windup, reset.
+ ******************************************************************************
+ */
+#include "test.h"
+#include "turret_pid.h"
+
+#define LIM (10 * 65536) // +-10 counts
+
+static void clamp(void) {
+  Pid p;
+  pid_init(&p, PID_Q15(1.f), 0, 0, -LIM, LIM, 0);
+  CHECK_EQ(pid_update(&p, 4), 4 * 65536);
+  CHECK(!p.saturated);
+  CHECK_EQ(pid_update(&p, 100), LIM);
+  CHECK(p.saturated);
+  CHECK_EQ(pid_update(&p, -100), -LIM);
+  CHECK(p.saturated);
+
+  // new limits clamp the running state
+  pid_tune(&p, PID_Q15(1.f), 0, 0, -LIM / 2, LIM / 2, 0);
+  CHECK_EQ(p.out, -LIM / 2);
+  CHECK(p.integ >= -LIM / 2 && p.integ <= LIM / 2);
+}
+
+static void rate(void) {
+  Pid p;
+  pid_init(&p, PID_Q15(1.f), 0, 0, -LIM, LIM, 65536);
+  for (int i = 1; i <= 5; i++) {
+    CHECK_EQ(pid_update(&p, 100), i * 65536);
+    CHECK(p.saturated);
+  }
+}
+
+// the integral of a frame is in that frame's output, not the next one
+static void integral(void) {
+  Pid p;
+  pid_init(&p, 0, PID_Q15(.5f), 0, -LIM, LIM, 0);
+  CHECK_EQ(pid_update(&p, 4), 2 * 65536);
+  CHECK_EQ(pid_update(&p, 4), 4 * 65536);
+  CHECK_EQ(pid_update(&p, 0), 4 * 65536);
+}
+
+static void windup(void) {
+  Pid p;
+  pid_init(&p, PID_Q15(.5f), PID_Q15(.5f), 0, -LIM, LIM, 0);
+  // pushed against the bound for a long time
+  int32_t integmax = 0;
+  for (int i = 0; i < 200; i++) {
+    pid_update(&p, 100);
+    integmax = p.integ > integmax ? p.integ : integmax;
+  }
+  CHECK(integmax <= LIM);
+  CHECK_EQ(p.out, LIM);
+  // the integrator did not wind up: a small error the other way leaves the
+  // bound on the first update
+  CHECK(pid_update(&p, -4) < LIM);
+  CHECK(!p.saturated);
+}
+
+static void reset(void) {
+  Pid p;
+  pid_init(&p, 0, 0, PID_Q15(1.f), -LIM, LIM, 0);
+  p.dalpha = PID_Q15(1.f);
+  pid_update(&p, 3);
+  pid_reset(&p, 2 * 65536);
+  CHECK_EQ(p.out, 2 * 65536);
+  // no derivative kick from the first sample after the reset, however large
+  CHECK_EQ(pid_update(&p, 8), 2 * 65536);
+  // the next one differentiates against it
+  CHECK_EQ(pid_update(&p, 9), 3 * 65536);
+  // a reset outside the limits starts on the bound
+  pid_reset(&p, 2 * LIM);
+  CHECK_EQ(p.out, LIM);
+}
+
+int main(void) {
+  clamp();
+  rate();
+  integral();
+  windup();
+  reset();
+  return test_end("test_pid");
+}
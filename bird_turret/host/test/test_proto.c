@@ -0,0 +1,164 @@
+/**
+ ******************************************************************************
+ * @file    test_proto.c
+ * @brief   proto_feed(): legacy and framed commands, units, crc and resync.
+ ******************************************************************************
+ */
+#include "test.h"
+#include "turret_proto.h"
+#include <string.h>
+
+// feeds n bytes, returns the last non-PROTO_NONE result and how many there
+// were
+static int feed(Proto *p, const uint8_t *b, int n, int *results) {
+  int last = PROTO_NONE;
+  *results = 0;
+  for (int i = 0; i < n; i++) {
+    int r = proto_feed(p, b[i]);
+    if (r != PROTO_NONE) {
+      last = r;
+      ++*results;
+    }
+  }
+  return last;
+}
+
+// CMDTRACK frame into buf, returns its length
+static int track(uint8_t *buf, uint32_t stamp, int8_t x, int8_t y) {
+  uint8_t *b = buf + 4;
+  b[0] = stamp, b[1] = stamp >> 8, b[2] = stamp >> 16, b[3] = stamp >> 24;
+  b[4] = (uint8_t)x, b[5] = (uint8_t)y;
+  proto_seal(buf, CMDTRACK, CMDTRACKLEN);
+  return 5 + CMDTRACKLEN;
+}
+
+static void legacy(void) {
+  Proto p;
+  int n;
+  proto_init(&p);
+  const uint8_t move[] = {MOVEOP, (uint8_t)-7, 12, ENDOFDATA};
+  CHECK_EQ(feed(&p, move, 4, &n), PROTO_MOVE);
+  CHECK_EQ(n, 1);
+  CHECK_EQ(p.oper[1], -7);
+  CHECK_EQ(p.oper[2], 12);
+  CHECK_EQ(p.rxmoves, 1);
+
+  // a lost byte costs that frame only, the window slides onto the next
+  const uint8_t lost[] = {MOVEOP, 3, ENDOFDATA, TRIGOP, 0, 0, ENDOFDATA};
+  CHECK_EQ(feed(&p, lost, sizeof(lost), &n), PROTO_TRIG);
+  CHECK_EQ(n, 1);
+  CHECK_EQ(p.rxtrigs, 1);
+}
+
+static void framed(void) {
+  Proto p;
+  uint8_t buf[32];
+  int n;
+  proto_init(&p);
+  int len = track(buf, 0x12345678, -3, 40);
+  CHECK_EQ(feed(&p, buf, len, &n), PROTO_TRACK);
+  CHECK_EQ(n, 1);
+  CHECK_EQ(p.trackstamp, 0x12345678);
+  CHECK_EQ(p.trackx, -3);
+  CHECK_EQ(p.tracky, 40);
+  CHECK_EQ(p.rxerrors, 0);
+
+  // payload bytes that look like a MOVEOP frame stay out of the window
+  len = track(buf, MOVEOP | 5 << 8 | 6 << 16 | ENDOFDATA << 24, 0, 0);
+  CHECK_EQ(feed(&p, buf, len, &n), PROTO_TRACK);
+  CHECK_EQ(n, 1);
+
+  // and a legacy frame right after a framed one still decodes
+  const uint8_t move[] = {MOVEOP, 1, 2, ENDOFDATA};
+  CHECK_EQ(feed(&p, move, 4, &n), PROTO_MOVE);
+}
+
+// rasptostm with several units puts a CMDUNIT in front of every command,
+// legacy ones included
+static void unit(void) {
+  Proto p;
+  uint8_t buf[32];
+  int n;
+  proto_init(&p);
+  buf[4] = 1;
+  proto_seal(buf, CMDUNIT, 1);
+  memcpy(buf + 6, (const uint8_t[]){MOVEOP, 4, 5, ENDOFDATA}, 4);
+  CHECK_EQ(feed(&p, buf, 6, &n), PROTO_UNIT);
+  CHECK_EQ(p.unit, 1);
+  CHECK_EQ(feed(&p, buf + 6, 4, &n), PROTO_MOVE);
+  CHECK_EQ(n, 1);
+  CHECK_EQ(p.oper[1], 4);
+
+  buf[4] = 0;
+  proto_seal(buf, CMDUNIT, 1);
+  int len = track(buf + 6, 100, -1, 1);
+  CHECK_EQ(feed(&p, buf, 6, &n), PROTO_UNIT);
+  CHECK_EQ(p.unit, 0);
+  CHECK_EQ(feed(&p, buf + 6, len, &n), PROTO_TRACK);
+  CHECK_EQ(n, 1);
+}
+
+static void crc(void) {
+  Proto p;
+  uint8_t buf[64];
+  int n;
+  proto_init(&p);
+  int len = track(buf, 1, 1, 1);
+  buf[len - 1] ^= 0x40;
+  CHECK_EQ(feed(&p, buf, len, &n), PROTO_NONE);
+  CHECK_EQ(p.rxerrors, 1);
+  // the next frame is taken as it comes
+  len = track(buf, 2, 2, 2);
+  CHECK_EQ(feed(&p, buf, len, &n), PROTO_TRACK);
+  CHECK_EQ(p.trackstamp, 2);
+
+  // a corrupt payload byte fails the crc as well
+  len = track(buf, 3, 3, 3);
+  buf[6] ^= 0x01;
+  CHECK_EQ(feed(&p, buf, len, &n), PROTO_NONE);
+  CHECK_EQ(p.rxerrors, 2);
+  CHECK_EQ(p.trackstamp, 2);
+}
+
+static void resync(void) {
+  Proto p;
+  uint8_t buf[64];
+  int n;
+  proto_init(&p);
+
+  // stray sync bytes in front: the last AA starts the frame
+  buf[0] = TELEMSYNC0, buf[1] = TELEMSYNC0;
+  int len = 2 + track(buf + 2, 4, 4, 4);
+  CHECK_EQ(feed(&p, buf, len, &n), PROTO_TRACK);
+  CHECK_EQ(p.trackstamp, 4);
+
+  // unknown type and impossible length are dropped at once
+  const uint8_t unknown[] = {TELEMSYNC0, TELEMSYNC1, 0x7f, 0};
+  CHECK_EQ(feed(&p, unknown, 4, &n), PROTO_NONE);
+  const uint8_t badlen[] = {TELEMSYNC0, TELEMSYNC1, CMDTRACK, 5};
+  CHECK_EQ(feed(&p, badlen, 4, &n), PROTO_NONE);
+  len = track(buf, 5, 5, 5);
+  CHECK_EQ(feed(&p, buf, len, &n), PROTO_TRACK);
+  CHECK_EQ(p.trackstamp, 5);
+
+  // a frame that loses a byte swallows the start of the next one; the crc
+  // rejects it and the frame after that decodes
+  len = track(buf, 6, 6, 6);
+  memmove(buf + 5, buf + 6, len - 6);
+  len--;
+  len += track(buf + len, 7, 7, 7);
+  len += track(buf + len, 8, 8, 8);
+  CHECK_EQ(feed(&p, buf, len, &n), PROTO_TRACK);
+  CHECK_EQ(n, 1);
+  CHECK_EQ(p.trackstamp, 8);
+  CHECK_EQ(p.rxerrors, 1);
+}
+
+int main(void) {
+  legacy();
+  framed();
+  unit();
+  crc();
+  resync();
+  return test_end("test_proto");
+}
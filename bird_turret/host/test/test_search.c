@@ -0,0 +1,158 @@
+/**
+ ******************************************************************************
+ * @file    test_search.c
+ * @brief   search_*() and turret.c on top of it: the spiral, starting it
+ *          after the host goes quiet, giving up and taking over from it.
+ ******************************************************************************
+ */
+#include "test.h"
+#include "turret.h"
+#include "turret_config.h"
+#include "turret_proto.h"
+#include <math.h>
+
+#define DT .001f
+
+extern uint32_t thal_now;
+
+static const float lo[2] = {-3000, -3000}, hi[2] = {3000, 3000};
+
+// the radius grows by the pitch per sweep, then the spiral ends by itself
+static void spiral(void) {
+  Search s;
+  search_init(&s);
+  search_tune(&s, 100, 1000, 2);
+  CHECK_EQ(s.sweep, 0);
+  search_start(&s, 200, -100);
+  CHECK(s.active);
+  float phi = 0, tht = 0, r = 0;
+  int steps = 0, sweep = 1;
+  while (search_step(&s, DT, lo, hi, &phi, &tht)) {
+    float rr = hypotf(phi - 200, tht + 100);
+    CHECK(rr >= r);
+    CHECK(rr >= 100 * s.sweep - .5f && rr <= 100 * (s.sweep + 1) + .5f);
+    CHECK(s.sweep == sweep || s.sweep == sweep + 1);
+    r = rr, sweep = s.sweep, steps++;
+  }
+  CHECK_EQ(sweep, 2);
+  // 2 turns from 100 to 300 at 1000 counts/s: 2 * 2pi * 200 counts
+  CHECK(fabsf(steps * DT - 2 * 6.2832f * 200 / 1000) < .01f);
+  CHECK(!s.active);
+  CHECK(s.done);
+  CHECK_EQ(s.sweep, 0);
+  // nothing to take over after a spiral that ran out
+  CHECK(!search_take(&s));
+}
+
+// every point inside the bounds, the spiral goes on along them
+static void bounds(void) {
+  Search s;
+  search_init(&s);
+  search_tune(&s, 500, 2000, 1);
+  search_start(&s, 2900, 0);
+  float phi, tht;
+  int clamped = 0;
+  while (search_step(&s, DT, lo, hi, &phi, &tht)) {
+    CHECK(phi <= hi[0] && phi >= lo[0]);
+    clamped += phi == hi[0];
+  }
+  CHECK(clamped > 0);
+}
+
+static void stop(void) {
+  Search s;
+  search_init(&s);
+  search_tune(&s, 100, 1000, 2);
+  search_stop(&s);
+  CHECK(!search_take(&s));
+  search_start(&s, 0, 0);
+  float phi, tht;
+  search_step(&s, DT, lo, hi, &phi, &tht);
+  search_stop(&s);
+  CHECK(!s.active);
+  CHECK_EQ(s.sweep, 0);
+  CHECK(!search_step(&s, DT, lo, hi, &phi, &tht));
+  CHECK(search_take(&s));
+  CHECK(!search_take(&s));
+  // a recenter leaves nothing to take
+  search_start(&s, 0, 0);
+  search_cancel(&s);
+  CHECK(!search_take(&s));
+  CHECK(!s.done);
+}
+
+static void move(int8_t x, int8_t y) {
+  const uint8_t frame[] = {MOVEOP, (uint8_t)x, (uint8_t)y, ENDOFDATA};
+  for (int i = 0; i < 4; i++)
+    turret_rxbyte(frame[i]);
+  turret_poll();
+}
+
+static void run(int ms) {
+  for (int i = 0; i < ms; i++) {
+    thal_now++;
+    turret_tick();
+    turret_poll();
+  }
+}
+
+// SEARCHDELAYMS of silence on an engaged target start the spiral around
+// the last target, the last sweep recenters
+static void giveup(void) {
+  thal_now = 1000;
+  turret_init();
+  TurretUnit *u = &turret.unit[0];
+  run(100);
+  CHECK(!u->search.active);
+  move(-20, 10);
+  CHECK(u->engaged);
+  int32_t phi = u->ctrl.phi.target, tht = u->ctrl.tht.target;
+  CHECK(phi != 0);
+  run(SEARCHDELAYMS - 1);
+  CHECK(!u->search.active);
+  run(1);
+  CHECK(u->search.active);
+  CHECK_EQ(u->searches, 1);
+  CHECK(!u->engaged);
+  CHECK(fabsf(u->search.cphi - phi / 65536.f) < .01f);
+  CHECK(fabsf(u->search.ctht - tht / 65536.f) < .01f);
+  // around the target, which stays where it was
+  run(1000);
+  CHECK_EQ(u->search.sweep, 1);
+  CHECK(u->phitraj.out != phi / 65536.f);
+  CHECK_EQ(u->ctrl.phi.target, phi);
+  int ms = 1000;
+  while (u->search.active && ms < 60000)
+    run(1), ms++;
+  CHECK(!u->search.active);
+  CHECK_EQ(u->ctrl.phi.target, 0);
+  CHECK_EQ(u->ctrl.tht.target, 0);
+  // once per loss
+  run(SEARCHDELAYMS);
+  CHECK_EQ(u->searches, 1);
+}
+
+// a host frame stops the spiral, the pid goes on from where it had the
+// camera
+static void take(void) {
+  thal_now = 1000;
+  turret_init();
+  TurretUnit *u = &turret.unit[0];
+  move(-20, 10);
+  run(SEARCHDELAYMS + 500);
+  CHECK(u->search.active);
+  float phi = u->phitraj.out;
+  move(0, 0);
+  CHECK(!u->search.active);
+  CHECK(u->engaged);
+  CHECK_EQ(u->ctrl.phi.target, (int32_t)lroundf(phi * 65536));
+}
+
+int main(void) {
+  spiral();
+  bounds();
+  stop();
+  giveup();
+  take();
+  return test_end("test_search");
+}
@@ -0,0 +1,92 @@
+/**
+ ******************************************************************************
+ * @file    test_servo.c
+ * @brief   servo_write() and servo_setlut(): linear map, calibration table,
+ *          bounds.
+ ******************************************************************************
+ */
+#include "test.h"
+#include "turret_hal.h"
+#include "turret_servo.h"
+
+#define CENTER 4500
+#define MIN 1500
+#define MAX 7500
+#define LUTN 5
+#define LUTSTART -60000000 // udeg
+#define LUTSTEP 30000000
+
+extern int thal_ccr[2];
+
+static void linear(void) {
+  Servo s;
+  servo_init(&s, THAL_PHI, CENTER, MIN, MAX);
+  CHECK_EQ(s.ccr, CENTER);
+  CHECK_EQ(s.lo, (MIN - CENTER) * 65536);
+  CHECK_EQ(s.hi, (MAX - CENTER) * 65536);
+  servo_write(&s, 100 * 65536);
+  CHECK_EQ(s.ccr, CENTER + 100);
+  CHECK_EQ(thal_ccr[THAL_PHI], CENTER + 100);
+  // rounds to the nearest count
+  servo_write(&s, -100 * 65536 - 0x8001);
+  CHECK_EQ(s.ccr, CENTER - 101);
+  // clamped to the bounds
+  servo_write(&s, 1 << 30);
+  CHECK_EQ(s.ccr, MAX);
+  CHECK_EQ(s.pos, s.hi);
+  servo_write(&s, -(1 << 30));
+  CHECK_EQ(s.ccr, MIN);
+}
+
+static void lut(void) {
+  Servo s;
+  servo_init(&s, THAL_THT, CENTER, MIN, MAX);
+  // falling table, evenly spaced in angle
+  const uint16_t ccr[LUTN] = {6600, 5600, 4400, 3300, 2400};
+  CHECK(servo_setlut(&s, LUTSTART, LUTSTEP, ccr, LUTN));
+  CHECK(s.lut != 0);
+  for (int i = 0; i < LUTN; i++) {
+    servo_write_udeg(&s, LUTSTART + i * LUTSTEP);
+    CHECK_EQ(s.ccr, ccr[i]);
+  }
+  // halfway between two points
+  servo_write_udeg(&s, LUTSTART + LUTSTEP / 2);
+  CHECK(s.ccr >= 6099 && s.ccr <= 6101);
+  // the table ends inside min..max: the bounds are its ends
+  servo_write_udeg(&s, 90000000);
+  CHECK_EQ(s.ccr, ccr[LUTN - 1]);
+  servo_write_udeg(&s, -90000000);
+  CHECK_EQ(s.ccr, ccr[0]);
+
+  // a table reaching past a limit bounds the angle where it crosses it
+  const uint16_t wide[LUTN] = {1000, 3000, 4500, 6000, 8000};
+  CHECK(servo_setlut(&s, LUTSTART, LUTSTEP, wide, LUTN));
+  servo_write(&s, s.hi);
+  CHECK(s.ccr >= MAX - 1 && s.ccr <= MAX);
+  servo_write(&s, s.lo);
+  CHECK(s.ccr >= MIN && s.ccr <= MIN + 1);
+
+  // rejected: not monotonic, never inside min..max, bad step or size
+  const uint16_t bent[LUTN] = {2000, 3000, 2900, 4000, 5000};
+  const uint16_t high[LUTN] = {7600, 7700, 7800, 7900, 8000};
+  const ServoLut *before = s.lut;
+  CHECK(!servo_setlut(&s, LUTSTART, LUTSTEP, bent, LUTN));
+  CHECK(!servo_setlut(&s, LUTSTART, LUTSTEP, high, LUTN));
+  CHECK(!servo_setlut(&s, LUTSTART, 0, wide, LUTN));
+  CHECK(!servo_setlut(&s, LUTSTART, LUTSTEP, wide, 1));
+  CHECK(!servo_setlut(&s, LUTSTART, LUTSTEP, wide, SERVOLUTMAX + 1));
+  CHECK(s.lut == before);
+
+  // no points: linear again
+  CHECK(servo_setlut(&s, 0, 0, 0, 0));
+  CHECK(s.lut == 0);
+  CHECK_EQ(s.lo, (MIN - CENTER) * 65536);
+  servo_write(&s, 0);
+  CHECK_EQ(s.ccr, CENTER);
+}
+
+int main(void) {
+  linear();
+  lut();
+  return test_end("test_servo");
+}
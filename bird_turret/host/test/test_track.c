@@ -0,0 +1,112 @@
+/**
+ ******************************************************************************
+ * @file    test_track.c
+ * @brief   track_update(): measurements built on the pose at the frame time.
+ ******************************************************************************
+ */
+#include "test.h"
+#include "turret_track.h"
+#include <math.h>
+
+#define K 8.f   // counts per error unit
+#define LAG 40  // ms
+#define LIM 3000
+
+static const int32_t lo[2] = {-LIM * 65536, -LIM * 65536};
+static const int32_t hi[2] = {LIM * 65536, LIM * 65536};
+
+static void setup(Track *t) {
+  track_init(t);
+  track_tune(t, .5f, .15f, 250, K, K, LAG);
+}
+
+// first frame: the pose the payload had reached at stamp, not the ctrl
+// targets and not where the pulses are now
+static void pose(void) {
+  Track t;
+  setup(&t);
+  // slewing at 1 count/ms from 0
+  for (uint32_t ms = 1000; ms <= 1200; ms++)
+    track_pose(&t, ms, (float)(ms - 1000), -(float)(ms - 1000));
+  int32_t phi = 500 * 65536, tht = 500 * 65536;
+  track_update(&t, 10, -10, 1150, lo, hi, &phi, &tht);
+  // pulse at 1110 plus the error
+  CHECK(fabsf(phi / 65536.f - (110 + 10 * K)) < .01f);
+  CHECK(fabsf(tht / 65536.f - (-110 - 10 * K)) < .01f);
+
+  // a frame older than the history takes the oldest pulse left
+  track_reset(&t);
+  phi = tht = 0;
+  track_update(&t, 0, 0, 100, lo, hi, &phi, &tht);
+  CHECK(phi / 65536.f >= 0 && phi / 65536.f < 4);
+}
+
+// no pulses yet: the ctrl targets are the pose
+static void nohistory(void) {
+  Track t;
+  setup(&t);
+  int32_t phi = 100 * 65536, tht = -100 * 65536;
+  track_update(&t, 1, 1, 500, lo, hi, &phi, &tht);
+  CHECK(fabsf(phi / 65536.f - (100 + K)) < .01f);
+  CHECK(fabsf(tht / 65536.f - (-100 + K)) < .01f);
+}
+
+// a late tick leaves the pulse that was on for the ms it skipped
+static void gap(void) {
+  Track t;
+  setup(&t);
+  track_pose(&t, 1000, 5, 5);
+  track_pose(&t, 1010, 50, 50);
+  int32_t phi = 0, tht = 0;
+  track_update(&t, 0, 0, 1005 + LAG, lo, hi, &phi, &tht);
+  CHECK(fabsf(phi / 65536.f - 5) < .01f);
+}
+
+// the control tick can stop once the estimate coasts no more
+static void moving(void) {
+  Track t;
+  setup(&t);
+  CHECK(!track_moving(&t, 1000));
+  int32_t phi = 0, tht = 0;
+  track_update(&t, 1, 0, 1000, lo, hi, &phi, &tht);
+  CHECK(track_moving(&t, 1000 + 249));
+  CHECK(!track_moving(&t, 1000 + 250));
+  track_reset(&t);
+  CHECK(!track_moving(&t, 1001));
+}
+
+// closed loop against a payload LAG ms behind the pulses and a camera 70ms
+// late: the estimate and the payload settle on a still bird
+static void still(void) {
+  Track t;
+  setup(&t);
+  static float pulse[3001], payload[3001];
+  const float bird = 600;
+  float cmd = 0;
+  int32_t phi = 0, tht = 0;
+  for (uint32_t ms = 1; ms <= 3000; ms++) {
+    float p, q;
+    if (track_target(&t, ms, &p, &q))
+      cmd = p;
+    track_pose(&t, ms, cmd, 0);
+    // the payload gets there LAG ms after the pulse
+    pulse[ms] = cmd;
+    payload[ms] = ms >= LAG ? pulse[ms - LAG] : 0;
+    // camera at 15fps, the error of a frame arrives 70ms later
+    if (ms > 70 && (ms - 70) % 66 == 0) {
+      int err = (int)lroundf((bird - payload[ms - 70]) / K);
+      track_update(&t, err, 0, ms - 70, lo, hi, &phi, &tht);
+    }
+  }
+  CHECK(fabsf(payload[3000] - bird) < 2 * K);
+  CHECK(fabsf(cmd - bird) < 2 * K);
+}
+
+int main(void) {
+  pose();
+  nohistory();
+  gap();
+  moving();
+  still();
+  return test_end("test_track");
+}
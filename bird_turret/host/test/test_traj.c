@@ -0,0 +1,92 @@
+/**
+ ******************************************************************************
+ * @file    test_traj.c
+ * @brief   traj_step(): arrival on the target within the S-curve limits,
+ *          and of the shaped output.
+ ******************************************************************************
+ */
+#include "test.h"
+#include "turret_config.h"
+#include "turret_traj.h"
+#include <math.h>
+
+#define DT (1.0f / TICKHZ)
+#define MAXTICKS (5 * TICKHZ)
+
+// runs to rest, returns the ticks it took or -1; checks the limits and
+// the overshoot on the way
+static int arrive(Traj *t, float target) {
+  float from = t->pos, prevacc = t->acc;
+  float dir = target < from ? -1 : 1;
+  traj_target(t, target);
+  for (int i = 1; i <= MAXTICKS; i++) {
+    traj_step(t, DT);
+    CHECK(fabsf(t->vel) <= t->vmax * 1.001f);
+    CHECK(fabsf(t->acc) <= t->amax * 1.001f);
+    CHECK(fabsf(t->acc - prevacc) <= t->jmax * DT * 1.001f);
+    // no overshoot beyond the arrival tolerance
+    CHECK((t->pos - target) * dir <= 0.05f);
+    prevacc = t->acc;
+    if (traj_done(t))
+      return i;
+  }
+  return -1;
+}
+
+int main(void) {
+  Traj t;
+  traj_init(&t, 0, PHIVMAX, PHIAMAX, PHIJMAX);
+  CHECK(traj_done(&t));
+
+  // long move: cruises at vmax, lands exactly on the target
+  int ticks = arrive(&t, 3000);
+  CHECK(ticks > 0);
+  CHECK(t.pos == 3000 && t.vel == 0 && t.acc == 0);
+  // no faster than vmax allows
+  CHECK(ticks >= 3000 / PHIVMAX * TICKHZ);
+
+  // back, and a step below one count
+  CHECK(arrive(&t, -100) > 0);
+  CHECK(t.pos == -100);
+  CHECK(arrive(&t, -99.5f) > 0);
+  CHECK(t.pos == -99.5f);
+
+  // retargeted behind while moving: turns around and still arrives
+  traj_target(&t, 2000);
+  for (int i = 0; i < 60; i++)
+    traj_step(&t, DT);
+  CHECK(!traj_done(&t));
+  CHECK(t.vel > 0);
+  CHECK(arrive(&t, -600) > 0);
+  CHECK(t.pos == -600);
+
+  // the tilt limits as well
+  traj_init(&t, 0, THTVMAX, THTAMAX, THTJMAX);
+  CHECK(arrive(&t, -1500) > 0);
+  CHECK(t.pos == -1500);
+
+  // shaped: the output trails the S-curve by the shaper delay, never
+  // passes it and lands exactly. The landing may dither below a count
+  traj_init(&t, 0, PHIVMAX, PHIAMAX, PHIJMAX);
+  traj_shape(&t, SHAPEHZ, SHAPEZETA, DT);
+  CHECK(t.delay > 0 && t.delay <= TRAJSHAPEMAX);
+  traj_target(&t, 1500);
+  int unshaped = -1, shaped = -1;
+  float prevout = 0;
+  for (int i = 1; i <= MAXTICKS && shaped < 0; i++) {
+    float out = traj_step(&t, DT);
+    CHECK(out == t.out);
+    CHECK(out >= prevout - 1 && out <= t.pos);
+    prevout = out;
+    if (unshaped < 0 && t.pos == 1500 && t.vel == 0)
+      unshaped = i;
+    if (traj_done(&t))
+      shaped = i;
+  }
+  CHECK(unshaped > 0 && shaped == unshaped + t.delay);
+  CHECK(t.out == 1500);
+  // off again
+  traj_shape(&t, 0, 0, DT);
+  CHECK(traj_step(&t, DT) == 1500 && traj_done(&t));
+  return test_end("test_traj");
+}
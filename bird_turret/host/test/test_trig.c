@@ -0,0 +1,150 @@
+/**
+ ******************************************************************************
+ * @file    test_trig.c
+ * @brief   trig_*(): step table, table checks, bursts, abort and late
+ *          expiries.
+ ******************************************************************************
+ */
+#include "test.h"
+#include "turret_trig.h"
+
+#define REST 2100
+
+extern int thal_ccr1, thal_trigms, thal_cooldownms, thal_led;
+
+static const TrigStep table[] = {{6800, 500}, {REST, 300}, {6800, 200}};
+
+// each expiry plays the next step, the last one returns to rest
+static void steps(void) {
+  Trig t;
+  trig_init(&t, 0, table, 3, REST);
+  CHECK_EQ(thal_ccr1, REST);
+  CHECK(trig_request(&t));
+  CHECK_EQ(thal_ccr1, 6800);
+  CHECK_EQ(thal_trigms, 500);
+  CHECK_EQ(thal_led, 1);
+  // no second shot on top of the first
+  CHECK(!trig_request(&t));
+  CHECK_EQ(trig_step(&t), TRIG_BUSY);
+  CHECK_EQ(thal_ccr1, REST);
+  CHECK_EQ(thal_trigms, 300);
+  CHECK_EQ(trig_step(&t), TRIG_BUSY);
+  CHECK_EQ(t.progress, 3);
+  CHECK_EQ(trig_step(&t), TRIG_DONE);
+  CHECK_EQ(thal_ccr1, REST);
+  CHECK_EQ(thal_trigms, 0);
+  // no cooldown configured: ready again at once
+  CHECK(!t.shotflag);
+  CHECK_EQ(thal_led, 0);
+  CHECK(trig_request(&t));
+}
+
+static void settable(void) {
+  Trig t;
+  trig_init(&t, 0, table, 3, REST);
+  const TrigStep zero[] = {{6800, 0}};
+  const TrigStep longer[] = {{6800, TRIGMAXMS + 1}};
+  CHECK(!trig_settable(&t, zero, 1));
+  CHECK(!trig_settable(&t, longer, 1));
+  CHECK(!trig_settable(&t, table, 0));
+  CHECK(!trig_settable(&t, table, TRIGMAXSTEPS + 1));
+  CHECK_EQ(t.nsteps, 3);
+  // not while a shot runs
+  trig_request(&t);
+  CHECK(!trig_settable(&t, table, 1));
+  CHECK(!trig_setrest(&t, 1000));
+}
+
+// shots cycles with the interval at rest between them, then the cooldown
+static void burst(void) {
+  Trig t;
+  trig_init(&t, 0, table, 3, REST);
+  CHECK(!trig_setburst(&t, 0, 200, 1000));
+  CHECK(!trig_setburst(&t, 3, TRIGMAXMS + 1, 1000));
+  CHECK(trig_setburst(&t, 3, 200, 1000));
+  trig_request(&t);
+  for (int shot = 1; shot <= 3; shot++) {
+    CHECK_EQ(thal_ccr1, 6800);
+    CHECK_EQ(trig_step(&t), TRIG_BUSY);
+    CHECK_EQ(trig_step(&t), TRIG_BUSY);
+    if (shot < 3) {
+      CHECK_EQ(trig_step(&t), TRIG_SHOT);
+      CHECK_EQ(t.shot, shot);
+      CHECK_EQ(thal_ccr1, REST);
+      CHECK_EQ(thal_trigms, 200);
+      // the interval expiry starts the table again
+      CHECK_EQ(trig_step(&t), TRIG_BUSY);
+    }
+  }
+  CHECK_EQ(trig_step(&t), TRIG_DONE);
+  CHECK_EQ(thal_cooldownms, 1000);
+  CHECK(t.shotflag);
+  CHECK(!trig_request(&t));
+  // not while a burst or its cooldown runs
+  CHECK(!trig_setburst(&t, 1, 0, 0));
+  trig_cooldown(&t);
+  CHECK(!t.shotflag);
+
+  // no interval: the next cycle follows the last step at once
+  trig_setburst(&t, 2, 0, 0);
+  trig_request(&t);
+  trig_step(&t);
+  trig_step(&t);
+  CHECK_EQ(trig_step(&t), TRIG_SHOT);
+  CHECK_EQ(thal_ccr1, 6800);
+  CHECK_EQ(thal_trigms, 500);
+  CHECK_EQ(t.progress, 1);
+
+  // an abort in the interval ends the burst there
+  trig_abort(&t);
+  trig_cooldown(&t);
+  trig_setburst(&t, 3, 200, 0);
+  trig_request(&t);
+  for (int i = 0; i < 3; i++)
+    trig_step(&t);
+  CHECK(trig_abort(&t));
+  CHECK_EQ(trig_step(&t), TRIG_IDLE);
+  CHECK_EQ(thal_ccr1, REST);
+  CHECK(!t.shotflag);
+}
+
+// an abort mid-table rests the trigger, and an expiry that was already
+// pending when the timer stopped does not pull it again
+static void abort_(void) {
+  Trig t;
+  trig_init(&t, 0, table, 3, REST);
+  trig_setburst(&t, 1, 0, 1000);
+  trig_request(&t);
+  trig_step(&t);
+  CHECK(trig_abort(&t));
+  CHECK_EQ(thal_ccr1, REST);
+  CHECK_EQ(thal_trigms, 0);
+  CHECK_EQ(thal_cooldownms, 1000);
+  CHECK(!t.active);
+  CHECK_EQ(trig_step(&t), TRIG_IDLE);
+  CHECK_EQ(thal_ccr1, REST);
+  CHECK_EQ(thal_trigms, 0);
+  // nothing left to abort, the cooldown still holds the next shot
+  CHECK(!trig_abort(&t));
+  CHECK(!trig_request(&t));
+  trig_cooldown(&t);
+  CHECK_EQ(thal_cooldownms, 0);
+  CHECK(trig_request(&t));
+
+  // same after a burst that ran to the end
+  trig_setburst(&t, 1, 0, 0);
+  trig_abort(&t);
+  trig_request(&t);
+  for (int i = 0; i < 3; i++)
+    trig_step(&t);
+  CHECK_EQ(trig_step(&t), TRIG_IDLE);
+  CHECK_EQ(thal_ccr1, REST);
+}
+
+int main(void) {
+  steps();
+  settable();
+  burst();
+  abort_();
+  return test_end("test_trig");
+}
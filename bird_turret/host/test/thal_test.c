@@ -0,0 +1,83 @@
+/**
+ ******************************************************************************
+ * @file    thal_test.c
+ * @brief   turret_hal.h stub for the unit tests: thal_null with a RAM
+ *          parameter sector.
+ *
+ * The trigger and motor outputs and the timers keep their last value in
+ * thal_* for the tests to look at.
+ * The sector is thal_testflash[], thal_testflashsize bytes of it are used
+ * (0: no flash). Writes only clear bits, as on the board; thal_testfail
+ * makes the next writes fail after their first word to leave a torn record.
+ ******************************************************************************
+ */
+#include "turret_hal.h"
+#include <string.h>
+
+#define TESTFLASHMAX 0x20000
+
+int thal_ccr[2], thal_ccr1;
+int thal_trigms, thal_cooldownms; // last arming, 0: stopped
+int thal_led;
+int thal_motorpm;
+uint32_t thal_now;
+uint32_t thal_testflash[TESTFLASHMAX / 4];
+uint32_t thal_testflashsize = 4096;
+int thal_testfail;
+
+void thal_servo(int out, int ccr) { thal_ccr[out] = ccr; }
+void thal_trigger(int out, int ccr) {
+  (void)out;
+  thal_ccr1 = ccr;
+}
+void thal_ccrhold(int hold) { (void)hold; }
+void thal_motor(int out, int permille) {
+  (void)out;
+  thal_motorpm = permille;
+}
+void thal_shotled(int out, int on) {
+  (void)out;
+  thal_led = on;
+}
+void thal_trigtimer(int out, int ms) {
+  (void)out;
+  thal_trigms = ms;
+}
+void thal_cooldowntimer(int out, int ms) {
+  (void)out;
+  thal_cooldownms = ms;
+}
+void thal_ticktimer(int on) { (void)on; }
+uint32_t thal_millis(void) { return thal_now; }
+uint32_t thal_cycles(void) { return 0; }
+uint32_t thal_sleep(volatile const int *wake) {
+  (void)wake;
+  return 0;
+}
+int thal_txready(void) { return 1; }
+void thal_transmit(const uint8_t *data, int len) {
+  (void)data;
+  (void)len;
+}
+int thal_osframe(int i, const uint8_t **frame) {
+  (void)i;
+  (void)frame;
+  return 0;
+}
+
+uint32_t thal_flashsize(void) { return thal_testflashsize; }
+const uint8_t *thal_flashdata(void) { return (const uint8_t *)thal_testflash; }
+int thal_flasherase(void) {
+  memset(thal_testflash, 0xff, sizeof(thal_testflash));
+  return 1;
+}
+int thal_flashwrite(uint32_t offset, const uint32_t *words, int nwords) {
+  if (offset % 4 || offset + 4 * (uint32_t)nwords > thal_testflashsize)
+    return 0;
+  for (int i = 0; i < nwords; i++) {
+    thal_testflash[offset / 4 + i] &= words[i];
+    if (thal_testfail)
+      return 0;
+  }
+  return 1;
+}
@@ -0,0 +1,486 @@
+/**
+ ******************************************************************************
+ * @file    vmcu.c
+ * @brief   Virtual turret MCU on a pseudo-terminal.
+ *
+ * Runs the firmware sources in bird_turret/firmware (the same turret.c that
+ * stm32 and stm32v2 link) behind a host implementation of turret_hal.h, in
+ * the superloop execution model of turret_sched.h. UART5 is
+ * replaced by a pty master whose slave side can be opened by rasptostm.py
+ * like /dev/ttyUSB1, TIM4/TIM2/TIM7 by simulated timers and TIM3 by the servo
+ * model in sim/servo_model.h.
+ *
+ * Time is simulated in microseconds against CLOCK_MONOTONIC so the byte
+ * pacing of the link and the timer periods match the real board.
+ *
+ * -k hands the received bytes to the parser only on the next 1ms kernel
+ * tick, as the stm32 uart task did while it polled with osDelay(1), to
+ * compare PROF_CMDPWM against the interrupt hand-off (CMDPROF).
+ ******************************************************************************
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "turret.h"
+#include "turret_config.h"
+#include "turret_hal.h"
+#include "turret_sched.h"
+#include "../sim/servo_model.h"
+
+#define TIM7PERIOD (1000000 / TICKHZ)
+#define FLASHSIZE 0x20000 // one 128K sector, as on the board
+
+typedef struct {
+  int running;
+  uint64_t next, period; // us
+} Timer;
+
+// peripheral state seen through turret_hal.h
+static int ccr1 = DFLTPULSE, ccr3 = THTCENTER, ccr4 = PHICENTER;
+static int motor = 0, led2 = 0; // motor: duty in permille
+static Timer tim2, tim4;
+
+// link and simulation state
+static int master = -1, slave = -1;
+static uint64_t now, start;
+static long baud = 115200;
+static double flipprob = 0.0, dropprob = 0.0;
+static int telemetry = 1, verbose = 0;
+static FILE *trace = NULL;
+static uint8_t rxq[4096], txq[4096];
+static int rxhead, rxlen, txhead, txlen;
+static uint64_t rxnext, txnext, txbusyuntil;
+static ServoModel phiservo, thtservo;
+static uint64_t servonext, simnext, ticknext;
+static int tickon = 1;
+// -k: bytes stamped in the rx isr, parsed on the next kernel tick
+static int kerneltick = 0;
+static struct {
+  uint32_t stamp;
+  uint8_t byte;
+} taskq[sizeof(rxq)];
+static int tasklen;
+static volatile sig_atomic_t quit = 0;
+static unsigned long bytesin, bytesout, flipped;
+static uint32_t flash[FLASHSIZE / 4];
+static const char *flashpath = NULL;
+
+static uint64_t clockus(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint64_t bytetime(void) {
+  // 8N1: start + 8 data + stop
+  return baud > 0 ? 10000000 / baud : 0;
+}
+
+static void timerstart(Timer *t, uint64_t period) {
+  // HAL_TIM_Base_Start_IT on a running timer returns HAL_ERROR
+  if (t->running)
+    return;
+  t->running = 1;
+  t->period = period;
+  t->next = now + period;
+}
+
+// turret_hal.h, one turret on the channels of the stm32 targets
+void thal_servo(int out, int ccr) {
+  if (out == THAL_PHI)
+    ccr4 = ccr;
+  else
+    ccr3 = ccr;
+}
+
+void thal_trigger(int out, int ccr) {
+  (void)out;
+  ccr1 = ccr;
+}
+// ticks run between frames here, simulate() latches all channels at once
+void thal_ccrhold(int hold) { (void)hold; }
+void thal_motor(int out, int permille) {
+  (void)out;
+  motor = permille;
+}
+void thal_shotled(int out, int on) {
+  (void)out;
+  led2 = on;
+}
+
+void thal_trigtimer(int out, int ms) {
+  (void)out;
+  // one step of the trigger table, restarted rather than ignored
+  tim4.running = 0;
+  if (ms > 0)
+    timerstart(&tim4, (uint64_t)ms * 1000);
+}
+
+void thal_cooldowntimer(int out, int ms) {
+  (void)out;
+  tim2.running = 0;
+  if (ms > 0)
+    timerstart(&tim2, (uint64_t)ms * 1000);
+}
+
+void thal_ticktimer(int on) {
+  // TIM7 with an update event: the first tick comes right away
+  tickon = on;
+  ticknext = now;
+}
+
+uint32_t thal_millis(void) { return (uint32_t)((now - start) / 1000); }
+
+uint32_t thal_cycles(void) {
+  // host ns for the probes, real time rather than the simulated clock
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000000000ull + ts.tv_nsec);
+}
+
+// main() runs turret_poll() itself and waits in poll(), sched_start() is
+// not used here
+uint32_t thal_sleep(volatile const int *wake) {
+  (void)wake;
+  return thal_cycles();
+}
+
+int thal_txready(void) { return txlen == 0 && now >= txbusyuntil; }
+
+void thal_transmit(const uint8_t *data, int len) {
+  for (int i = 0; i < len && txlen < (int)sizeof(txq); i++)
+    txq[(txhead + txlen++) % sizeof(txq)] = data[i];
+}
+
+static void flashsave(void) {
+  // the whole sector, so a later run starts from the same log
+  if (!flashpath)
+    return;
+  FILE *f = fopen(flashpath, "wb");
+  if (!f || fwrite(flash, sizeof(flash), 1, f) != 1)
+    perror("vmcu: flash");
+  if (f)
+    fclose(f);
+}
+
+static void flashload(void) {
+  memset(flash, 0xff, sizeof(flash));
+  if (!flashpath)
+    return;
+  FILE *f = fopen(flashpath, "rb");
+  if (!f)
+    return; // first run, erased
+  if (fread(flash, 1, sizeof(flash), f) != sizeof(flash))
+    fprintf(stderr, "vmcu: %s is short, rest erased\n", flashpath);
+  fclose(f);
+}
+
+uint32_t thal_flashsize(void) { return FLASHSIZE; }
+
+const uint8_t *thal_flashdata(void) { return (const uint8_t *)flash; }
+
+int thal_flasherase(void) {
+  memset(flash, 0xff, sizeof(flash));
+  flashsave();
+  return 1;
+}
+
+int thal_flashwrite(uint32_t offset, const uint32_t *words, int nwords) {
+  if (offset % 4 || offset + 4 * (uint32_t)nwords > FLASHSIZE)
+    return 0;
+  // programming only clears bits, like the real cells
+  for (int i = 0; i < nwords; i++)
+    flash[offset / 4 + i] &= words[i];
+  flashsave();
+  return 1;
+}
+
+// no RTOS here, CMDRTOSSTATS gets no frames
+int thal_osframe(int i, const uint8_t **frame) {
+  (void)i;
+  (void)frame;
+  return 0;
+}
+
+static void simulate(void) {
+  // servos latch the pulse width once per 20ms frame
+  while (now >= servonext) {
+    phiservo.ccr = ccr4 - PHICENTER;
+    thtservo.ccr = ccr3 - THTCENTER;
+    servonext += SERVOFRAME;
+  }
+  while (now >= simnext) {
+    servo_model_step(&phiservo, 1e-3);
+    servo_model_step(&thtservo, 1e-3);
+    if (trace)
+      fprintf(trace, "%.3f,%d,%d,%d,%.3f,%.3f,%d\n", (simnext - start) / 1e3,
+              ccr4, ccr3, ccr1, phiservo.angle, thtservo.angle,
+              turret.unit[0].trig.progress);
+    simnext += 1000;
+  }
+}
+
+static double randunit(void) { return rand() / ((double)RAND_MAX + 1); }
+
+static void readpty(void) {
+  uint8_t buf[256];
+  ssize_t n = read(master, buf, sizeof(buf));
+  for (ssize_t i = 0; i < n && rxlen < (int)sizeof(rxq); i++) {
+    uint8_t b = buf[i];
+    bytesin++;
+    if (dropprob > 0 && randunit() < dropprob) {
+      // framing error on the wire, HAL_UART_ErrorCallback rearms
+      turret_rxerror();
+      continue;
+    }
+    if (flipprob > 0 && randunit() < flipprob) {
+      b ^= 1 << (rand() % 8);
+      flipped++;
+    }
+    if (rxlen == 0 && rxnext < now)
+      rxnext = now + bytetime();
+    rxq[(rxhead + rxlen++) % sizeof(rxq)] = b;
+  }
+}
+
+// each returns 1 if an interrupt of the board would have come in
+static int deliver(void) {
+  // bytes reach the MCU no faster than the configured baud rate
+  int rx = 0;
+  while (rxlen && now >= rxnext) {
+    if (kerneltick) {
+      taskq[tasklen].stamp = thal_cycles();
+      taskq[tasklen++].byte = rxq[rxhead];
+    } else {
+      sched_rxbyte(rxq[rxhead]);
+      turret_poll();
+      rx = 1;
+    }
+    rxhead = (rxhead + 1) % sizeof(rxq);
+    rxlen--;
+    rxnext += bytetime();
+  }
+  return rx;
+}
+
+// -k: the uart task wakes from osDelay(1) and parses what came in
+static void kerneltask(void) {
+  for (int i = 0; i < tasklen; i++) {
+    turret.rxstamp = taskq[i].stamp;
+    turret_rxbyte(taskq[i].byte);
+  }
+  tasklen = 0;
+}
+
+static int transmit(void) {
+  // the last byte out is the tx complete interrupt
+  int busy = txlen > 0;
+  while (txlen && now >= txnext) {
+    if (write(master, &txq[txhead], 1) != 1)
+      break;
+    bytesout++;
+    txhead = (txhead + 1) % sizeof(txq);
+    txlen--;
+    txnext = (txnext > now ? txnext : now) + bytetime();
+    txbusyuntil = txnext;
+  }
+  return busy && txlen == 0;
+}
+
+static int timers(void) {
+  // the control tick runs until the turret stops it, TIM4/TIM2 are
+  // periodic until stopped or rearmed
+  int fired = 0;
+  while (tickon && now >= ticknext) {
+    ticknext += TIM7PERIOD;
+    sched_tick();
+    fired = 1;
+  }
+  if (tim4.running && now >= tim4.next) {
+    tim4.next += tim4.period;
+    turret_trigtick(THAL_TRIG);
+    fired = 1;
+  }
+  if (tim2.running && now >= tim2.next) {
+    tim2.next += tim2.period;
+    turret_cooldown(THAL_TRIG);
+    fired = 1;
+  }
+  return fired;
+}
+
+static void report(void) {
+  double secs = (now - start) / 1e6;
+  fprintf(stderr,
+          "vmcu: %.1fs rx=%lu tx=%lu moves=%u trigs=%u dropped=%u "
+          "errors=%u flipped=%lu phi=%d tht=%d (%.2f/%.2f deg) motor=%d\n",
+          secs, bytesin, bytesout, turret.proto.rxmoves, turret.proto.rxtrigs,
+          turret.proto.rxdropped, turret.proto.rxerrors, flipped, ccr4, ccr3,
+          phiservo.angle, thtservo.angle, motor);
+}
+
+static void onsignal(int sig) {
+  (void)sig;
+  quit = 1;
+}
+
+static int createpty(const char *linkpath) {
+  struct termios tio;
+  master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) || unlockpt(master))
+    return -1;
+  const char *name = ptsname(master);
+  // keep a slave fd open so the master never sees EIO between clients
+  slave = open(name, O_RDWR | O_NOCTTY);
+  if (slave < 0)
+    return -1;
+  tcgetattr(slave, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(slave, TCSANOW, &tio);
+  fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+  if (linkpath) {
+    unlink(linkpath);
+    if (symlink(name, linkpath)) {
+      perror("vmcu: symlink");
+      return -1;
+    }
+  }
+  printf("%s\n", linkpath ? linkpath : name);
+  fflush(stdout);
+  return 0;
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "usage: %s [-l link] [-b baud] [-n flipprob] [-d dropprob]\n"
+          "          [-s seed] [-o trace.csv] [-p flash.bin] [-k] [-T] [-v]\n"
+          "  -l link   symlink to the pty slave, e.g. /tmp/ttyVMCU\n"
+          "  -b baud   byte pacing of both directions, 0 = unpaced "
+          "(115200)\n"
+          "  -n prob   probability of a single bit flip per received byte\n"
+          "  -d prob   probability of losing a received byte (rx error)\n"
+          "  -s seed   random seed for the noise injection\n"
+          "  -o file   1kHz csv trace of pulses and simulated payload angles\n"
+          "  -p file   parameter sector, kept across runs (default: in memory)\n"
+          "  -k        parse rx bytes on the 1ms kernel tick (osDelay(1) "
+          "polling)\n"
+          "  -T        disable the telemetry stream\n"
+          "  -v        print counters every second\n",
+          prog);
+}
+
+int main(int argc, char **argv) {
+  const char *linkpath = NULL, *tracepath = NULL;
+  unsigned seed = 1;
+  int opt;
+  while ((opt = getopt(argc, argv, "l:b:n:d:s:o:p:kTvh")) != -1) {
+    switch (opt) {
+    case 'l':
+      linkpath = optarg;
+      break;
+    case 'b':
+      baud = atol(optarg);
+      break;
+    case 'n':
+      flipprob = atof(optarg);
+      break;
+    case 'd':
+      dropprob = atof(optarg);
+      break;
+    case 's':
+      seed = (unsigned)atol(optarg);
+      break;
+    case 'o':
+      tracepath = optarg;
+      break;
+    case 'p':
+      flashpath = optarg;
+      break;
+    case 'k':
+      kerneltick = 1;
+      break;
+    case 'T':
+      telemetry = 0;
+      break;
+    case 'v':
+      verbose = 1;
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+  srand(seed);
+  if (tracepath) {
+    trace = fopen(tracepath, "w");
+    if (!trace) {
+      perror("vmcu: trace");
+      return 1;
+    }
+    fprintf(trace, "t_ms,ccr4,ccr3,ccr1,phi_deg,tht_deg,trigprogress\n");
+  }
+  if (createpty(linkpath)) {
+    perror("vmcu: pty");
+    return 1;
+  }
+  signal(SIGINT, onsignal);
+  signal(SIGTERM, onsignal);
+
+  now = start = clockus();
+  flashload();
+  turret_init();
+  turret.telemetry = telemetry;
+  servonext = simnext = ticknext = start;
+  uint64_t reportnext = start + 1000000;
+  uint64_t systick = start;
+
+  struct pollfd pfd = {.fd = master, .events = POLLIN};
+  while (!quit) {
+    // 1ms granularity is enough for the 5ms telemetry and 500ms timers,
+    // byte pacing catches up inside deliver()
+    int timeout = rxlen || txlen ? 0 : 1;
+    if (poll(&pfd, 1, timeout) > 0 && (pfd.revents & POLLIN))
+      readpty();
+    now = clockus();
+    int woke = transmit();
+    // one wake-up of the stm32v2 superloop, timed like sched_start() does
+    // (PROF_AWAKE) but without the pty and the servo model. SysTick wakes
+    // it every 1ms whatever else runs
+    uint32_t awake = thal_cycles();
+    woke |= deliver();
+    woke |= timers();
+    if (now >= systick) {
+      systick += 1000;
+      kerneltask();
+      woke = 1;
+    }
+    if (woke) {
+      turret_poll();
+      PROF_SINCE(PROF_AWAKE, awake);
+    }
+    simulate();
+    if (verbose && now >= reportnext) {
+      report();
+      reportnext += 1000000;
+    }
+    if (rxlen || txlen)
+      usleep(baud > 0 ? 50 : 0);
+  }
+  report();
+  if (trace)
+    fclose(trace);
+  if (linkpath)
+    unlink(linkpath);
+  return 0;
+}
@@ -66,9 +66,12 @@
 #define configMINIMAL_STACK_SIZE                 ((uint16_t)128)
 #define configTOTAL_HEAP_SIZE                    ((size_t)15360)
 #define configMAX_TASK_NAME_LEN                  ( 16 )
+#define configGENERATE_RUN_TIME_STATS            1
+#define configUSE_TRACE_FACILITY                 1
 #define configUSE_16_BIT_TICKS                   0
 #define configUSE_MUTEXES                        1
 #define configQUEUE_REGISTRY_SIZE                8
+#define configCHECK_FOR_STACK_OVERFLOW           2
 #define configUSE_PORT_OPTIMISED_TASK_SELECTION  1
 /* USER CODE BEGIN MESSAGE_BUFFER_LENGTH_TYPE */
 /* Defaults to size_t for backward compatibility, but can be changed
@@ -93,6 +96,7 @@ to exclude the API function. */
 #define INCLUDE_vTaskDelayUntil              0
 #define INCLUDE_vTaskDelay                   1
 #define INCLUDE_xTaskGetSchedulerState       1
+#define INCLUDE_uxTaskGetStackHighWaterMark  1
 
 /* Cortex-M specific definitions. */
 #ifdef __NVIC_PRIO_BITS
@@ -125,6 +129,22 @@ header file. */
 #define configASSERT( x ) if ((x) == 0) {taskDISABLE_INTERRUPTS(); for( ;; );}
 /* USER CODE END 1 */
 
+/* USER CODE BEGIN 2 */
+/* Definitions needed when configGENERATE_RUN_TIME_STATS is on */
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS configureTimerForRunTimeStats
+#define portGET_RUN_TIME_COUNTER_VALUE getRunTimeCounterValue
+/* idle task: SysTick stopped and WFI until the next interrupt (TIM7 tick
+   while the turret moves, UART5, trigger timers, the TIM6 time base) or
+   task timeout, turret_sched.h times the awake stretches around it */
+#define configUSE_TICKLESS_IDLE 1
+#if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
+void sched_presleep(void);
+void sched_postsleep(void);
+#endif
+#define configPRE_SLEEP_PROCESSING(x) sched_presleep()
+#define configPOST_SLEEP_PROCESSING(x) sched_postsleep()
+/* USER CODE END 2 */
+
 /* Definitions that map the FreeRTOS port interrupt handlers to their CMSIS
 standard names. */
 #define vPortSVCHandler    SVC_Handler
@@ -137,6 +157,18 @@ standard names. */
 
 /* USER CODE BEGIN Defines */
 /* Section where parameter definitions can be added (for instance, to override default ones in FreeRTOS.h) */
+/* times a task blocked on each kind of object, sent with the run time stats
+   (rtos_stats.c) */
+#if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
+extern volatile uint32_t rtosQueueRecvBlocks, rtosQueueSendBlocks;
+extern volatile uint32_t rtosStreamRecvBlocks, rtosNotifyBlocks;
+#endif
+/* queues and semaphores (osSemaphoreWait() is a queue receive) */
+#define traceBLOCKING_ON_QUEUE_RECEIVE( pxQueue ) rtosQueueRecvBlocks++
+#define traceBLOCKING_ON_QUEUE_SEND( pxQueue ) rtosQueueSendBlocks++
+#define traceBLOCKING_ON_STREAM_BUFFER_RECEIVE( xStreamBuffer ) rtosStreamRecvBlocks++
+#define traceTASK_NOTIFY_WAIT_BLOCK() rtosNotifyBlocks++
+#define traceTASK_NOTIFY_TAKE_BLOCK() rtosNotifyBlocks++
 /* USER CODE END Defines */
 
 #endif /* FREERTOS_CONFIG_H */
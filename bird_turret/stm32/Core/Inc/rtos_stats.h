@@ -0,0 +1,62 @@
+/**
+ ******************************************************************************
+ * @file    rtos_stats.h
+ * @brief   FreeRTOS run time stats, stack high-water marks, heap and wait
+ *          counts, sent to the host on CMDRTOSSTATS.
+ *
+ * The counters behind them are turned on in FreeRTOSConfig.h: run time
+ * stats clocked by TIM5 at 100kHz (freertos.c), the trace facility for
+ * uxTaskGetSystemState() and the trace macros counting how often a task
+ * blocked on a queue/semaphore, a stream buffer or a notification. All of
+ * them count since reset, the host takes the differences.
+ ******************************************************************************
+ */
+#ifndef __RTOS_STATS_H
+#define __RTOS_STATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+#include <stdint.h>
+
+#define RTOSSTATS_MAXTASKS 8
+#define RTOSSTATS_NAMELEN 16 // configMAX_TASK_NAME_LEN
+
+// one per task (little endian)
+typedef struct __attribute__((packed)) {
+  uint8_t sync[2];
+  uint8_t type; // TELEMTASK
+  uint8_t len;
+  uint8_t index, ntasks;
+  char name[RTOSSTATS_NAMELEN];
+  uint8_t priority; // current, after inheritance
+  uint8_t state;    // eTaskState: 0 running .. 4 deleted
+  uint16_t stackfree; // minimum ever free stack, words
+  uint32_t runtime;   // TIM5 counts spent in the task
+  uint8_t crc;
+} TaskFrame;
+
+// after the task frames
+typedef struct __attribute__((packed)) {
+  uint8_t sync[2];
+  uint8_t type; // TELEMRTOS
+  uint8_t len;
+  uint32_t totalruntime; // TIM5 counts since the scheduler started
+  uint32_t heapfree, heapminfree; // bytes, heap_4
+  uint32_t queuerecvblocks, queuesendblocks; // semaphores count as queues
+  uint32_t streamrecvblocks, notifyblocks;
+  uint8_t crc;
+} RtosFrame;
+
+// frame i of a report for thal_osframe(): i == 0 takes the snapshot, then
+// one TaskFrame per task and the RtosFrame. Returns the length, 0 past the
+// end; the frame stays valid until the next call
+int rtos_stats_frame(int i, const uint8_t **frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RTOS_STATS_H */
@@ -57,6 +57,8 @@ void USART3_IRQHandler(void);
 void UART5_IRQHandler(void);
 void TIM6_DAC_IRQHandler(void);
 /* USER CODE BEGIN EFP */
+void TIM4_IRQHandler(void);
+void TIM7_IRQHandler(void);
 
 /* USER CODE END EFP */
 
@@ -44,7 +44,11 @@
 
 /* Private variables ---------------------------------------------------------*/
 /* USER CODE BEGIN Variables */
-
+// run time stats clock, 32 bit so the counters wrap after 11.9h instead of
+// the 25s of the 168MHz cycle counter
+TIM_HandleTypeDef htim5;
+// name of the task that overflowed its stack, for the debugger
+volatile const char *stackOverflowTask;
 /* USER CODE END Variables */
 
 /* Private function prototypes -----------------------------------------------*/
@@ -52,6 +56,43 @@
 
 /* USER CODE END FunctionPrototypes */
 
+/* Hook prototypes */
+void configureTimerForRunTimeStats(void);
+unsigned long getRunTimeCounterValue(void);
+void vApplicationStackOverflowHook(xTaskHandle xTask, signed char *pcTaskName);
+
+/* USER CODE BEGIN 1 */
+/* Functions needed when configGENERATE_RUN_TIME_STATS is on */
+void configureTimerForRunTimeStats(void) {
+  // not in the .ioc: TIM5 free running, 84MHz / 840 = 100kHz (10us)
+  __HAL_RCC_TIM5_CLK_ENABLE();
+  htim5.Instance = TIM5;
+  htim5.Init.Prescaler = 840 - 1;
+  htim5.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim5.Init.Period = 0xffffffff;
+  htim5.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+  htim5.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+  if (HAL_TIM_Base_Init(&htim5) != HAL_OK) {
+    Error_Handler();
+  }
+  HAL_TIM_Base_Start(&htim5);
+}
+
+unsigned long getRunTimeCounterValue(void) { return TIM5->CNT; }
+/* USER CODE END 1 */
+
+/* USER CODE BEGIN 4 */
+void vApplicationStackOverflowHook(xTaskHandle xTask, signed char *pcTaskName) {
+  // the stack below the task is already trashed, stop here like
+  // configASSERT with LD3 on
+  stackOverflowTask = (const char *)pcTaskName;
+  HAL_GPIO_WritePin(GPIOB, LD3_Pin, GPIO_PIN_SET);
+  taskDISABLE_INTERRUPTS();
+  for (;;)
+    ;
+}
+/* USER CODE END 4 */
+
 /* GetIdleTaskMemory prototype (linked to static allocation support) */
 void vApplicationGetIdleTaskMemory( StaticTask_t **ppxIdleTaskTCBBuffer, StackType_t **ppxIdleTaskStackBuffer, uint32_t *pulIdleTaskStackSize );
 
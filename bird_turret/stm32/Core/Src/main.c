@@ -23,7 +23,13 @@
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "rtos_stats.h"
 #include "stdio.h"
+#include "turret.h"
+#include "turret_config.h"
+#include "turret_hal.h"
+#include "turret_prof.h"
+#include "turret_sched.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -59,9 +65,9 @@ UART_HandleTypeDef huart3;
 PCD_HandleTypeDef hpcd_USB_OTG_FS;
 
 osThreadId uartTaskHandle;
-osSemaphoreId cooldownSemHandle;
 /* USER CODE BEGIN PV */
-
+TIM_HandleTypeDef htim4;
+TIM_HandleTypeDef htim7;
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
@@ -77,15 +83,14 @@ void StartUartTask(void const *argument);
 
 static void MX_NVIC_Init(void);
 /* USER CODE BEGIN PFP */
-
+static void TRIG_TIM4_Init(void);
+static void TICK_TIM7_Init(void);
 /* USER CODE END PFP */
 
 /* Private user code ---------------------------------------------------------*/
 /* USER CODE BEGIN 0 */
-int8_t rxbuf;
-int8_t uartRxData[4];
+uint8_t rxbuf;
 UART_HandleTypeDef *huartn = &huart5;
-const uint8_t RES_ERR = 0, RES_DONE = 1;
 int __io_putchar(int ch) {
   HAL_UART_Transmit(huartn, (uint8_t *)&ch, 1, 0xFFFF);
   return ch;
@@ -146,18 +151,23 @@ int main(void) {
   HAL_TIM_PWM_Start(&htim3, TIM_CHANNEL_1);
   HAL_TIM_PWM_Start(&htim3, TIM_CHANNEL_3);
   HAL_TIM_PWM_Start(&htim3, TIM_CHANNEL_4);
-  HAL_UART_Receive_IT(huartn, &rxbuf, 1);
+  TRIG_TIM4_Init();
+  // cycle counter for turret_prof.h
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#ifdef DEBUG
+  // keeps the debugger attached through the tickless idle WFI
+  HAL_DBGMCU_EnableDBGSleepMode();
+#endif
+  turret_init();
+  TICK_TIM7_Init();
   /* USER CODE END 2 */
 
   /* USER CODE BEGIN RTOS_MUTEX */
   /* add mutexes, ... */
   /* USER CODE END RTOS_MUTEX */
 
-  /* Create the semaphores(s) */
-  /* definition and creation of cooldownSem */
-  osSemaphoreDef(cooldownSem);
-  cooldownSemHandle = osSemaphoreCreate(osSemaphore(cooldownSem), 1);
-
   /* USER CODE BEGIN RTOS_SEMAPHORES */
   /* add semaphores, ... */
   /* USER CODE END RTOS_SEMAPHORES */
@@ -172,11 +182,16 @@ int main(void) {
 
   /* Create the thread(s) */
   /* definition and creation of uartTask */
-  osThreadDef(uartTask, StartUartTask, osPriorityNormal, 0, 128);
+  osThreadDef(uartTask, StartUartTask, osPriorityHigh, 0, 256);
   uartTaskHandle = osThreadCreate(osThread(uartTask), NULL);
 
   /* USER CODE BEGIN RTOS_THREADS */
-  /* add threads, ... */
+  // rx stream buffer, ctrl and poll tasks; the uart task above parses
+  sched_start();
+  // the kernel masks these interrupts until it starts, the buffer and the
+  // tasks are there by then
+  HAL_TIM_Base_Start_IT(&htim7);
+  HAL_UART_Receive_IT(huartn, &rxbuf, 1);
   /* USER CODE END RTOS_THREADS */
 
   /* Start scheduler */
@@ -358,11 +373,11 @@ static void MX_TIM3_Init(void) {
 
   /* USER CODE END TIM3_Init 1 */
   htim3.Instance = TIM3;
-  htim3.Init.Prescaler = 280 - 1;
+  htim3.Init.Prescaler = 28 - 1;
   htim3.Init.CounterMode = TIM_COUNTERMODE_UP;
-  htim3.Init.Period = 6000 - 1;
+  htim3.Init.Period = 60000 - 1;
   htim3.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
-  htim3.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+  htim3.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
   if (HAL_TIM_Base_Init(&htim3) != HAL_OK) {
     Error_Handler();
   }
@@ -379,7 +394,7 @@ static void MX_TIM3_Init(void) {
     Error_Handler();
   }
   sConfigOC.OCMode = TIM_OCMODE_PWM1;
-  sConfigOC.Pulse = 450 - 1;
+  sConfigOC.Pulse = 0;
   sConfigOC.OCPolarity = TIM_OCPOLARITY_HIGH;
   sConfigOC.OCFastMode = TIM_OCFAST_DISABLE;
   if (HAL_TIM_PWM_ConfigChannel(&htim3, &sConfigOC, TIM_CHANNEL_1) != HAL_OK) {
@@ -544,92 +559,197 @@ static void MX_GPIO_Init(void) {
 }
 
 /* USER CODE BEGIN 4 */
-// setmotor
-#define MOVEOP 0
-#define TRIGOP 1
-#define ENDOFDATA 2
-#define PHIMAX 750
-#define PHIMIN 150
-#define THTMAX 750
-#define THTMIN 450
-const int PHICENTER = 450 - 1, THTCENTER = 740 - 1;
-volatile int phipulse = PHICENTER, thtpulse = THTCENTER;
-volatile int cooldown = 0, received = 0;
-// volatile float prevphierr = 0.0, prevthterr = 0.0;
-// volatile float integphi = 0.0, integtht = 0.0;
-// volatile float diffphi = 0.0, difftht = 0.0;
-// const float dt = 1.0 / 30;
-const float kpx = .13, kix = .01, kdx = .05;
-const float kpy = .13, kiy = .01, kdy = .05;
-const int BOUNDCOUNT = 30;
-volatile int bounderr = BOUNDCOUNT;
-const int DFLTPULSE = 210, TRIGPULSE = 680;
-void SetMotor(int8_t nowphierr, int8_t nowthterr) {
-  // pid control
-  // integphi += nowphierr;
-  // integtht += nowthterr;
-  // diffphi = (nowphierr - prevphierr);
-  // difftht = (nowthterr - prevthterr);
-  // phipulse += kpx * nowphierr + kix * integphi + kpx * diffphi;
-  // thtpulse += kpy * nowthterr + kiy * integtht + kpy * difftht;
-  phipulse += kpx * nowphierr;
-  thtpulse += kpy * nowthterr;
-
-  // check the bound
-  // phipulse = phipulse > PHIMIN ? phipulse : PHIMIN;
-  // phipulse = phipulse < PHIMAX ? phipulse : PHIMAX;
-  // thtpulse = thtpulse > THTMIN ? thtpulse : THTMIN;
-  // thtpulse = thtpulse < THTMAX ? thtpulse : THTMAX;
-  // if (phipulse == PHIMIN || phipulse == PHIMAX || thtpulse == THTMIN ||
-  //     thtpulse == THTMAX)
-  //   bounderr--;
-  // if (!bounderr) {
-  //   phipulse = PHICENTER, thtpulse = THTCENTER;
-  //   HAL_GPIO_WritePin(GPIOB, GPIO_PIN_0, GPIO_PIN_RESET);
-  //   HAL_UART_Transmit(huartn, &RES_ERR, 1, HAL_MAX_DELAY);
-  //   bounderr = BOUNDCOUNT;
-  //   phipulse = PHICENTER, thtpulse = THTCENTER;
-  //   // prevphierr = 0.0, prevthterr = 0.0;
-  //   // integphi = 0.0, integtht = 0.0;
-  //   // diffphi = 0.0, difftht = 0.0;
-  // }
-
-  // set duty cycle
-  TIM3->CCR3 = thtpulse;
-  TIM3->CCR4 = phipulse;
-  // prevphierr = nowphierr, prevthterr = nowthterr;
-}
-
-// DoTrigger
-void DoTrigger() {
-  TIM3->CCR1 = TRIGPULSE;
-  osDelay(500);
-  TIM3->CCR1 = DFLTPULSE;
-  HAL_GPIO_WritePin(GPIOB, GPIO_PIN_0, GPIO_PIN_RESET);
-  osDelay(500);
-  TIM3->CCR1 = TRIGPULSE;
-  osDelay(500);
-  TIM3->CCR1 = DFLTPULSE;
-  osDelay(500);
-  bounderr = BOUNDCOUNT;
-  TIM3->CCR3 = THTCENTER, TIM3->CCR4 = PHICENTER;
-  // prevphierr = 0.0, prevthterr = 0.0;
-  // nowphierr = 0.0, nowthterr = 0.0;
-  // integphi = 0.0, integtht = 0.0;
-  // diffphi = 0.0, difftht = 0.0;
-  HAL_GPIO_WritePin(GPIOB, GPIO_PIN_0, GPIO_PIN_RESET);
-  HAL_UART_Transmit(huartn, &RES_DONE, 1, HAL_MAX_DELAY);
-  cooldown = 1;
+static void TRIG_TIM4_Init(void) {
+  // not in the .ioc: 84MHz / 42000 = 2kHz counts, one step per period
+  __HAL_RCC_TIM4_CLK_ENABLE();
+  htim4.Instance = TIM4;
+  htim4.Init.Prescaler = 42000 - 1;
+  htim4.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim4.Init.Period = 1000 - 1;
+  htim4.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+  if (HAL_TIM_Base_Init(&htim4) != HAL_OK) {
+    Error_Handler();
+  }
+  // at configMAX_SYSCALL_INTERRUPT_PRIORITY like the uart, a shot never
+  // waits for a task
+  HAL_NVIC_SetPriority(TIM4_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(TIM4_IRQn);
+}
+
+/**
+ * @brief TIM7 Initialization Function, TICKHZ control tick
+ * @param None
+ * @retval None
+ */
+static void TICK_TIM7_Init(void) {
+  // basic timer, not in the .ioc: 84MHz / 84 = 1MHz counts
+  __HAL_RCC_TIM7_CLK_ENABLE();
+  htim7.Instance = TIM7;
+  htim7.Init.Prescaler = 84 - 1;
+  htim7.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim7.Init.Period = 1000000 / TICKHZ - 1;
+  htim7.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+  if (HAL_TIM_Base_Init(&htim7) != HAL_OK) {
+    Error_Handler();
+  }
+  // only notifies the ctrl task, so it may share the syscall priority
+  HAL_NVIC_SetPriority(TIM7_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(TIM7_IRQn);
+}
+
+// turret_hal.h on top of the STM32 HAL. No TIM1 pwm and no TIM3 dma burst
+// in this .ioc: the motor pin is on/off and CCR updates are held with UDIS
+// one turret: pan CH4, tilt CH3, trigger CH1, launcher PB0
+void thal_servo(int out, int ccr) {
+  if (out == THAL_PHI)
+    TIM3->CCR4 = ccr;
+  else
+    TIM3->CCR3 = ccr;
+}
+
+void thal_trigger(int out, int ccr) {
+  if (out == THAL_TRIG)
+    TIM3->CCR1 = ccr;
+}
+
+void thal_ccrhold(int hold) {
+  // CCRs are preloaded: with UDIS set the update event does not copy them,
+  // the frame keeps the old values on every channel
+  if (hold)
+    SET_BIT(TIM3->CR1, TIM_CR1_UDIS);
+  else
+    CLEAR_BIT(TIM3->CR1, TIM_CR1_UDIS);
+}
+
+void thal_motor(int out, int permille) {
+  if (out != THAL_MOTOR)
+    return;
+  // PB0 (LD1) as a plain output
+  HAL_GPIO_WritePin(GPIOB, GPIO_PIN_0, permille > 0 ? GPIO_PIN_SET
+                                                    : GPIO_PIN_RESET);
+}
+
+void thal_shotled(int out, int on) {
+  if (out == THAL_TRIG)
+    HAL_GPIO_WritePin(GPIOB, LD2_Pin, on ? GPIO_PIN_SET : GPIO_PIN_RESET);
+}
+
+void thal_trigtimer(int out, int ms) {
+  if (out != THAL_TRIG)
+    return;
+  // TIM4 counts at 2kHz, the callback rearms it for the next step. An
+  // update that came in before the stop must not run a step on the restart
+  HAL_TIM_Base_Stop_IT(&htim4);
+  __HAL_TIM_CLEAR_FLAG(&htim4, TIM_FLAG_UPDATE);
+  if (ms <= 0)
+    return;
+  if (ms > 32768)
+    ms = 32768;
+  __HAL_TIM_SET_AUTORELOAD(&htim4, ms * 2 - 1);
+  __HAL_TIM_SET_COUNTER(&htim4, 0);
+  HAL_TIM_Base_Start_IT(&htim4);
+}
+
+void thal_cooldowntimer(int out, int ms) {
+  if (out != THAL_TRIG)
+    return;
+  // TIM2 counts at 30kHz, 32 bit
+  HAL_TIM_Base_Stop_IT(&htim2);
+  __HAL_TIM_CLEAR_FLAG(&htim2, TIM_FLAG_UPDATE);
+  if (ms <= 0)
+    return;
+  __HAL_TIM_SET_AUTORELOAD(&htim2, ms * 30 - 1);
+  __HAL_TIM_SET_COUNTER(&htim2, 0);
+  HAL_TIM_Base_Start_IT(&htim2);
+}
+
+void thal_ticktimer(int on) {
+  if (!on) {
+    HAL_TIM_Base_Stop_IT(&htim7);
+    return;
+  }
+  HAL_TIM_Base_Start_IT(&htim7);
+  // the update event clears the counter and interrupts at once, the new
+  // command does not wait out a tick period
+  htim7.Instance->EGR = TIM_EGR_UG;
+}
+
+uint32_t thal_millis(void) { return HAL_GetTick(); }
+
+uint32_t thal_cycles(void) { return DWT->CYCCNT; }
+
+int thal_txready(void) { return huart5.gState == HAL_UART_STATE_READY; }
+
+void thal_transmit(const uint8_t *data, int len) {
+  HAL_UART_Transmit_IT(&huart5, (uint8_t *)data, len);
+}
+
+// parameter sector: the last 128K of bank 2, kept out of the linker
+// script. Bank 1 holds the code, so it keeps running during an erase
+#define PARAM_SECTOR FLASH_SECTOR_23
+#define PARAM_ADDR 0x081E0000u
+#define PARAM_SIZE 0x20000u
+
+uint32_t thal_flashsize(void) { return PARAM_SIZE; }
+
+const uint8_t *thal_flashdata(void) { return (const uint8_t *)PARAM_ADDR; }
+
+static void flashDone(void) {
+  HAL_FLASH_Lock();
+  // reads through the data cache would still see the old words
+  __HAL_FLASH_DATA_CACHE_DISABLE();
+  __HAL_FLASH_DATA_CACHE_RESET();
+  __HAL_FLASH_DATA_CACHE_ENABLE();
+}
+
+int thal_flasherase(void) {
+  FLASH_EraseInitTypeDef erase = {
+      .TypeErase = FLASH_TYPEERASE_SECTORS,
+      .Sector = PARAM_SECTOR,
+      .NbSectors = 1,
+      .VoltageRange = FLASH_VOLTAGE_RANGE_3,
+  };
+  uint32_t bad;
+  HAL_FLASH_Unlock();
+  HAL_StatusTypeDef st = HAL_FLASHEx_Erase(&erase, &bad);
+  flashDone();
+  return st == HAL_OK;
+}
+
+int thal_flashwrite(uint32_t offset, const uint32_t *words, int nwords) {
+  HAL_StatusTypeDef st = HAL_OK;
+  HAL_FLASH_Unlock();
+  for (int i = 0; i < nwords && st == HAL_OK; i++)
+    st = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, PARAM_ADDR + offset + 4 * i,
+                           words[i]);
+  flashDone();
+  return st == HAL_OK;
+}
+
+int thal_osframe(int i, const uint8_t **frame) {
+  return rtos_stats_frame(i, frame);
 }
 
 void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart) {
-  uartRxData[0] = uartRxData[1];
-  uartRxData[1] = uartRxData[2];
-  uartRxData[2] = uartRxData[3];
-  uartRxData[3] = rxbuf;
-  if (rxbuf == ENDOFDATA)
-    received = 1;
+  PROF_BEGIN(PROF_UARTRX);
+  // buffered with its stamp, the uart task parses
+  sched_rxbyte(rxbuf);
   HAL_UART_Receive_IT(huartn, &rxbuf, 1);
+  PROF_END(PROF_UARTRX);
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
+  // the poll task sends the next frame now rather than after the next tick
+  if (huart->Instance == UART5)
+    sched_wake();
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart) {
+  // overrun/framing/noise abort the reception, count it and rearm
+  if (huart->Instance == UART5) {
+    turret_rxerror();
+    HAL_UART_Receive_IT(huartn, &rxbuf, 1);
+  }
 }
 /* USER CODE END 4 */
 
@@ -642,32 +762,8 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart) {
 /* USER CODE END Header_StartUartTask */
 void StartUartTask(void const *argument) {
   /* USER CODE BEGIN 5 */
-  TIM3->CCR3 = THTCENTER;
-  TIM3->CCR4 = PHICENTER;
-  TIM3->CCR1 = DFLTPULSE;
-  /* Infinite loop */
-  for (;;) {
-    HAL_GPIO_WritePin(GPIOB, LD2_Pin, GPIO_PIN_SET);
-    while (!received) {
-      osDelay(1);
-    }
-    HAL_GPIO_WritePin(GPIOB, LD2_Pin, GPIO_PIN_RESET);
-    received = 0;
-    if (uartRxData[0] == MOVEOP) {
-      HAL_GPIO_WritePin(GPIOB, GPIO_PIN_0, GPIO_PIN_SET);
-      // SetMotor(-uartRxData[1], uartRxData[2]);
-      phipulse += kpx * (-uartRxData[1]);
-      thtpulse += kpy * uartRxData[2];
-      TIM3->CCR3 = thtpulse;
-      TIM3->CCR4 = phipulse;
-    } else if (uartRxData[0] == TRIGOP) {
-      DoTrigger();
-      HAL_GPIO_WritePin(GPIOB, GPIO_PIN_0, GPIO_PIN_RESET);
-    }
-    HAL_GPIO_WritePin(GPIOB, LD3_Pin, GPIO_PIN_SET);
-    HAL_Delay(1000);
-    HAL_GPIO_WritePin(GPIOB, LD3_Pin, GPIO_PIN_RESET);
-  }
+  // blocks on the rx stream buffer, turret_rxbyte() for each byte
+  sched_rxloop();
   /* USER CODE END 5 */
 }
 
@@ -681,15 +777,20 @@ void StartUartTask(void const *argument) {
  */
 void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim) {
   /* USER CODE BEGIN Callback 0 */
-  if (htim->Instance == TIM2) {
-    osSemaphoreWait(cooldownSemHandle, osWaitForever);
-    cooldown = 0;
-    osSemaphoreRelease(cooldownSemHandle);
-  }
+  PROF_BEGIN(PROF_TIMCB);
+  if (htim->Instance == TIM2)
+    turret_cooldown(THAL_TRIG);
+  if (htim->Instance == TIM4)
+    turret_trigtick(THAL_TRIG);
+  if (htim->Instance == TIM2 || htim->Instance == TIM4)
+    sched_wake();
+  if (htim->Instance == TIM7)
+    sched_tick();
   if (htim->Instance == TIM6) {
     HAL_IncTick();
   }
   /* USER CODE BEGIN Callback 1 */
+  PROF_END(PROF_TIMCB);
 
   /* USER CODE END Callback 1 */
 }
@@ -0,0 +1,52 @@
+/**
+ ******************************************************************************
+ * @file    rtos_stats.c
+ * @brief   FreeRTOS run time stats, stack high-water marks, heap and wait
+ *          counts, sent to the host on CMDRTOSSTATS.
+ ******************************************************************************
+ */
+#include "rtos_stats.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "turret_proto.h"
+#include <string.h>
+
+// incremented by the trace macros in FreeRTOSConfig.h
+volatile uint32_t rtosQueueRecvBlocks, rtosQueueSendBlocks;
+volatile uint32_t rtosStreamRecvBlocks, rtosNotifyBlocks;
+
+// one snapshot per report, the counters keep running while it is sent
+static TaskStatus_t tasks[RTOSSTATS_MAXTASKS];
+static UBaseType_t ntasks;
+static uint32_t totalruntime;
+
+int rtos_stats_frame(int i, const uint8_t **frame) {
+  static TaskFrame t;
+  static RtosFrame r;
+  if (i == 0)
+    ntasks = uxTaskGetSystemState(tasks, RTOSSTATS_MAXTASKS, &totalruntime);
+  if (i < (int)ntasks) {
+    t.index = i;
+    t.ntasks = ntasks;
+    strncpy(t.name, tasks[i].pcTaskName, RTOSSTATS_NAMELEN);
+    t.priority = tasks[i].uxCurrentPriority;
+    t.state = tasks[i].eCurrentState;
+    t.stackfree = tasks[i].usStackHighWaterMark;
+    t.runtime = tasks[i].ulRunTimeCounter;
+    proto_seal((uint8_t *)&t, TELEMTASK, sizeof(TaskFrame) - 5);
+    *frame = (const uint8_t *)&t;
+    return sizeof(t);
+  }
+  if (i > (int)ntasks)
+    return 0;
+  r.totalruntime = totalruntime;
+  r.heapfree = xPortGetFreeHeapSize();
+  r.heapminfree = xPortGetMinimumEverFreeHeapSize();
+  r.queuerecvblocks = rtosQueueRecvBlocks;
+  r.queuesendblocks = rtosQueueSendBlocks;
+  r.streamrecvblocks = rtosStreamRecvBlocks;
+  r.notifyblocks = rtosNotifyBlocks;
+  proto_seal((uint8_t *)&r, TELEMRTOS, sizeof(RtosFrame) - 5);
+  *frame = (const uint8_t *)&r;
+  return sizeof(r);
+}
@@ -59,7 +59,8 @@ void TIM2_IRQHandler(void);
 void TIM4_IRQHandler(void);
 void UART5_IRQHandler(void);
 /* USER CODE BEGIN EFP */
-
+void DMA1_Stream7_IRQHandler(void);
+void TIM7_IRQHandler(void);
 /* USER CODE END EFP */
 
 #ifdef __cplusplus
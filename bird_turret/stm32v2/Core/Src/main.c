@@ -22,7 +22,11 @@
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
-
+#include "turret.h"
+#include "turret_config.h"
+#include "turret_hal.h"
+#include "turret_prof.h"
+#include "turret_sched.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -60,7 +64,10 @@ UART_HandleTypeDef huart3;
 PCD_HandleTypeDef hpcd_USB_OTG_FS;
 
 /* USER CODE BEGIN PV */
-
+DMA_HandleTypeDef hdma_uart5_tx;
+DMA_HandleTypeDef hdma_tim3_up;
+TIM_HandleTypeDef htim7;
+TIM_HandleTypeDef htim1;
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
@@ -75,30 +82,17 @@ static void MX_UART5_Init(void);
 static void MX_TIM4_Init(void);
 static void MX_NVIC_Init(void);
 /* USER CODE BEGIN PFP */
+static void TICK_TIM7_Init(void);
+static void MOTOR_TIM1_Init(void);
 
 /* USER CODE END PFP */
 
 /* Private user code ---------------------------------------------------------*/
 /* USER CODE BEGIN 0 */
-int8_t rxbuf;
-int8_t oper[4];
-const uint8_t RES_ERR = 0, RES_DON = 1;
-#define MOVEOP 0
-#define TRIGOP 1
-#define ENDOFDATA 2
-#define PHIMAX 750
-#define PHIMIN 150
-#define THTMAX 750
-#define THTMIN 450
-#define DFLTPULSE 210
-#define TRIGPULSE 680
-#define MAXBOUNDCNT 30
-const int PHICENTER = 450 - 1, THTCENTER = 740 - 1;
-const float kpx = .06, kpy = .16;
-volatile int phipulse = PHICENTER, thtpulse = THTCENTER;
-volatile int shotflag = 0, moveflag = 0;
-volatile int boundcnt = MAXBOUNDCNT;
-volatile int trigprogress = 0;
+uint8_t rxbuf;
+// CCR1..CCR4 shadow, the TIM3 update DMA burst copies it into the preload
+// registers so all channels change on the same frame
+uint32_t tim3ccr[4];
 /* USER CODE END 0 */
 
 /**
@@ -144,33 +138,29 @@ int main(void) {
   HAL_TIM_PWM_Start(&htim3, TIM_CHANNEL_1);
   HAL_TIM_PWM_Start(&htim3, TIM_CHANNEL_3);
   HAL_TIM_PWM_Start(&htim3, TIM_CHANNEL_4);
+  MOTOR_TIM1_Init();
+  // cycle counter for turret_prof.h
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#ifdef DEBUG
+  // keeps the debugger attached through WFI, at the cost of the idle saving
+  HAL_DBGMCU_EnableDBGSleepMode();
+#endif
+  turret_init();
+  HAL_TIM_DMABurst_MultiWriteStart(&htim3, TIM_DMABASE_CCR1, TIM_DMA_UPDATE,
+                                   tim3ccr, TIM_DMABURSTLENGTH_4TRANSFERS, 4);
+  TICK_TIM7_Init();
+  HAL_TIM_Base_Start_IT(&htim7);
   HAL_UART_Receive_IT(&huart5, &rxbuf, 1);
-  TIM3->CCR3 = THTCENTER;
-  TIM3->CCR4 = PHICENTER;
-  TIM3->CCR1 = DFLTPULSE;
+  // superloop: turret_poll() after each interrupt, sleeps in between; does
+  // not return
+  sched_start();
   /* USER CODE END 2 */
 
   /* Infinite loop */
   /* USER CODE BEGIN WHILE */
   while (1) {
-    if (moveflag) {
-      // start dc motor
-      HAL_GPIO_WritePin(GPIOB, GPIO_PIN_0, GPIO_PIN_SET);
-
-      // caculate pwm duty cycle
-      phipulse += kpx * (-oper[1]);
-      thtpulse += kpy * (oper[2]);
-
-      // check bound
-      // if out of bound, boundcnt--;
-
-      // apply pwm duty cycle
-      TIM3->CCR3 = thtpulse;
-      TIM3->CCR4 = phipulse;
-
-      // reset flag
-      moveflag = 0;
-    }
     /* USER CODE END WHILE */
 
     /* USER CODE BEGIN 3 */
@@ -339,11 +329,11 @@ static void MX_TIM3_Init(void) {
 
   /* USER CODE END TIM3_Init 1 */
   htim3.Instance = TIM3;
-  htim3.Init.Prescaler = 280 - 1;
+  htim3.Init.Prescaler = 28 - 1;
   htim3.Init.CounterMode = TIM_COUNTERMODE_UP;
-  htim3.Init.Period = 6000 - 1;
+  htim3.Init.Period = 60000 - 1;
   htim3.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
-  htim3.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+  htim3.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
   if (HAL_TIM_Base_Init(&htim3) != HAL_OK) {
     Error_Handler();
   }
@@ -566,53 +556,251 @@ static void MX_GPIO_Init(void) {
 }
 
 /* USER CODE BEGIN 4 */
-void motorRangeCheck() {
-  ;
-  ;
+/**
+ * @brief TIM7 Initialization Function, TICKHZ control tick
+ * @param None
+ * @retval None
+ */
+static void TICK_TIM7_Init(void) {
+  // basic timer, not in the .ioc: 84MHz / 84 = 1MHz counts
+  __HAL_RCC_TIM7_CLK_ENABLE();
+  htim7.Instance = TIM7;
+  htim7.Init.Prescaler = 84 - 1;
+  htim7.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim7.Init.Period = 1000000 / TICKHZ - 1;
+  htim7.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+  if (HAL_TIM_Base_Init(&htim7) != HAL_OK) {
+    Error_Handler();
+  }
+  // below the uart so a tick never delays a received byte
+  HAL_NVIC_SetPriority(TIM7_IRQn, 1, 0);
+  HAL_NVIC_EnableIRQ(TIM7_IRQn);
 }
-void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim) {
-  if (htim->Instance == TIM2) {
-    shotflag = 0;
-    HAL_GPIO_WritePin(GPIOB, LD2_Pin, GPIO_PIN_RESET);
-    HAL_TIM_Base_Stop_IT(&htim2);
+
+/**
+ * @brief TIM1 Initialization Function, launcher motor pwm on PB0
+ * @param None
+ * @retval None
+ */
+static void MOTOR_TIM1_Init(void) {
+  // not in the .ioc, PB0 (LD1 there) is TIM1_CH2N: 168MHz / 8400 = 20kHz,
+  // above the audible range and slow enough for the motor driver
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+  TIM_OC_InitTypeDef sConfigOC = {0};
+
+  __HAL_RCC_TIM1_CLK_ENABLE();
+  htim1.Instance = TIM1;
+  htim1.Init.Prescaler = 0;
+  htim1.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim1.Init.Period = 8400 - 1;
+  htim1.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+  htim1.Init.RepetitionCounter = 0;
+  htim1.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+  if (HAL_TIM_PWM_Init(&htim1) != HAL_OK) {
+    Error_Handler();
   }
-  if (htim->Instance == TIM4) {
-    switch (trigprogress) {
-    case 0:
-    case 2:
-      TIM3->CCR1 = TRIGPULSE;
-      break;
-    case 1:
-    case 3:
-      TIM3->CCR1 = DFLTPULSE;
-      break;
-    }
-    if (trigprogress++ < 3)
-      HAL_TIM_Base_Start_IT(&htim4);
-    else {
-      trigprogress = 0;
-      boundcnt = MAXBOUNDCNT;
-      TIM3->CCR3 = THTCENTER, TIM3->CCR4 = PHICENTER;
-      HAL_GPIO_WritePin(GPIOB, GPIO_PIN_0, GPIO_PIN_RESET);
-      HAL_UART_Transmit_IT(&huart5, &RES_DON, 1);
-      HAL_TIM_Base_Start_IT(&htim2);
-      HAL_TIM_Base_Stop_IT(&htim4);
-    }
+  sConfigOC.OCMode = TIM_OCMODE_PWM1;
+  sConfigOC.Pulse = 0;
+  sConfigOC.OCPolarity = TIM_OCPOLARITY_HIGH;
+  sConfigOC.OCNPolarity = TIM_OCNPOLARITY_HIGH;
+  sConfigOC.OCFastMode = TIM_OCFAST_DISABLE;
+  sConfigOC.OCIdleState = TIM_OCIDLESTATE_RESET;
+  sConfigOC.OCNIdleState = TIM_OCNIDLESTATE_RESET;
+  if (HAL_TIM_PWM_ConfigChannel(&htim1, &sConfigOC, TIM_CHANNEL_2) != HAL_OK) {
+    Error_Handler();
   }
+
+  // the pin was a plain output until now, low
+  GPIO_InitStruct.Pin = GPIO_PIN_0;
+  GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+  GPIO_InitStruct.Alternate = GPIO_AF1_TIM1;
+  HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
+
+  // only CH2N enabled: the pin follows OC2REF, also sets MOE
+  HAL_TIMEx_PWMN_Start(&htim1, TIM_CHANNEL_2);
 }
 
-void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart) {
-  oper[0] = oper[1];
-  oper[1] = oper[2];
-  oper[2] = oper[3];
-  oper[3] = rxbuf;
-  if (oper[3] == ENDOFDATA && oper[0] == MOVEOP && moveflag == 0)
-    moveflag = 1;
-  else if (oper[3] == ENDOFDATA && oper[0] == TRIGOP && shotflag == 0) {
-    shotflag = 1, HAL_GPIO_WritePin(GPIOB, LD2_Pin, GPIO_PIN_SET);
-    HAL_TIM_Base_Start_IT(&htim4);
+// turret_hal.h on top of the STM32 HAL
+// one turret: pan CH4, tilt CH3, trigger CH1, launcher TIM1 CH2N
+static uint32_t *const servoccr[] = {&tim3ccr[3], &tim3ccr[2]};
+
+void thal_servo(int out, int ccr) { *servoccr[out] = ccr; }
+
+void thal_trigger(int out, int ccr) {
+  if (out == THAL_TRIG)
+    tim3ccr[0] = ccr;
+}
+
+void thal_ccrhold(int hold) {
+  // an update while UDE is clear skips one burst, the frame keeps the old
+  // values on every channel instead of mixing old and new
+  if (hold)
+    CLEAR_BIT(TIM3->DIER, TIM_DIER_UDE);
+  else
+    SET_BIT(TIM3->DIER, TIM_DIER_UDE);
+}
+
+void thal_motor(int out, int permille) {
+  if (out != THAL_MOTOR)
+    return;
+  // CCR2 is preloaded, the new duty starts with the next pwm period
+  __HAL_TIM_SET_COMPARE(&htim1, TIM_CHANNEL_2, permille * 8400 / 1000);
+}
+
+void thal_shotled(int out, int on) {
+  if (out == THAL_TRIG)
+    HAL_GPIO_WritePin(GPIOB, LD2_Pin, on ? GPIO_PIN_SET : GPIO_PIN_RESET);
+}
+
+void thal_trigtimer(int out, int ms) {
+  if (out != THAL_TRIG)
+    return;
+  // TIM4 counts at 2kHz, the callback rearms it for the next step. An
+  // update that came in before the stop must not run a step on the restart
+  HAL_TIM_Base_Stop_IT(&htim4);
+  __HAL_TIM_CLEAR_FLAG(&htim4, TIM_FLAG_UPDATE);
+  if (ms <= 0)
+    return;
+  if (ms > 32768)
+    ms = 32768;
+  __HAL_TIM_SET_AUTORELOAD(&htim4, ms * 2 - 1);
+  __HAL_TIM_SET_COUNTER(&htim4, 0);
+  HAL_TIM_Base_Start_IT(&htim4);
+}
+
+void thal_cooldowntimer(int out, int ms) {
+  if (out != THAL_TRIG)
+    return;
+  // TIM2 counts at 2kHz, 32 bit
+  HAL_TIM_Base_Stop_IT(&htim2);
+  __HAL_TIM_CLEAR_FLAG(&htim2, TIM_FLAG_UPDATE);
+  if (ms <= 0)
+    return;
+  __HAL_TIM_SET_AUTORELOAD(&htim2, ms * 2 - 1);
+  __HAL_TIM_SET_COUNTER(&htim2, 0);
+  HAL_TIM_Base_Start_IT(&htim2);
+}
+
+void thal_ticktimer(int on) {
+  if (!on) {
+    HAL_TIM_Base_Stop_IT(&htim7);
+    return;
   }
+  HAL_TIM_Base_Start_IT(&htim7);
+  // the update event clears the counter and interrupts at once, the new
+  // command does not wait out a tick period
+  htim7.Instance->EGR = TIM_EGR_UG;
+}
+
+uint32_t thal_millis(void) { return HAL_GetTick(); }
+
+uint32_t thal_cycles(void) { return DWT->CYCCNT; }
+
+uint32_t thal_sleep(volatile const int *wake) {
+  // Sleep mode: clocks, TIM3 pwm and the DMA keep running, any enabled
+  // interrupt (UART5 and its tx DMA, TIM2/4/7, SysTick) wakes the core in a
+  // few cycles. Stop mode would halt the servo pwm and restart the PLL
+  __disable_irq();
+  if (!*wake)
+    __WFI();
+  uint32_t t = DWT->CYCCNT;
+  __enable_irq();
+  return t;
+}
+
+int thal_txready(void) { return huart5.gState == HAL_UART_STATE_READY; }
+
+void thal_transmit(const uint8_t *data, int len) {
+  HAL_UART_Transmit_DMA(&huart5, (uint8_t *)data, len);
+}
+
+// parameter sector: the last 128K of bank 2, kept out of the linker
+// script. Bank 1 holds the code, so it keeps running during an erase
+#define PARAM_SECTOR FLASH_SECTOR_23
+#define PARAM_ADDR 0x081E0000u
+#define PARAM_SIZE 0x20000u
+
+uint32_t thal_flashsize(void) { return PARAM_SIZE; }
+
+const uint8_t *thal_flashdata(void) { return (const uint8_t *)PARAM_ADDR; }
+
+static void flashDone(void) {
+  HAL_FLASH_Lock();
+  // reads through the data cache would still see the old words
+  __HAL_FLASH_DATA_CACHE_DISABLE();
+  __HAL_FLASH_DATA_CACHE_RESET();
+  __HAL_FLASH_DATA_CACHE_ENABLE();
+}
+
+int thal_flasherase(void) {
+  FLASH_EraseInitTypeDef erase = {
+      .TypeErase = FLASH_TYPEERASE_SECTORS,
+      .Sector = PARAM_SECTOR,
+      .NbSectors = 1,
+      .VoltageRange = FLASH_VOLTAGE_RANGE_3,
+  };
+  uint32_t bad;
+  HAL_FLASH_Unlock();
+  HAL_StatusTypeDef st = HAL_FLASHEx_Erase(&erase, &bad);
+  flashDone();
+  return st == HAL_OK;
+}
+
+int thal_flashwrite(uint32_t offset, const uint32_t *words, int nwords) {
+  HAL_StatusTypeDef st = HAL_OK;
+  HAL_FLASH_Unlock();
+  for (int i = 0; i < nwords && st == HAL_OK; i++)
+    st = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, PARAM_ADDR + offset + 4 * i,
+                           words[i]);
+  flashDone();
+  return st == HAL_OK;
+}
+
+int thal_osframe(int i, const uint8_t **frame) {
+  // bare metal, nothing to report on CMDRTOSSTATS
+  (void)i;
+  (void)frame;
+  return 0;
+}
+
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim) {
+  // TIM3 only reaches here through the burst's dma transfer complete, which
+  // is left disabled; nothing to do each pwm frame
+  if (htim->Instance == TIM3)
+    return;
+  PROF_BEGIN(PROF_TIMCB);
+  if (htim->Instance == TIM2)
+    turret_cooldown(THAL_TRIG);
+  if (htim->Instance == TIM4)
+    turret_trigtick(THAL_TRIG);
+  if (htim->Instance == TIM2 || htim->Instance == TIM4)
+    sched_wake();
+  if (htim->Instance == TIM7)
+    sched_tick();
+  PROF_END(PROF_TIMCB);
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
+  // the next frame goes out now rather than after the next tick
+  if (huart->Instance == UART5)
+    sched_wake();
+}
+
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart) {
+  PROF_BEGIN(PROF_UARTRX);
+  sched_rxbyte(rxbuf);
   HAL_UART_Receive_IT(&huart5, &rxbuf, 1);
+  PROF_END(PROF_UARTRX);
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart) {
+  // overrun/framing/noise abort the reception, count it and rearm
+  if (huart->Instance == UART5) {
+    turret_rxerror();
+    HAL_UART_Receive_IT(&huart5, &rxbuf, 1);
+  }
 }
 /* USER CODE END 4 */
 